@@ -4,6 +4,8 @@
 #include "G4VUserActionInitialization.hh"
 #include "globals.hh" 
 
+class InputGeneratorAction;
+
 class ActionInitialization : public G4VUserActionInitialization
 {
   public:
@@ -14,6 +16,10 @@ class ActionInitialization : public G4VUserActionInitialization
     virtual void BuildForMaster() const;
     virtual void Build() const;
 
+    // Generator for an input file, chosen by its extension (.hepmc or custom text);
+    // "gun" selects the built-in gun (GunGeneratorAction)
+    static InputGeneratorAction* CreateGenerator(const G4String& inputFilename);
+
   private:
     G4String fInputFilename; // Storing filename
 };
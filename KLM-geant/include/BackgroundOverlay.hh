@@ -0,0 +1,71 @@
+#ifndef BACKGROUNDOVERLAY_HH
+#define BACKGROUNDOVERLAY_HH
+
+#include "globals.hh"
+#include "KLMDigitizer.hh" // KLMCellDeposit
+#include <cstdint>
+#include <random>
+#include <vector>
+
+class G4GenericMessenger;
+
+// Beam-background / noise overlay from a memory-mapped library of cell
+// frames (one frame = the background cells of one readout window).
+// Each signal event gets floor(rate) random frames, plus one more frame whose
+// cells are kept with probability frac(rate). Frames are drawn with a private
+// engine seeded from (overlay seed, event ID): different seeds give
+// independent background variants of the same signal.
+// Libraries are built from background-only cell files with klm_mkbkg.
+// Configured with /klm/overlay/.
+class BackgroundOverlay
+{
+public:
+  // On-disk cell: 16 bytes, energy in keV and time in ns
+  struct Cell {
+    std::int16_t sector;
+    std::int16_t stack;
+    std::int16_t zCell;
+    std::int16_t phiCell;
+    float edepKeV;
+    float timeNs;
+  };
+
+  BackgroundOverlay();
+  ~BackgroundOverlay();
+
+  // Maps a library; "" unmaps it
+  G4bool Open(const G4String& fileName);
+  void Close();
+  G4bool IsActive() const { return fCells != nullptr && fRate > 0.; }
+  std::uint64_t GetNumFrames() const { return fNumFrames; }
+
+  void SetRate(G4double rate) { fRate = rate; }
+  void SetSeed(G4long seed) { fSeed = seed; }
+
+  // Appends the background cells of this event (unmerged; the same cell may appear twice)
+  void Sample(G4int eventID, std::vector<KLMCellDeposit>& cells);
+  // Sorts by cell and sums duplicates (earliest time), as the cell map of EventAction does
+  static void MergeCells(std::vector<KLMCellDeposit>& cells);
+
+  // Writes a library: "KLMBKG01", u64 nFrames, u64 offsets[nFrames+1], Cell[offsets[nFrames]]
+  static G4bool Write(const G4String& fileName, const std::vector<std::vector<KLMCellDeposit> >& frames);
+
+private:
+  void SetLibrary(const G4String& fileName) { Open(fileName); }
+  void AppendFrame(std::uint64_t frame, G4double keepProbability, std::vector<KLMCellDeposit>& cells);
+
+  G4GenericMessenger* fMessenger;
+  G4double fRate;
+  G4long fSeed;
+
+  // --- Mapped library ---
+  void* fMapping;
+  std::size_t fMappingSize;
+  std::uint64_t fNumFrames;
+  const std::uint64_t* fOffsets;
+  const Cell* fCells;
+
+  std::mt19937_64 fEngine;
+};
+
+#endif // BACKGROUNDOVERLAY_HH
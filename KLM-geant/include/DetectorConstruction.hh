@@ -4,11 +4,28 @@
 #include "G4VUserDetectorConstruction.hh"
 #include "globals.hh"
 #include "G4SystemOfUnits.hh" // For units
+#include <string>
+#include <vector>
 
 // Forward declarations
 class G4VPhysicalVolume;
 class G4LogicalVolume;
 class G4Material; // Forward declare G4Material
+class G4VTouchable;
+class G4GenericMessenger;
+class MylarSD;
+class FastMuonModel;
+class KLShowerModel;
+
+// One radial slab of the sector structure (RPC sublayer or iron plate), in sector-local radius
+struct KLMRadialLayer {
+  G4double rMin;
+  G4double rMax;
+  G4int stack;
+  G4int subLayerID;   // 0-33 for RPC sublayers, -1 for iron
+  G4bool isGasGap;
+  G4Material* material;
+};
 
 class DetectorConstruction : public G4VUserDetectorConstruction
 {
@@ -25,10 +42,46 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     G4int    GetNumPhiCells06() const { return fNumPhiCells_MylarGrid06; }
     G4int    GetNumPhiCells714() const { return fNumPhiCells_MylarGrid714; }
     G4int    GetNumZCells() const { return fNumZCells_MylarGrid; }
+    G4int    GetNumSectors() const { return fKLMBarrelNumSides; }
+
+    // Radial structure, filled by Construct()
+    G4double GetKLMInnerRadius() const { return fKLMBarrelInnerRadius; }
+    G4double GetKLMOuterRadius() const { return fKLMBarrelOuterRadius; }
+    const std::vector<KLMRadialLayer>& GetRadialLayers() const { return fRadialLayers; }
+    G4Material* GetIronMaterial() const { return fIronMaterial; }
+
+    // Sublayer layout (same for every stack): names and which ones are gas gaps
+    const G4String& GetSublayerName(G4int subLayerID) const { return fSublayerNames[subLayerID]; }
+    G4bool IsGasSublayer(G4int subLayerID) const { return fSublayerIsGas[subLayerID]; }
+
+    // "placement": one G4Polyhedra + logical volume per sublayer (original layout)
+    // "parameterised": one shared sublayer logical volume per stack via KLMSublayerParameterisation
+    G4bool IsParameterisedLayering() const { return fParameterisedLayering; }
+
+    // Overlap checks at placement time (off by default, see GeometryCheck for the parallel validation mode)
+    void SetCheckOverlaps(G4bool check) { fCheckOverlaps = check; }
+    // Hex hash of all geometry parameters and the layering mode
+    std::string GetGeometryHash() const;
+
+    // Rebuilds the geometry in place after /klm/geometry/ parameter changes (/klm/geometry/update);
+    // materials, region, sensitive detector and fast simulation models are kept
+    void UpdateGeometry();
+    // True when /klm/geometry/ parameters were changed after the last build without an update;
+    // RunAction refuses to start a run then, as hits of the old volumes would land on the new grid
+    G4bool HasPendingChanges() const { return fBuiltParameters != ParameterKey(); }
+
+    // Sector/stack/sublayer of a touchable inside a sublayer, valid for both layering modes.
+    // sectorDepth is the touchable depth of the sector mother (its frame is the sector-local frame).
+    void DecodeTouchable(const G4VTouchable* touchable, G4int& sector, G4int& stack,
+                         G4int& subLayerID, G4int& sectorDepth) const;
 
 
   private:
     void DefineMaterials();
+    // Per-parameter sanity checks; prints the offending parameter and returns false
+    G4bool CheckParameters() const;
+    // Geometry hash plus the cell counts: everything the built geometry and its grid depend on
+    std::string ParameterKey() const;
 
     G4LogicalVolume* GetKLMSectorLayerLogical(const G4String& name,
                                               G4double innerRadius,
@@ -50,31 +103,48 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     // --- Volumes ---
     G4VPhysicalVolume* fWorldPV;
 
-    // --- Parameters from original setup ---
-  const G4int fNbIronLayers = 14;
-  const G4int fNbDetectorLayers = 15;
-  const G4double fIronThickness = 4.7 * cm;
+    G4GenericMessenger* fMessenger;
+    G4String fLayeringMode;
+    G4bool fParameterisedLayering;
+    G4bool fCheckOverlaps;
+    std::vector<G4String> fSublayerNames;
+    std::vector<G4bool> fSublayerIsGas;
+
+    // Actual outer radius and layer table of the last built geometry
+    G4double fKLMBarrelOuterRadius;
+    std::vector<KLMRadialLayer> fRadialLayers;
+    std::string fBuiltParameters;
+
+    // Created by the first ConstructSDandField and reused when the geometry is rebuilt
+    MylarSD* fMylarSD;
+    FastMuonModel* fFastMuonModel;
+    KLShowerModel* fKLShowerModel;
+
+    // --- Parameters from original setup (/klm/geometry/ commands) ---
+  G4int fNbIronLayers = 14;
+  G4int fNbDetectorLayers = 15;
+  G4double fIronThickness = 4.7 * cm;
   // const G4double fRPCStackThickness = 31.6 * mm; // Total thickness from Fig 10.2
-  const G4double fKLMBarrelInnerRadius = 201.586 * cm; 
-  const G4double fKLMBarrelHalfLength = 220.0 * cm;    
-  const G4int fKLMBarrelNumSides = 8;
+  G4double fKLMBarrelInnerRadius = 201.586 * cm; 
+  G4double fKLMBarrelHalfLength = 220.0 * cm;    
+  G4int fKLMBarrelNumSides = 8;
 
     // --- Parameters for detailed RPC Stack (from Fig 10.2) ---
     // These are individual layer thicknesses
-    const G4double t_Mylar_GP_CP = 0.25 * mm;
-    const G4double t_Copper_GP_CP = 0.035 * mm;
-    const G4double t_Foam = 7.0 * mm;
-    const G4double t_HV_Region_Glass = 3.0 * mm; // "HV" region from Fig 10.2, assumed to be Glass
-    const G4double t_GasGap = 2.0 * mm;
-    const G4double t_Mylar_Insulator = 0.5 * mm;
+    G4double t_Mylar_GP_CP = 0.25 * mm;
+    G4double t_Copper_GP_CP = 0.035 * mm;
+    G4double t_Foam = 7.0 * mm;
+    G4double t_HV_Region_Glass = 3.0 * mm; // "HV" region from Fig 10.2, assumed to be Glass
+    G4double t_GasGap = 2.0 * mm;
+    G4double t_Mylar_Insulator = 0.5 * mm;
 
-    // Total thickness of one full RPC Superlayer stack (will be calculated)
-    G4double fRPCStackThickness; // Calculated in constructor or DefineMaterials
+    // Total thickness of one full RPC Superlayer stack (calculated in Construct)
+    G4double fRPCStackThickness;
 
     // --- Mylar Grid Parameters for SD ---
-    const G4int fNumPhiCells_MylarGrid06 = 36;
-    const G4int fNumPhiCells_MylarGrid714 = 48;
-    const G4int fNumZCells_MylarGrid = 96;
+    G4int fNumPhiCells_MylarGrid06 = 36;
+    G4int fNumPhiCells_MylarGrid714 = 48;
+    G4int fNumZCells_MylarGrid = 96;
 };
 
 #endif
\ No newline at end of file
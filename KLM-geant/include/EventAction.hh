@@ -4,12 +4,18 @@
 #include "G4UserEventAction.hh"
 #include "globals.hh"
 #include <map>      // For storing energy per cell
+#include <ostream>
 #include <tuple>    // For using a tuple as a map key
+#include <vector>
+#include "KLMDigitizer.hh"
+#include "KLMClusterReco.hh"
+#include "MylarHit.hh"
 
 // Forward declarations
 class G4Event;
 class SteppingAction; // Optional
 class RunAction;
+class StackingAction;
 
 // Define a key for our energy deposition map
 // (Sector, Stack, ZCell (0-95), PhiCell (0-35))
@@ -24,14 +30,33 @@ public:
   virtual void BeginOfEventAction(const G4Event* event);
   virtual void EndOfEventAction(const G4Event* event);
 
+  // Source of the per-event track count for the telemetry (not owned)
+  void SetStackingAction(StackingAction* stackingAction) { fStackingAction = stackingAction; }
+
+  // Sums the hits of one event into cellEnergyMap and, if given, the earliest hit time per
+  // cell into cellTimeMap; returns the memory held by the hits (also used by klm_microbench)
+  static std::size_t AccumulateHits(const MylarHitsCollection& hits,
+                                    std::map<CellIdentifier, G4double>& cellEnergyMap,
+                                    std::map<CellIdentifier, G4double>* cellTimeMap);
+  // "EventID Sector Stack ZCell PhiCell Edep_keV" lines of one event (also used by klm_microbench)
+  static void WriteCells(std::ostream& out, G4int outputEventID,
+                         const std::map<CellIdentifier, G4double>& cellEnergyMap);
+
   // // Method for MylarSD to add energy to a cell (This would be if MylarSD called EventAction directly)
   // void AddEnergyToCell(const CellIdentifier& cell, G4double energy); // We will do accumulation here
 
 private:
   RunAction* fRunAction;
   SteppingAction* fSteppingAction; // Optional
+  StackingAction* fStackingAction;
   // Map to store total energy deposited in each cell for the current event
   std::map<CellIdentifier, G4double> fCellEnergyMap;
+  // Earliest hit time per cell and reused buffers, only while the digitizer is enabled
+  std::map<CellIdentifier, G4double> fCellTimeMap;
+  std::vector<KLMCellDeposit> fCellDeposits;
+  std::vector<KLMDigit> fDigits;
+  std::vector<KLMCellDeposit> fOverlayCells;
+  std::vector<KLMClusterReco::Cluster> fClusters;
   G4int fMylarHitsCollectionID; // Keep this to retrieve MylarHitsCollection
 };
 
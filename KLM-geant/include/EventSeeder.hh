@@ -0,0 +1,45 @@
+#ifndef EVENTSEEDER_HH
+#define EVENTSEEDER_HH
+
+#include "globals.hh"
+
+class G4GenericMessenger;
+
+// Deterministic per-event seeding: before each event is generated the engine
+// is reseeded from (run seed, input event index), so any single event can be
+// re-simulated on its own ("klm_barrel --replay-event N") and the result does
+// not depend on how events are split over jobs or processes.
+// The input event index counts events from the start of the input file and
+// equals the output event ID in all run modes. Configured with /klm/random/.
+class EventSeeder
+{
+public:
+  static EventSeeder* Instance();
+
+  // Called by InputGeneratorAction before each event; returns the seed used
+  G4long SeedEvent(G4int inputEvent);
+
+  void SetRunSeed(G4long runSeed) { fRunSeed = runSeed; }
+  G4long GetRunSeed() const { return fRunSeed; }
+  G4bool IsPerEvent() const { return fPerEvent; }
+
+  // Seed of the event being simulated (valid while IsPerEvent())
+  G4long GetEventSeed() const { return fEventSeed; }
+  G4int GetInputEvent() const { return fInputEvent; }
+
+  static G4long EventSeed(G4long runSeed, G4int inputEvent);
+
+private:
+  EventSeeder();
+  ~EventSeeder();
+
+  static EventSeeder* fInstance;
+
+  G4GenericMessenger* fMessenger;
+  G4long fRunSeed;
+  G4bool fPerEvent;
+  G4long fEventSeed;
+  G4int fInputEvent;
+};
+
+#endif // EVENTSEEDER_HH
@@ -0,0 +1,57 @@
+#ifndef EVENTTELEMETRY_HH
+#define EVENTTELEMETRY_HH
+
+#include "globals.hh"
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+class G4GenericMessenger;
+
+// Per-event telemetry fed by EventAction: wall time, tracks, hits, hit
+// memory and process RSS. Optionally one JSON line per event (telemetry
+// file) and a progress status file (events/s, ETA, slowest events) rewritten
+// every statusInterval seconds. The slowest N events are printed at end of
+// run. Configured with the /klm/telemetry/ commands.
+class EventTelemetry
+{
+public:
+  EventTelemetry();
+  ~EventTelemetry();
+
+  void BeginOfRun(G4int runID, G4int eventsToProcess);
+  void BeginOfEvent();
+  // eventID is the output (input-position) event ID
+  void EndOfEvent(G4int eventID, G4int nTracks, G4int nHits, std::size_t hitBytes);
+  void EndOfRun();
+
+  // Resident set size of this process in bytes (0 if unavailable)
+  static std::size_t GetResidentBytes();
+
+private:
+  void WriteStatus(G4bool final);
+  std::vector<std::pair<G4double, G4int> > SlowestEvents() const; // (seconds, eventID), slowest first
+
+  G4GenericMessenger* fMessenger;
+
+  // --- Configuration ---
+  G4String fTelemetryFileName;  // JSON lines, empty: off
+  G4String fStatusFileName;     // empty: off
+  G4double fStatusInterval;     // seconds
+  G4int fSlowestN;
+
+  // --- Run state ---
+  std::ofstream fTelemetryFile;
+  G4int fRunID;
+  G4int fEventsToProcess;
+  G4int fEventsDone;
+  G4double fLastEventSeconds;
+  std::chrono::steady_clock::time_point fRunStart;
+  std::chrono::steady_clock::time_point fEventStart;
+  std::chrono::steady_clock::time_point fLastStatus;
+  std::vector<std::pair<G4double, G4int> > fSlowest; // min-heap on seconds, size <= fSlowestN
+};
+
+#endif // EVENTTELEMETRY_HH
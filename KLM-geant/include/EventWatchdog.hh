@@ -0,0 +1,69 @@
+#ifndef EVENTWATCHDOG_HH
+#define EVENTWATCHDOG_HH
+
+#include "globals.hh"
+#include <chrono>
+#include <string>
+#include <vector>
+
+class G4Step;
+class G4GenericMessenger;
+
+// Per-event guard against runaway events (loopers, neutron cascades).
+// Steps and tracks are counted from SteppingAction and StackingAction, and
+// wall time is checked every few hundred steps. Past a limit the event is
+//   abort:    aborted (no cell output), or
+//   truncate: all remaining and new tracks are killed (partial cell output),
+// and EventAction flags it in the output with the random-engine state saved
+// at the start of the event. Configured with the /klm/watchdog/ commands.
+class EventWatchdog
+{
+public:
+  enum Reason { kNone = 0, kMaxSteps, kMaxTracks, kMaxWallTime };
+
+  EventWatchdog();
+  ~EventWatchdog();
+
+  G4bool IsActive() const { return fMaxSteps > 0 || fMaxTracks > 0 || fMaxWallTime > 0.; }
+
+  void BeginOfEvent();
+  // From StackingAction; returns true if the new track must not be stacked
+  G4bool CheckNewTrack();
+  // From SteppingAction; once triggered kills the track or aborts the event and returns true
+  G4bool CheckStep(const G4Step* step);
+
+  G4bool IsTriggered() const { return fReason != kNone; }
+  G4bool IsAbortAction() const { return fAction == "abort"; }
+  // Output comment line describing the flagged event; writes the RNG state to rngFileName
+  std::string Describe(G4int eventID, const std::string& rngFileName) const;
+  // Records the flagged event for the end-of-run summary
+  void Flag(G4int eventID);
+
+  void ResetStatistics() { fFlaggedEvents.clear(); }
+  void PrintStatistics() const;
+
+  static const char* GetReasonName(Reason reason);
+
+private:
+  void Trigger(Reason reason);
+
+  G4GenericMessenger* fMessenger;
+
+  // --- Configuration (0: unlimited) ---
+  G4long fMaxSteps;
+  G4int fMaxTracks;
+  G4double fMaxWallTime;  // seconds
+  G4String fAction;       // abort | truncate
+
+  // --- Current event ---
+  Reason fReason;
+  G4bool fAbortRequested;
+  G4long fSteps;
+  G4int fTracks;
+  std::chrono::steady_clock::time_point fEventStart;
+  std::string fRandomState;  // engine state at the start of the event
+
+  std::vector<std::pair<G4int, Reason> > fFlaggedEvents;
+};
+
+#endif // EVENTWATCHDOG_HH
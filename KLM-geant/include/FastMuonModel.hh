@@ -0,0 +1,63 @@
+#ifndef FASTMUONMODEL_HH
+#define FASTMUONMODEL_HH
+
+#include "G4VFastSimulationModel.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+#include <map>
+#include <utility>
+#include <vector>
+
+class DetectorConstruction;
+class MylarSD;
+class G4GenericMessenger;
+class G4Material;
+class G4ParticleDefinition;
+
+// Fast muon propagation through the sector structure (envelope: the KLM
+// sector mother, region "KLMSectorRegion"). Muons above a threshold are moved
+// straight from layer to layer of DetectorConstruction::GetRadialLayers() in
+// the sector frame, losing the mean total dE/dx of each layer (no secondaries)
+// and receiving a Highland multiple-scattering kick every ~scatterStep X0.
+// Gas gaps crossed get a hit with their mean deposit via MylarSD::AddHit.
+// Below the hand-back energy, or when turning inward, the muon is handed back
+// to full simulation. Off by default; /klm/fastsim/muon/ commands.
+class FastMuonModel : public G4VFastSimulationModel
+{
+public:
+  FastMuonModel(const G4String& name, G4Region* envelope,
+                const DetectorConstruction* detector, MylarSD* mylarSD);
+  virtual ~FastMuonModel();
+
+  virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+  virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+  virtual void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+  G4bool IsEnabled() const { return fEnabled; }
+
+private:
+  // Mean total (unrestricted) dE/dx, interpolated in a lazily filled log-energy table
+  G4double MeanDEDX(G4double kinE, const G4ParticleDefinition* particle, const G4Material* material);
+  // Direction after a Highland-width Gaussian kick for the given thickness in X0
+  G4ThreeVector Scatter(const G4ThreeVector& dir, G4double momentum, G4double beta,
+                        G4double charge, G4double thicknessX0) const;
+
+  const DetectorConstruction* fDetector;
+  MylarSD* fMylarSD;
+  G4GenericMessenger* fMessenger;
+
+  // --- Configuration ---
+  G4bool fEnabled;
+  G4double fEnergyThreshold;   // trigger above this kinetic energy
+  G4double fHandBackEnergy;    // return to full simulation below this kinetic energy
+  G4double fMinCosNormal;      // only tracks moving outward at least this steeply
+  G4double fScatterStepX0;     // accumulated thickness between scattering kicks
+
+  // Track handed back to full simulation: not triggered again
+  G4int fHandedBackEventID;
+  G4int fHandedBackTrackID;
+
+  std::map<std::pair<const G4ParticleDefinition*, const G4Material*>, std::vector<G4double> > fDEDXTables;
+};
+
+#endif // FASTMUONMODEL_HH
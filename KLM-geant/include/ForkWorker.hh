@@ -0,0 +1,29 @@
+#ifndef FORKWORKER_HH
+#define FORKWORKER_HH
+
+#include "globals.hh"
+#include <functional>
+#include <string>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+// One forked child of an initialised process: the child shares geometry and
+// physics tables copy-on-write, optionally writes its stdout and stderr to a
+// log, runs the body and leaves with _exit, skipping the parent's destructors
+// and atexit handlers. Its exit status is 0 if the body returned true.
+class ForkWorker
+{
+public:
+  // Returns the child's pid in the parent, -1 if fork failed
+  static pid_t Start(const std::function<G4bool()>& body, const std::string& logFileName = "");
+
+  // Waits for the child; true if it exited with status 0. usage, if given,
+  // receives its resource usage, including that of the children it waited for.
+  static G4bool Wait(pid_t pid, rusage* usage = nullptr);
+
+private:
+  // Pending output must not be written twice, by the parent and by the child
+  static void FlushAll();
+};
+
+#endif // FORKWORKER_HH
@@ -1,10 +1,11 @@
 #ifndef G4HepMCInterface_h
 #define G4HepMCInterface_h 1
 
-#include "G4VUserPrimaryGeneratorAction.hh"
+#include "InputGeneratorAction.hh"
 #include "G4String.hh"
 #include "globals.hh"
 #include "G4SystemOfUnits.hh"
+#include <fstream>
 
 
 // Forward declarations for HepMC2 classes
@@ -15,19 +16,29 @@ namespace HepMC {
 class G4Event;
 
 
-class G4HepMCInterface : public G4VUserPrimaryGeneratorAction
+class G4HepMCInterface : public InputGeneratorAction
 {
 public:
     // Constructor now takes the filename
     G4HepMCInterface(const G4String& hepmcFileName);
     virtual ~G4HepMCInterface();
 
-    // The core method called by Geant4
-    virtual void GeneratePrimaries(G4Event* anEvent);
+    // Stream position of the next "E" event line
+    virtual G4long GetInputOffset();
+
+protected:
+    // The core method, called from InputGeneratorAction::GeneratePrimaries
+    virtual void GenerateInputEvent(G4Event* anEvent);
+
+    // Reads and discards the next nEvents HepMC events
+    virtual G4int SkipInputEvents(G4int nEvents);
+    virtual G4bool SeekInput(G4long offset);
 
 private:
     // --- HepMC specific (Version 2) ---
-    HepMC::IO_GenEvent* m_asciiInput = nullptr; // HepMC file reader object
+    std::ifstream m_inputFile;                  // owned here so it can be positioned
+    HepMC::IO_GenEvent* m_asciiInput = nullptr; // HepMC file reader object, reading m_inputFile
+    G4bool m_listingStarted = false;            // the file header is parsed with the first event read
 
     // --- Helper method ---
     // Converts a given HepMC event to Geant4 primaries in the G4Event
@@ -0,0 +1,34 @@
+#ifndef GEOMETRYCHECK_HH
+#define GEOMETRYCHECK_HH
+
+#include "globals.hh"
+#include <string>
+
+class DetectorConstruction;
+
+// Validation mode behind "klm_barrel --check-geometry": checks every placed
+// volume for overlaps in N forked worker processes after /run/initialize,
+// and caches a PASS keyed by the geometry hash so unchanged geometries are
+// not re-checked. Production runs never pay for it.
+class GeometryCheck
+{
+public:
+  GeometryCheck(const DetectorConstruction* detector,
+                G4int resolution = 1000, G4double tolerance = 0.);
+  ~GeometryCheck();
+
+  // Returns true if no overlap was found (or a cached PASS matches)
+  G4bool Run(G4int nWorkers);
+
+private:
+  std::string CacheKey() const;
+  std::string CacheFileName() const;
+  G4bool IsCachedPass() const;
+  void StorePass() const;
+
+  const DetectorConstruction* fDetector;
+  G4int fResolution;
+  G4double fTolerance;
+};
+
+#endif // GEOMETRYCHECK_HH
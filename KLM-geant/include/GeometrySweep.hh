@@ -0,0 +1,54 @@
+#ifndef GEOMETRYSWEEP_HH
+#define GEOMETRYSWEEP_HH
+
+#include "globals.hh"
+#include <string>
+#include <vector>
+
+class G4RunManager;
+
+// "klm_barrel --sweep GRID": a scan over geometry (or any other UI) parameters
+// in one initialised process. The grid file has one axis per line,
+//   /klm/geometry/ironThickness 40 47 55 mm
+//   gasGapThickness 1.8 2.0 2.2 mm      (short names are /klm/geometry/ commands)
+//   /klm/fastsim/muon/enable true false
+// where the values are numbers with an optional known unit, or words; an axis
+// mixing the two is rejected. The points are all combinations, last axis
+// fastest. The parent builds the physics tables once (BeamOn(0)) and forks
+// workers that take the next free point from a shared counter until none is
+// left: per point the commands are applied, the geometry is rebuilt
+// with /klm/geometry/update and the events run as a SimulationServer job into
+// <output>.point<i>. Every point uses the same run seed, so points differ by
+// the geometry only. <output>.sweep lists each point with its parameters and
+// timing line.
+class GeometrySweep
+{
+public:
+  GeometrySweep(G4RunManager* runManager, const G4String& inputFileName);
+  ~GeometrySweep();
+
+  // Reads the grid file; false (with a message) on a malformed axis
+  G4bool LoadGrid(const G4String& gridFileName);
+
+  // eventsPerPoint < 0: all events of the input. Returns 0 if every point succeeded.
+  G4int Run(G4int nWorkers, G4int eventsPerPoint = -1);
+
+private:
+  struct Axis {
+    G4String command;
+    std::vector<G4String> values; // with the unit appended, ready for ApplyCommand
+  };
+
+  G4int NumberOfPoints() const;
+  // Commands of point iPoint and its "name=value ..." tag
+  std::vector<G4String> PointCommands(G4int iPoint, G4String& tag) const;
+  G4bool RunPoint(G4int iPoint, G4int eventsPerPoint, G4long runSeed) const;
+  std::string PointName(G4int iPoint) const;
+
+  G4RunManager* fRunManager;
+  G4String fInputFileName;
+  G4String fOutputFileName;
+  std::vector<Axis> fAxes;
+};
+
+#endif // GEOMETRYSWEEP_HH
@@ -0,0 +1,62 @@
+#ifndef GUNGENERATORACTION_HH
+#define GUNGENERATORACTION_HH
+
+#include "InputGeneratorAction.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class G4GenericMessenger;
+
+// Settings of the built-in gun, kept apart from the generator because the
+// server creates a new generator for every job. Configured with /klm/gun/.
+class GunSettings
+{
+public:
+  static GunSettings* Instance();
+
+  G4int pdgCode;
+  G4int multiplicity;     // primaries per event
+  G4int events;           // 0: unlimited
+  G4double energyMin;     // kinetic energy
+  G4double energyMax;
+  G4String spectrum;      // flat | log | power | grid
+  G4double powerIndex;    // dN/dE ~ E^-index for "power"
+  G4double thetaMin;
+  G4double thetaMax;
+  G4double phiMin;
+  G4double phiMax;
+  G4String angles;        // random (isotropic in the ranges) | grid
+  G4int nEnergy;          // grid points
+  G4int nTheta;
+  G4int nPhi;
+  G4ThreeVector vertex;
+
+private:
+  GunSettings();
+  ~GunSettings();
+
+  static GunSettings* fInstance;
+  G4GenericMessenger* fMessenger;
+};
+
+// Input "gun": primaries from GunSettings instead of a file, for throughput
+// benchmarks and efficiency scans. Energies and angles are either random
+// (flat / log / power-law spectrum, uniform in cos(theta) and phi) or a grid
+// scan that visits energy x theta x phi points in turn, the input event index
+// selecting the point. Events are seeded like file events (EventSeeder), so a
+// gun run is reproducible and can be split, replayed and resumed.
+class GunGeneratorAction : public InputGeneratorAction
+{
+  public:
+    GunGeneratorAction();
+    virtual ~GunGeneratorAction();
+
+  protected:
+    virtual void GenerateInputEvent(G4Event* anEvent);
+    virtual G4int SkipInputEvents(G4int nEvents);
+
+  private:
+    static G4double GridValue(G4double min, G4double max, G4int n, G4int i);
+};
+
+#endif // GUNGENERATORACTION_HH
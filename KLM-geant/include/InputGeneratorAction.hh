@@ -0,0 +1,56 @@
+#ifndef INPUTGENERATORACTION_HH
+#define INPUTGENERATORACTION_HH
+
+#include "G4VUserPrimaryGeneratorAction.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+// Common base of the file-driven primary generators (custom text format and
+// HepMC), so the input can be positioned without knowing its format.
+// It also keeps the input event index and seeds every event from it
+// (EventSeeder) before the derived class reads the event, and runs the
+// primary pre-filter (PrimaryFilter) around it.
+class InputGeneratorAction : public G4VUserPrimaryGeneratorAction
+{
+  public:
+    InputGeneratorAction() : G4VUserPrimaryGeneratorAction(), fNextInputEvent(0), fEndOfInput(false) {}
+    virtual ~InputGeneratorAction() {}
+
+    virtual void GeneratePrimaries(G4Event* anEvent);
+
+    // Reads past the next nEvents input events without simulating them.
+    // Returns the number actually skipped (less at end of file).
+    G4int SkipEvents(G4int nEvents);
+
+    // Index (from the start of the input) of the next event to be generated
+    G4int GetNextInputEvent() const { return fNextInputEvent; }
+
+    // True if the last GeneratePrimaries found the input exhausted and aborted the run:
+    // that event is empty and has no input event behind it
+    G4bool IsEndOfInput() const { return fEndOfInput; }
+
+    // Byte offset of the next event in the input file; -1 if the input cannot be positioned by offset
+    virtual G4long GetInputOffset() { return -1; }
+
+    // Positions at an offset taken from GetInputOffset() before input event inputEvent,
+    // without reading the events in front of it. False if the input cannot seek.
+    G4bool SeekEvent(G4int inputEvent, G4long offset);
+
+  protected:
+    // Format-specific parts
+    virtual void GenerateInputEvent(G4Event* anEvent) = 0;
+    virtual G4int SkipInputEvents(G4int nEvents) = 0;
+    virtual G4bool SeekInput(G4long /*offset*/) { return false; }
+
+    // Derived generators call this instead of generating when the input has no more events
+    void EndOfInput();
+
+    // Derived generators ask before creating each primary (false: drop it)
+    G4bool AcceptPrimary(G4int pdgCode, const G4ThreeVector& momentum, const G4ThreeVector& vertex);
+
+  private:
+    G4int fNextInputEvent;
+    G4bool fEndOfInput;
+};
+
+#endif // INPUTGENERATORACTION_HH
@@ -0,0 +1,110 @@
+#ifndef KLMCLUSTERRECO_HH
+#define KLMCLUSTERRECO_HH
+
+#include "globals.hh"
+#include "KLMDigitizer.hh" // KLMCellDeposit, KLMDigit
+#include <fstream>
+#include <vector>
+
+class G4GenericMessenger;
+
+// In-process KLM reconstruction after EventAction has summed the cells:
+//  1. 2D hits per stack: with digits, adjacent strips form 1D clusters per
+//     plane and every z cluster is paired with every phi cluster of the same
+//     (sector, stack); without the digitizer each cell is a 2D hit.
+//  2. 2D hits of one sector are clustered across stacks at most maxLayerGap
+//     apart and within zTolerance / phiTolerance (union-find on flat arrays).
+// One line per cluster goes to <output>.clusters; with writeCells false the
+// cell lines are dropped from the main output. Configured with /klm/reco/.
+class KLMClusterReco
+{
+public:
+  struct Hit2D {
+    G4int sector;
+    G4int stack;
+    G4double z;    // local z, G4 units
+    G4double phi;  // local phi from the sector centre, G4 units
+    G4double time;
+    G4double edep;
+  };
+
+  struct Cluster {
+    G4int sector;
+    G4int nLayers;
+    G4int firstLayer;
+    G4int lastLayer;
+    G4double z;    // energy-weighted centroid
+    G4double phi;
+    G4double time; // earliest hit
+    G4double edep;
+    G4int nHits;
+  };
+
+  KLMClusterReco();
+  ~KLMClusterReco();
+
+  G4bool IsEnabled() const { return fEnabled; }
+  G4bool WriteCells() const { return !fEnabled || fWriteCells; }
+
+  // Geometry of the cell grid (from DetectorConstruction)
+  void SetGeometry(G4double halfLength, G4double sectorAngle, G4int nZ, G4int nPhi06, G4int nPhi714);
+
+  void ReconstructCells(const std::vector<KLMCellDeposit>& cells, std::vector<Cluster>& clusters);
+  void ReconstructDigits(const std::vector<KLMDigit>& digits, std::vector<Cluster>& clusters);
+
+  // "EventID Sector NLayers FirstLayer LastLayer Z_mm Phi_deg Time_ns Edep_keV NHits".
+  // append: continue a file truncated to a checkpoint, without a new header.
+  G4bool OpenOutput(const G4String& fileName, G4bool append = false);
+  std::ofstream& GetOutputStream() { return fOutput; }
+  void Write(G4int eventID, const std::vector<Cluster>& clusters);
+  void CloseOutput();
+  void PrintStatistics() const;
+
+private:
+  // Run of adjacent fired strips in one plane
+  struct StripCluster {
+    G4double centre; // strip units
+    G4double time;
+    G4double edep;
+  };
+
+  G4double StripZ(G4double strip) const;
+  G4double StripPhi(G4double strip, G4int stack) const;
+  void ClusterHits(std::vector<Cluster>& clusters);
+  G4int Find(G4int i);
+
+  G4GenericMessenger* fMessenger;
+
+  // --- Configuration ---
+  G4bool fEnabled;
+  G4bool fWriteCells;
+  G4int fMaxLayerGap;
+  G4double fZTolerance;
+  G4double fPhiTolerance;
+
+  // --- Geometry ---
+  G4double fHalfLength;
+  G4double fSectorAngle;
+  G4int fNumZ;
+  G4int fNumPhi06;
+  G4int fNumPhi714;
+
+  // --- Flat per-event buffers ---
+  std::vector<Hit2D> fHits;
+  std::vector<G4int> fParent;
+  std::vector<G4int> fClusterOf;
+  std::vector<KLMDigit> fSortedDigits;
+  std::vector<StripCluster> fStripClusters[2]; // per plane, of the stack being paired
+  std::vector<unsigned long long> fLayerMasks;
+  std::vector<G4double> fSumZ;   // unweighted sums per cluster
+  std::vector<G4double> fSumPhi;
+
+  // --- Statistics ---
+  G4long fEvents;
+  G4long fClusters;
+  G4double fSeconds;
+
+  std::ofstream fOutput;
+};
+
+#endif // KLMCLUSTERRECO_HH
@@ -0,0 +1,100 @@
+#ifndef KLMDIGITIZER_HH
+#define KLMDIGITIZER_HH
+
+#include "globals.hh"
+#include <fstream>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+class G4GenericMessenger;
+
+// Energy deposit summed over one (sector, stack, zCell, phiCell) cell
+struct KLMCellDeposit {
+  G4int sector;
+  G4int stack;
+  G4int zCell;
+  G4int phiCell;
+  G4double edep;  // G4 units
+  G4double time;  // earliest hit, G4 units (0 when read back from a cell file)
+};
+
+// Fired readout strip; plane 0 reads z (strip = zCell), plane 1 reads phi (strip = phiCell)
+struct KLMDigit {
+  G4int sector;
+  G4int stack;
+  G4int plane;
+  G4int strip;
+  G4double time;
+  G4double edep;  // sum of the cells that fired the strip
+};
+
+// RPC strip digitizer: per-event cell deposits -> strip hits.
+// A cell above threshold fires the z strip and the phi strip through it, each
+// with the plane efficiency; a fired strip grows into a cluster (geometric
+// size distribution with the configured mean); times are Gaussian-smeared;
+// dead channels are dropped and strips fired twice are merged (earliest time).
+// Random numbers come from a private engine seeded per event from
+// (digitizer seed, event ID), so inline and standalone (klm_digitize)
+// digitization of the same cells agree and the simulation stream is untouched.
+// Configured with /klm/digi/.
+class KLMDigitizer
+{
+public:
+  enum Plane { kZPlane = 0, kPhiPlane = 1 };
+
+  KLMDigitizer();
+  ~KLMDigitizer();
+
+  G4bool IsEnabled() const { return fEnabled; }
+  void SetEnabled(G4bool enabled) { fEnabled = enabled; }
+
+  void SetThreshold(G4double threshold) { fThreshold = threshold; }
+  void SetEfficiency(G4double efficiency) { fEfficiency = efficiency; }
+  void SetMeanClusterSize(G4double size) { fMeanClusterSize = size; }
+  void SetTimeResolution(G4double sigma) { fTimeResolution = sigma; }
+  void SetSeed(G4long seed) { fSeed = seed; }
+  void SetStripCounts(G4int nZStrips, G4int nPhiStrips06, G4int nPhiStrips714);
+  // "sector stack plane strip" per line, '#' comments
+  G4bool LoadDeadChannels(const G4String& fileName);
+
+  void Digitize(G4int eventID, const std::vector<KLMCellDeposit>& cells, std::vector<KLMDigit>& digits);
+
+  // Text output: "EventID Sector Stack Plane Strip Time_ns Edep_keV".
+  // append: continue a file truncated to a checkpoint, without a new header.
+  G4bool OpenOutput(const G4String& fileName, G4bool append = false);
+  std::ofstream& GetOutputStream() { return fOutput; }
+  void Write(G4int eventID, const std::vector<KLMDigit>& digits);
+  void CloseOutput();
+
+private:
+  G4int NumStrips(G4int stack, G4int plane) const;
+  G4bool IsDead(G4int sector, G4int stack, G4int plane, G4int strip) const;
+  void AddStrip(const KLMCellDeposit& cell, G4int plane, G4int strip, G4double time);
+  void SetDeadChannelFile(const G4String& fileName);
+
+  G4GenericMessenger* fMessenger;
+
+  // --- Configuration ---
+  G4bool fEnabled;
+  G4double fThreshold;
+  G4double fEfficiency;
+  G4double fMeanClusterSize;
+  G4double fTimeResolution;
+  G4long fSeed;
+  G4int fNumZStrips;
+  G4int fNumPhiStrips06;
+  G4int fNumPhiStrips714;
+  std::unordered_set<G4long> fDeadChannels;
+
+  // --- Per-event work buffers (struct of arrays over touched cells) ---
+  std::mt19937_64 fEngine;
+  std::vector<G4double> fEdep;
+  std::vector<G4double> fUniform;
+  std::vector<unsigned char> fFired;  // bit 0: z plane, bit 1: phi plane
+  std::vector<KLMDigit> fStrips;
+
+  std::ofstream fOutput;
+};
+
+#endif // KLMDIGITIZER_HH
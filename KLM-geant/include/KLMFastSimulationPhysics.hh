@@ -0,0 +1,33 @@
+#ifndef KLMFASTSIMULATIONPHYSICS_HH
+#define KLMFASTSIMULATIONPHYSICS_HH
+
+#include "G4FastSimulationPhysics.hh"
+#include "globals.hh"
+
+class G4GenericMessenger;
+
+// Fast-simulation hook for muons and K_L (FastMuonModel, KLShowerModel).
+// The fast-simulation process calls ModelTrigger on every step in the
+// KLMSectorRegion, so it is only constructed when /klm/fastsim/physics true
+// is given before /run/initialize; the models are then switched per run with
+// their own commands. CheckModels() warns when a model is switched on but the
+// process was not constructed, since the model would silently never run.
+class KLMFastSimulationPhysics : public G4FastSimulationPhysics
+{
+public:
+  KLMFastSimulationPhysics();
+  virtual ~KLMFastSimulationPhysics();
+
+  virtual void ConstructProcess();
+
+  static G4bool IsConstructed() { return fConstructed; }
+  static void CheckModels();
+
+private:
+  G4GenericMessenger* fMessenger;
+  G4bool fRequested;
+
+  static G4bool fConstructed;
+};
+
+#endif // KLMFASTSIMULATIONPHYSICS_HH
@@ -0,0 +1,53 @@
+#ifndef KLMSUBLAYERPARAMETERISATION_HH
+#define KLMSUBLAYERPARAMETERISATION_HH
+
+#include "G4VPVParameterisation.hh"
+#include "G4RotationMatrix.hh"
+#include "globals.hh"
+#include <vector>
+
+// Forward declarations
+class G4VPhysicalVolume;
+class G4Material;
+class G4VisAttributes;
+class G4Trd;
+
+// Places the 34 sublayers of one RPC stack as copies of a single shared
+// logical volume (G4Trd). Copy number == subLayerID. The G4Trd is the exact
+// equivalent of the one-sided G4Polyhedra slab used in placement mode:
+// trd z is the sector-local radial axis, trd x the beam axis.
+class KLMSublayerParameterisation : public G4VPVParameterisation
+{
+public:
+  struct Sublayer {
+    G4double rMin;
+    G4double rMax;
+    G4Material* material;
+    G4VisAttributes* visAtt;
+  };
+
+  KLMSublayerParameterisation(G4int stack,
+                              const std::vector<Sublayer>& sublayers,
+                              G4double halfLength,
+                              G4double sectorAngle);
+  virtual ~KLMSublayerParameterisation();
+
+  using G4VPVParameterisation::ComputeDimensions;
+
+  virtual void ComputeTransformation(const G4int copyNo, G4VPhysicalVolume* physVol) const;
+  virtual void ComputeDimensions(G4Trd& trd, const G4int copyNo, const G4VPhysicalVolume* physVol) const;
+  virtual G4Material* ComputeMaterial(const G4int copyNo, G4VPhysicalVolume* physVol,
+                                      const G4VTouchable* parentTouch = nullptr);
+
+  G4int GetStack() const { return fStack; }
+  G4int GetNumberOfSublayers() const { return static_cast<G4int>(fSublayers.size()); }
+
+private:
+  G4int fStack;
+  std::vector<Sublayer> fSublayers;
+  G4double fHalfLength;
+  G4double fTanHalfAngle;
+  G4RotationMatrix* fRotation; // frame rotation shared by all copies
+};
+
+#endif // KLMSUBLAYERPARAMETERISATION_HH
@@ -0,0 +1,74 @@
+#ifndef KLSHOWERLIBRARY_HH
+#define KLSHOWERLIBRARY_HH
+
+#include "globals.hh"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Gas-gap response templates of fully simulated K_L showers, binned in K_L
+// kinetic energy and incidence (direction cosine to the sector normal).
+// Hit positions are offsets from the K_L entry point in the sector frame and
+// stacks are counted from the first stack at or beyond the entry point.
+//
+// File layout (little endian, native float/double):
+//   char[8] "KLSHLIB1", u32 nEnergyBins, u32 nAngleBins,
+//   f64 energyEdges[nE+1] (MeV), f64 cosEdges[nA+1],
+//   index: {u64 offset, u32 nTemplates} per bin (energy-major),
+//   payload per template: f32 energy (MeV), u32 nHits,
+//                         nHits x {i32 dStack, i32 subLayerID, f32 dy, f32 dz, f32 edep (MeV), f32 dt (ns)}
+class KLShowerLibrary
+{
+public:
+  struct Hit {
+    std::int32_t dStack;
+    std::int32_t subLayerID;
+    float dy, dz;   // mm, sector-local offsets from the entry point
+    float edep;     // MeV
+    float dt;       // ns after the entry time
+  };
+  struct Template {
+    float energy;   // K_L kinetic energy at entry (MeV)
+    std::vector<Hit> hits;
+  };
+
+  KLShowerLibrary();
+  ~KLShowerLibrary();
+
+  // Resets the library to an empty one with the given bin edges (G4 units)
+  void SetBinning(const std::vector<G4double>& energyEdges, const std::vector<G4double>& cosEdges);
+
+  // Bin index, -1 outside the binning
+  G4int FindBin(G4double kinE, G4double cosNormal) const;
+
+  void AddTemplate(G4int bin, const Template& shower);
+  // Uniformly chosen template of the bin, nullptr if the bin is empty
+  const Template* Sample(G4int bin) const;
+  std::size_t GetNumberOfTemplates(G4int bin) const;
+  std::size_t GetTotalNumberOfTemplates() const;
+
+  const std::vector<G4double>& GetEnergyEdges() const { return fEnergyEdges; }
+  const std::vector<G4double>& GetCosEdges() const { return fCosEdges; }
+
+  // Appends the templates of other bin by bin; false if the binning differs
+  G4bool Append(const KLShowerLibrary& other);
+
+  G4bool Read(const std::string& fileName);
+  G4bool Write(const std::string& fileName) const;
+
+  // Appends the templates of each addition, in order, to the library file
+  // under an exclusive lock on <file>.lock, so that concurrent writers (fork
+  // workers, several servers) never drop each other's templates. A missing
+  // file is created with the binning of the first addition. merged, if given,
+  // receives the library as written.
+  static G4bool AppendToFile(const std::string& fileName,
+                             const std::vector<const KLShowerLibrary*>& additions,
+                             KLShowerLibrary* merged = nullptr);
+
+private:
+  std::vector<G4double> fEnergyEdges;
+  std::vector<G4double> fCosEdges;
+  std::vector<std::vector<Template> > fBins;
+};
+
+#endif // KLSHOWERLIBRARY_HH
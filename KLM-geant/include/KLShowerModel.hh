@@ -0,0 +1,104 @@
+#ifndef KLSHOWERMODEL_HH
+#define KLSHOWERMODEL_HH
+
+#include "G4VFastSimulationModel.hh"
+#include "G4AffineTransform.hh"
+#include "G4ThreeVector.hh"
+#include "MylarHit.hh"
+#include "KLShowerLibrary.hh"
+#include "globals.hh"
+#include <map>
+#include <utility>
+#include <vector>
+
+class DetectorConstruction;
+class MylarSD;
+class G4GenericMessenger;
+
+// Shower-library fast simulation for K_L in the KLM sectors (envelope: the
+// sector mother, region "KLMSectorRegion"), controlled by /klm/fastsim/kl/.
+//   record: K_L are fully simulated; the gas-gap hits of the sector the first
+//           K_L of the event enters become a template (EventAction calls
+//           EndOfEvent), the library is written at end of run.
+//   sample: a K_L is replaced by a random template of its (energy, angle) bin
+//           and killed; its energy is deposited in the envelope.
+// With fullSimLayers N the K_L is fully simulated through the first N iron
+// plates and the library takes over behind them, in both modes.
+class KLShowerModel : public G4VFastSimulationModel
+{
+public:
+  KLShowerModel(G4Region* envelope, const DetectorConstruction* detector, MylarSD* mylarSD);
+  virtual ~KLShowerModel();
+
+  // The instance registered with the fast simulation manager, if any
+  static KLShowerModel* Find();
+
+  virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+  virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+  virtual void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+  // Record mode hooks (from EventAction / RunAction)
+  void EndOfEvent(G4int eventID, const MylarHitsCollection* hits);
+  void EndOfRun();
+
+  G4bool IsRecording() const { return fMode == "record"; }
+  const G4String& GetLibraryFile() const { return fLibraryFile; }
+  // Fork workers: write the recorded templates to this file instead of the
+  // library; the parent appends the files to the library in worker order
+  void SetRecordOutput(const G4String& fileName) { fRecordOutput = fileName; }
+
+  // Recording or sampling
+  G4bool IsActive() const { return fMode != "off"; }
+
+  // Drops the cached layer table (the geometry was rebuilt)
+  void GeometryChanged() { fGeometryCached = false; }
+
+private:
+  G4bool IsSampling() const { return fMode == "sample"; }
+  G4bool PrepareLibrary();
+  void CacheGeometry();
+  // First stack with a gas gap at or beyond the sector-local radius x, -1 if none
+  G4int EntryStack(G4double x) const;
+
+  const DetectorConstruction* fDetector;
+  MylarSD* fMylarSD;
+  G4GenericMessenger* fMessenger;
+
+  // --- Configuration ---
+  G4String fMode;              // off | record | sample
+  G4String fLibraryFile;
+  G4String fEnergyBins;        // GeV edges, used when recording a new library
+  G4String fAngleBins;         // cos(normal) edges
+  G4int fFullSimLayers;
+  G4double fMinEnergy;
+
+  // --- Library ---
+  KLShowerLibrary fLibrary;
+  G4String fLoadedFile;        // library file currently in memory
+  KLShowerLibrary fRecorded;   // templates recorded since the last write, same binning
+  G4String fRecordOutput;
+  G4bool fLibraryModified;
+
+  // --- Geometry (sector frame) ---
+  G4bool fGeometryCached;
+  G4int fCachedFullSimLayers;
+  G4double fFullSimBoundary;   // sector-local radius behind the first fFullSimLayers iron plates
+  std::vector<std::pair<G4double, G4int> > fGasLayerStarts; // (rMin, stack) of every gas gap, sorted
+  std::map<std::pair<G4int, G4int>, G4double> fGasRadius;   // (stack, subLayerID) -> mid radius
+  std::map<G4String, G4int> fGasSublayerIDs;                // sublayer name -> ID
+
+  // --- Record state of the current event ---
+  G4int fRecordEventID;
+  G4int fRecordSector;
+  G4int fRecordStack;
+  G4int fRecordBin;
+  G4double fRecordEnergy;
+  G4double fRecordTime;
+  G4ThreeVector fRecordEntry;
+  G4AffineTransform fRecordToLocal;
+
+  G4long fSampledShowers;
+  G4long fRecordedShowers;
+};
+
+#endif // KLSHOWERMODEL_HH
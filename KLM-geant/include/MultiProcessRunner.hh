@@ -0,0 +1,39 @@
+#ifndef MULTIPROCESSRUNNER_HH
+#define MULTIPROCESSRUNNER_HH
+
+#include "globals.hh"
+#include <string>
+#include <vector>
+
+class G4RunManager;
+
+// "klm_barrel --fork N": multi-core running without Geant4 MT. The parent
+// initialises geometry and builds the physics tables (BeamOn(0)), then forks
+// N workers that share that state copy-on-write. Each worker simulates a
+// disjoint, contiguous range of input events as a SimulationServer job into
+// <output>.part<i> (log in <output>.worker<i>.log); the parent concatenates
+// the parts in order into the RunAction output file, and the parts' .digits
+// and .clusters into <output>.digits and <output>.clusters. Events are seeded per
+// input event (EventSeeder), so the merged output does not depend on N.
+class MultiProcessRunner
+{
+public:
+  MultiProcessRunner(G4RunManager* runManager, const G4String& inputFileName);
+  ~MultiProcessRunner();
+
+  // maxEvents < 0: all events of the input. Returns 0 on success.
+  G4int Run(G4int nWorkers, G4int maxEvents = -1);
+
+private:
+  G4int CountInputEvents(G4int maxEvents, std::vector<G4long>& offsets) const;
+  G4bool MergeParts(G4int nParts) const;
+  G4bool MergePartFiles(G4int nParts, const std::string& suffix) const;
+  G4bool MergeShowerLibraryParts(G4int nParts) const;
+  std::string PartName(G4int iWorker) const;
+
+  G4RunManager* fRunManager;
+  G4String fInputFileName;
+  G4String fOutputFileName;
+};
+
+#endif // MULTIPROCESSRUNNER_HH
@@ -9,6 +9,8 @@
 class G4Step;
 class G4HCofThisEvent;
 class DetectorConstruction; // To get dimensions
+class G4GenericMessenger;
+class G4Track;
 
 class MylarSD : public G4VSensitiveDetector
 {
@@ -29,9 +31,36 @@ public:
   // Called at the end of each event (optional)
   // virtual void EndOfEvent(G4HCofThisEvent* hce);
 
+  // Gas-gap hit from a fast simulation model (no G4Step); localPos is in the sector frame.
+  // Applies the readout window and gas-sublayer filter like ProcessHits.
+  G4bool AddHit(G4int sectorNumber, G4int stackNumber, G4int subLayerID,
+                const G4ThreeVector& localPos, const G4ThreeVector& globalPos,
+                G4double edep, G4double hitTime, const G4Track* track);
+
+  // Hits outside the readout time window, per run
+  void ResetStatistics() { fHitsOutsideWindow = 0; }
+  G4long GetHitsOutsideWindow() const { return fHitsOutsideWindow; }
+
+  // Z/phi grid cell of a sector-local point (-1 outside the grid), as assigned to every hit
+  // (also timed by klm_microbench)
+  void ComputeCells(const G4ThreeVector& localPos, G4int stackNumber,
+                    G4int& zCell, G4int& phiCell) const;
+  // Cell arithmetic of ComputeCells without the geometry lookup
+  static void CellsOf(const G4ThreeVector& localPos, G4double klmHalfZ, G4double sectorAngle,
+                      G4int numZCells, G4int numPhiCells, G4int& zCell, G4int& phiCell);
+
 private:
+  // Mylar layer type tag from the (placement-mode) logical volume name
+  static G4String LayerTypeOf(const G4String& volumeName);
+
   MylarHitsCollection* fHitsCollection;
   DetectorConstruction* fDetConstruction; // To get KLM dimensions for grid
+
+  // Readout window on the hit global time (/klm/sd/ commands)
+  G4GenericMessenger* fMessenger;
+  G4double fReadoutWindowMin;
+  G4double fReadoutWindowMax;
+  G4long fHitsOutsideWindow;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef PHYSICSTABLECACHE_HH
+#define PHYSICSTABLECACHE_HH
+
+#include "G4VStateDependent.hh"
+#include "globals.hh"
+#include <string>
+
+class G4VUserPhysicsList;
+
+// Stores the physics tables built by the first run in <cacheRoot>/<key hash>/
+// and retrieves them in later jobs with the same physics list, Geant4 version,
+// production cuts and material table. The full key text is stored next to the
+// tables and compared verbatim before use, so a stale or partially written
+// cache is never picked up. Works on G4 state transitions, like StartupProfiler:
+//   Idle -> Init (first BeamOn, before BuildPhysicsTable): retrieve if valid
+//   Init -> Idle (tables built): store if nothing was retrieved
+class PhysicsTableCache : public G4VStateDependent
+{
+public:
+  PhysicsTableCache(G4VUserPhysicsList* physicsList,
+                    const G4String& physicsListName,
+                    const G4String& cacheRoot);
+  virtual ~PhysicsTableCache();
+
+  virtual G4bool Notify(G4ApplicationState requestedState);
+
+private:
+  std::string BuildKeyText() const;
+  static std::string HashText(const std::string& text);
+  void PrepareRetrieval();
+  void Store();
+
+  G4VUserPhysicsList* fPhysicsList;
+  G4String fPhysicsListName;
+  G4String fCacheRoot;
+
+  std::string fKeyText;
+  std::string fCacheDir;
+  G4bool fPrepared;
+  G4bool fRetrieved;
+  G4bool fDone;
+};
+
+#endif // PHYSICSTABLECACHE_HH
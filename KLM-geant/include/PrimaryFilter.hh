@@ -0,0 +1,77 @@
+#ifndef PRIMARYFILTER_HH
+#define PRIMARYFILTER_HH
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include <array>
+#include <set>
+
+class G4GenericMessenger;
+
+// Pre-filter of input primaries, applied by the generators before a particle
+// is handed to Geant4. A primary is dropped if its PDG code is vetoed, its
+// momentum is below threshold (charged / neutral) or its straight line from
+// the vertex leaves the barrel inner polyhedron through |z| > halfLength
+// (+ margin); there is no magnetic field in this setup, so lines are exact
+// up to scattering. An event without any kept primary is simulated empty and
+// flagged "# filtered event ..." by EventAction, so input and output event
+// IDs stay aligned. Configured with /klm/filter/.
+class PrimaryFilter
+{
+public:
+  enum RejectReason { kVetoedType = 0, kBelowMomentum, kOutsideAcceptance, kNumRejectReasons };
+
+  static PrimaryFilter* Instance();
+
+  G4bool IsEnabled() const { return fEnabled; }
+
+  // Around the primaries of one input event
+  void BeginEvent();
+  void EndEvent();
+  G4bool Accept(G4int pdgCode, const G4ThreeVector& momentum, const G4ThreeVector& vertex);
+
+  // Status of the last generated event
+  G4bool LastEventFiltered() const { return fEnabled && fEventPrimaries > 0 && fEventKept == 0; }
+  G4int GetLastEventPrimaries() const { return fEventPrimaries; }
+
+  void ResetStatistics();
+  void PrintStatistics() const;
+
+  static const char* GetReasonName(RejectReason reason);
+
+private:
+  PrimaryFilter();
+  ~PrimaryFilter();
+
+  G4bool InAcceptance(const G4ThreeVector& momentum, const G4ThreeVector& vertex);
+  void CacheGeometry();
+  void SetVetoedPDGCodes(const G4String& codes);
+
+  static PrimaryFilter* fInstance;
+
+  G4GenericMessenger* fMessenger;
+
+  // --- Configuration ---
+  G4bool fEnabled;
+  G4double fMinMomentumCharged;
+  G4double fMinMomentumNeutral;
+  G4double fAcceptanceMargin;
+  std::set<G4int> fVetoedPDGCodes;  // compared by |PDG code|
+
+  // --- Geometry (from DetectorConstruction) ---
+  G4bool fGeometryCached;
+  G4double fInnerRadius;
+  G4double fHalfLength;
+  G4int fNumSectors;
+
+  // --- Current event and statistics ---
+  G4int fEventPrimaries;
+  G4int fEventKept;
+  G4long fEventsSeen;
+  G4long fEventsFiltered;
+  G4long fPrimariesSeen;
+  G4long fPrimariesKept;
+  std::array<G4long, kNumRejectReasons> fRejected;
+};
+
+#endif // PRIMARYFILTER_HH
@@ -1,7 +1,7 @@
 #ifndef PRIMARYGENERATORACTION_HH
 #define PRIMARYGENERATORACTION_HH
 
-#include "G4VUserPrimaryGeneratorAction.hh"
+#include "InputGeneratorAction.hh"
 #include "globals.hh"
 #include <fstream> // Required for ifstream
 #include <string>  // Required for string
@@ -18,14 +18,22 @@ struct ParticleData { // Keep this structure
     bool isValid = false;
 };
 
-class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
+class PrimaryGeneratorAction : public InputGeneratorAction
 {
   public:
     // Constructor only takes filename for custom format
     PrimaryGeneratorAction(const G4String& filename = "particles.txt");
     virtual ~PrimaryGeneratorAction();
 
-    virtual void GeneratePrimaries(G4Event* anEvent);
+    // One custom-format line into data (also used by klm_microbench); false if it does not parse
+    static G4bool ParseParticleLine(const std::string& line, ParticleData& data);
+
+    virtual G4long GetInputOffset();
+
+  protected:
+    virtual void GenerateInputEvent(G4Event* anEvent);
+    virtual G4int SkipInputEvents(G4int nEvents);
+    virtual G4bool SeekInput(G4long offset);
 
   private:
     // Members ONLY for Custom File Format
@@ -33,6 +41,8 @@ class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
     ParticleData fNextCustomParticleData;
     G4bool fCustomFileEOF;
     G4bool fCustomFileFirstCall;
+    G4long fCustomReadOffset;      // byte offset of the next unread line
+    G4long fNextCustomLineOffset;  // byte offset of the look-ahead line in fNextCustomParticleData
     G4bool ReadNextCustomParticle(); // Method to read custom file
 };
 
@@ -6,6 +6,14 @@
 #include <fstream> // For std::ofstream
 
 class G4Run;
+class TrackKiller;
+class StepProfiler;
+class EventTelemetry;
+class EventWatchdog;
+class RunCheckpoint;
+class KLMDigitizer;
+class BackgroundOverlay;
+class KLMClusterReco;
 
 class RunAction : public G4UserRunAction
 {
@@ -17,11 +25,63 @@ public:
   virtual void EndOfRunAction(const G4Run* run);
 
   std::ofstream& GetOutputFileStream() { return fOutputFile; }
+
+  // Takes effect at the next BeginOfRunAction (used by the server between jobs)
+  void SetOutputFileName(const G4String& name) { fOutputFileName = name; }
+  const G4String& GetOutputFileName() const { return fOutputFileName; }
+  G4int GetLastRunNumberOfEvents() const { return fLastRunNumberOfEvents; }
+
+  // Added to G4 event IDs in the output, so runs over an input range write input positions
+  void SetEventIDOffset(G4int offset) { fEventIDOffset = offset; }
+  G4int GetEventIDOffset() const { return fEventIDOffset; }
+
+  // Takes ownership; statistics are reset/printed at begin/end of run
+  void SetTrackKiller(TrackKiller* trackKiller) { fTrackKiller = trackKiller; }
+  TrackKiller* GetTrackKiller() const { return fTrackKiller; }
+  // Takes ownership; reset/printed at begin/end of run like the track killer
+  void SetStepProfiler(StepProfiler* stepProfiler) { fStepProfiler = stepProfiler; }
+  // Takes ownership; EventAction feeds it per event
+  void SetEventTelemetry(EventTelemetry* telemetry) { fEventTelemetry = telemetry; }
+  EventTelemetry* GetEventTelemetry() const { return fEventTelemetry; }
+  // Takes ownership; flagged events are listed at end of run
+  void SetEventWatchdog(EventWatchdog* watchdog) { fEventWatchdog = watchdog; }
+  EventWatchdog* GetEventWatchdog() const { return fEventWatchdog; }
+  // Takes ownership; EventAction reports each written event to it
+  void SetRunCheckpoint(RunCheckpoint* checkpoint) { fRunCheckpoint = checkpoint; }
+  RunCheckpoint* GetRunCheckpoint() const { return fRunCheckpoint; }
+  // Takes ownership; writes <output>.digits when enabled
+  void SetKLMDigitizer(KLMDigitizer* digitizer) { fKLMDigitizer = digitizer; }
+  KLMDigitizer* GetKLMDigitizer() const { return fKLMDigitizer; }
+  // Takes ownership; EventAction mixes its frames into every event
+  void SetBackgroundOverlay(BackgroundOverlay* overlay) { fBackgroundOverlay = overlay; }
+  BackgroundOverlay* GetBackgroundOverlay() const { return fBackgroundOverlay; }
+  // Takes ownership; writes <output>.clusters when enabled
+  void SetKLMClusterReco(KLMClusterReco* clusterReco) { fKLMClusterReco = clusterReco; }
+  KLMClusterReco* GetKLMClusterReco() const { return fKLMClusterReco; }
+
+  // Next run truncates the output to this size and appends (resume); < 0: new file
+  void SetResumeOutputBytes(long long bytes) { fResumeOutputBytes = bytes; }
+  // The same for <output>.digits and <output>.clusters
+  void SetResumeDigitsBytes(long long bytes) { fResumeDigitsBytes = bytes; }
+  void SetResumeClustersBytes(long long bytes) { fResumeClustersBytes = bytes; }
   // bool IsFirstEvent() const { return fIsFirstEventFlagsSetForEvent0; } // Optional helper
 
 private:
   std::ofstream fOutputFile;
   G4String fOutputFileName;
+  TrackKiller* fTrackKiller;
+  StepProfiler* fStepProfiler;
+  EventTelemetry* fEventTelemetry;
+  EventWatchdog* fEventWatchdog;
+  RunCheckpoint* fRunCheckpoint;
+  KLMDigitizer* fKLMDigitizer;
+  BackgroundOverlay* fBackgroundOverlay;
+  KLMClusterReco* fKLMClusterReco;
+  long long fResumeOutputBytes;
+  long long fResumeDigitsBytes;
+  long long fResumeClustersBytes;
+  G4int fLastRunNumberOfEvents;
+  G4int fEventIDOffset;
   // bool fIsFirstEventFlagsSetForEvent0; // Optional
 };
 
@@ -0,0 +1,61 @@
+#ifndef RUNCHECKPOINT_HH
+#define RUNCHECKPOINT_HH
+
+#include "globals.hh"
+#include <chrono>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+class G4RunManager;
+class G4GenericMessenger;
+
+// Periodic checkpoints of a run, for pre-emptible batch slots.
+// <output>.ckpt records the next input event, the events done, the flushed
+// size of the output and of each side output (digits, ...) and the run seed;
+// <output>.ckpt.rndm holds the engine state.
+// Both are replaced atomically and removed when the run ends normally.
+// "klm_barrel --resume" (Resume) truncates the output to the recorded size,
+// skips the completed input events and appends the rest of the run.
+// Off by default; enabled with /klm/checkpoint/ or "klm_barrel --checkpoint".
+class RunCheckpoint
+{
+public:
+  RunCheckpoint();
+  ~RunCheckpoint();
+
+  G4bool IsActive() const { return fEveryEvents > 0 || fEverySeconds > 0.; }
+
+  void BeginOfRun(const G4String& outputFileName, G4int nToProcess, G4int eventIDOffset);
+  // A further file of this run, recorded as "<key> <flushed bytes>"; cleared by BeginOfRun
+  void AddOutput(const G4String& key, std::ofstream* output) { fSideOutputs.emplace_back(key, output); }  // After the event has been written; writes a checkpoint when one is due
+  void EndOfEvent(std::ofstream& output, G4int nextInputEvent);
+  void EndOfRun();
+
+  // Continues the run recorded in <output>.ckpt of the RunAction output.
+  // Returns 0 on success.
+  static G4int Resume(G4RunManager* runManager, const G4String& inputFileName);
+
+private:
+  void Write(std::ofstream& output, G4int nextInputEvent);
+
+  G4GenericMessenger* fMessenger;
+
+  // --- Configuration (0: off) ---
+  G4int fEveryEvents;
+  G4double fEverySeconds;
+
+  // --- Current run ---
+  G4String fCheckpointFileName;
+  G4int fEventsRequested;
+  G4int fEventsDone;
+  G4int fEventIDOffset;
+  G4int fEventsSinceCheckpoint;
+  std::vector<std::pair<G4String, std::ofstream*>> fSideOutputs;
+  std::chrono::steady_clock::time_point fLastCheckpoint;
+
+  // Events already done before a resumed run (set by Resume)
+  G4int fEventsDoneBefore;
+};
+
+#endif // RUNCHECKPOINT_HH
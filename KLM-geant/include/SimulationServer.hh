@@ -0,0 +1,46 @@
+#ifndef SIMULATIONSERVER_HH
+#define SIMULATIONSERVER_HH
+
+#include "globals.hh"
+#include <string>
+
+class G4RunManager;
+class RunAction;
+
+// Long-lived mode behind "klm_barrel --server SOCKET" / "--spool DIR":
+// geometry and physics are initialised once, then jobs are run back to back.
+// A job is one line of key=value tokens:
+//   input=<file> output=<file> [first=<n>] [offset=<bytes>] [count=<n>] [id=<name>] [seed=<n>]
+// "first" input events are skipped and up to "count" (default: all) are
+// simulated with one BeamOn; output event IDs count from the start of the
+// input. "offset", the byte offset of event "first" in the input file,
+// lets the server seek there instead of reading the events in front of it. Each job writes its own RunAction output and a timing line to
+// <output>.timing; over the socket the same line is the reply.
+// The RNG and the EventSeeder run seed are reset to their start-up values
+// (or "seed" becomes the run seed) for every job, so a job gives the same
+// output as a fresh klm_barrel process.
+class SimulationServer
+{
+public:
+  explicit SimulationServer(G4RunManager* runManager);
+  ~SimulationServer();
+
+  // Unix domain socket, one client at a time, one job per line; "shutdown" stops
+  G4int ServeSocket(const G4String& socketPath);
+
+  // Polls DIR for *.job files: renamed to .running, then .done or .failed
+  // with the timing line appended. A file named "shutdown" stops the server.
+  G4int ServeSpool(const G4String& spoolDir);
+
+  // Runs one job line and returns the report line ("OK ..." or "ERROR ...")
+  std::string RunJob(const std::string& jobLine);
+
+private:
+  RunAction* fRunAction;
+  G4RunManager* fRunManager;
+  std::string fInitialRandomState;
+  G4long fInitialRunSeed;
+  G4int fJobsRun;
+};
+
+#endif // SIMULATIONSERVER_HH
@@ -0,0 +1,34 @@
+#ifndef STACKINGACTION_HH
+#define STACKINGACTION_HH
+
+#include "G4UserStackingAction.hh"
+#include "globals.hh"
+
+// Forward declarations
+class G4Track;
+class TrackKiller;
+class EventWatchdog;
+
+class StackingAction : public G4UserStackingAction
+{
+public:
+  // The TrackKiller is shared with SteppingAction and owned by RunAction
+  StackingAction(TrackKiller* trackKiller = nullptr);
+  virtual ~StackingAction();
+
+  virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track);
+  virtual void PrepareNewEvent();
+
+  // Optional per-event budget guard (not owned, see RunAction)
+  void SetEventWatchdog(EventWatchdog* watchdog) { fEventWatchdog = watchdog; }
+
+  // Tracks offered to the stack in the current event (primaries included, killed ones too)
+  G4int GetTracksThisEvent() const { return fTracksThisEvent; }
+
+private:
+  TrackKiller* fTrackKiller;
+  EventWatchdog* fEventWatchdog;
+  G4int fTracksThisEvent;
+};
+
+#endif // STACKINGACTION_HH
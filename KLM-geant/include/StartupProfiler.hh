@@ -0,0 +1,69 @@
+#ifndef STARTUPPROFILER_HH
+#define STARTUPPROFILER_HH
+
+#include "G4VStateDependent.hh"
+#include "globals.hh"
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Wall/CPU time of each startup phase of klm_barrel.
+// Explicit phases are timed with StartupProfiler::Scope; /run/initialize and the
+// physics-table build of the first run are timed from G4 state transitions.
+// The breakdown is printed as a table and written as JSON once the first run's
+// physics tables are ready (or at the end of main if no run happened).
+class StartupProfiler : public G4VStateDependent
+{
+public:
+  static StartupProfiler* Instance();
+
+  // RAII timer for one phase
+  class Scope {
+  public:
+    explicit Scope(const G4String& phase);
+    ~Scope();
+  private:
+    G4String fPhase;
+    std::chrono::steady_clock::time_point fWallStart;
+    std::clock_t fCpuStart;
+  };
+
+  void AddPhase(const G4String& phase, G4double wallSeconds, G4double cpuSeconds);
+
+  virtual G4bool Notify(G4ApplicationState requestedState);
+
+  void SetReportFileName(const G4String& fileName) { fReportFileName = fileName; }
+  // Prints the table and writes the JSON report (only once)
+  void Report();
+
+private:
+  StartupProfiler();
+  virtual ~StartupProfiler();
+
+  struct Phase {
+    G4String name;
+    G4double wallSeconds;
+    G4double cpuSeconds;
+    G4int calls;
+  };
+  Phase* FindPhase(const G4String& name);
+  G4double PhaseWall(const G4String& name);
+  G4double PhaseCpu(const G4String& name);
+
+  static StartupProfiler* fInstance;
+
+  std::vector<Phase> fPhases; // in order of first occurrence
+  G4String fReportFileName;
+  G4bool fReported;
+
+  std::chrono::steady_clock::time_point fProcessStart;
+  // State-transition timing
+  G4bool fInInitialize;
+  G4bool fInPhysicsTables;
+  G4bool fPhysicsTablesDone;
+  std::chrono::steady_clock::time_point fTransitionWall;
+  std::clock_t fTransitionCpu;
+};
+
+#endif // STARTUPPROFILER_HH
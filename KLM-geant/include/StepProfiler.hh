@@ -0,0 +1,76 @@
+#ifndef STEPPROFILER_HH
+#define STEPPROFILER_HH
+
+#include "globals.hh"
+#include <chrono>
+#include <cstddef>
+#include <unordered_map>
+
+// Forward declarations
+class G4Step;
+class G4Track;
+class G4LogicalVolume;
+class G4ParticleDefinition;
+class G4VProcess;
+class G4GenericMessenger;
+
+// Opt-in step accounting from SteppingAction: steps, track length and
+// sampled wall time per (volume, particle, step-limiting process).
+// Every Nth step is timed from the end of the previous step of the same
+// track to its own end, and scaled by N; intervals that would cross a
+// track or event boundary are never charged, so the first step of each
+// track is not timed. At end of run a sorted table is printed and all rows go to
+// a CSV file. Configured with the /klm/profile/steps/ commands.
+class StepProfiler
+{
+public:
+  StepProfiler();
+  ~StepProfiler();
+
+  G4bool IsEnabled() const { return fEnabled; }
+  void RecordStep(const G4Step* step);
+
+  void ResetStatistics();
+  void PrintStatistics() const;
+
+private:
+  struct Key {
+    const G4LogicalVolume* volume;
+    G4int replica;            // stack*100 + sublayer in the shared parameterised sublayer LV, else -1
+    const G4ParticleDefinition* particle;
+    const G4VProcess* process;
+    bool operator==(const Key& other) const {
+      return volume == other.volume && replica == other.replica &&
+             particle == other.particle && process == other.process;
+    }
+  };
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const;
+  };
+  struct Counters {
+    G4long steps = 0;
+    G4double trackLength = 0.;
+    G4double sampledSeconds = 0.;
+  };
+
+  G4String VolumeName(const Key& key) const;
+
+  G4GenericMessenger* fMessenger;
+
+  // --- Configuration ---
+  G4bool fEnabled;
+  G4int fSampleEvery;
+  G4int fTableRows;
+  G4String fCsvFileName;
+
+  // --- Accumulators ---
+  std::unordered_map<Key, Counters, KeyHash> fCounters;
+  G4long fStepCounter;
+  G4bool fTimingPending;
+  const G4Track* fTimedTrack;   // track whose next step is being timed
+  G4int fTimedStepNumber;       // step number that opened the interval
+  std::chrono::steady_clock::time_point fSampleStart;
+  const G4LogicalVolume* fSharedSublayerLV;
+};
+
+#endif // STEPPROFILER_HH
@@ -8,6 +8,9 @@
 // Forward declarations
 class G4Step;
 class G4LogicalVolume;
+class TrackKiller;
+class StepProfiler;
+class EventWatchdog;
 
 class SteppingAction : public G4UserSteppingAction
 {
@@ -15,7 +18,8 @@ public:
   // Constructor needs access to the RPC material name or pointer,
   // and potentially other classes like EventAction if needed.
   // Let's pass the material name for simplicity.
-  SteppingAction(const G4String& rpcMaterialName);
+  // An empty material name disables the kill-after-RPC behaviour.
+  SteppingAction(const G4String& rpcMaterialName = "");
   virtual ~SteppingAction();
 
   // Method called at the end of every step
@@ -24,8 +28,18 @@ public:
   // Method called at the beginning of each event (to clear the set)
   void Reset();
 
+  // Optional geometry-aware killer (not owned, see RunAction)
+  void SetTrackKiller(TrackKiller* trackKiller) { fTrackKiller = trackKiller; }
+  // Optional step profiler (not owned, see RunAction)
+  void SetStepProfiler(StepProfiler* stepProfiler) { fStepProfiler = stepProfiler; }
+  // Optional per-event budget guard (not owned, see RunAction)
+  void SetEventWatchdog(EventWatchdog* watchdog) { fEventWatchdog = watchdog; }
+
 private:
   G4String fRpcMaterialName;
+  TrackKiller* fTrackKiller;
+  StepProfiler* fStepProfiler;
+  EventWatchdog* fEventWatchdog;
   // Use a set to store track IDs that have already entered the RPC layer ONCE
   // We use a static member for simplicity in this example,
   // but managing this via EventAction is often cleaner for MT runs.
@@ -0,0 +1,95 @@
+#ifndef TRACKKILLER_HH
+#define TRACKKILLER_HH
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include <array>
+#include <ctime>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Forward declarations
+class G4Step;
+class G4Track;
+class G4Material;
+class G4ParticleDefinition;
+class G4GenericMessenger;
+class G4Region;
+class G4EmCalculator;
+
+// Kills tracks that can no longer contribute to a (readout-window) gas-gap hit.
+// Used from both StackingAction (new tracks) and SteppingAction (every step).
+// Configured with the /klm/killer/ commands.
+class TrackKiller
+{
+public:
+  enum KillReason {
+    kLeftBarrelRadially = 0, // outside the barrel outer radius, moving outward
+    kLeftBarrelAlongZ,       // beyond |z| > halfLength, moving away
+    kRangedOutInIron,        // charged particle whose range is shorter than the distance to any gas gap
+    kOutsideTimeWindow,      // global time beyond the time cut of the current region
+    kNumKillReasons
+  };
+
+  TrackKiller();
+  ~TrackKiller();
+
+  // Returns true if a freshly created track should not be stacked
+  G4bool CheckNewTrack(const G4Track* track);
+
+  // Kills the stepping track (fStopAndKill) and returns true if one of the criteria fires
+  G4bool CheckStep(const G4Step* step);
+
+  void ResetStatistics();
+  void PrintStatistics() const;
+
+  static const char* GetReasonName(KillReason reason);
+
+  // "<region> <value> <unit>", e.g. "KLMSectorRegion 200 ns"
+  void SetRegionTimeCut(const G4String& args);
+
+private:
+  G4bool ShouldKill(const G4ThreeVector& pos, const G4ThreeVector& dir, G4double kinE,
+                    G4double globalTime, const G4Region* region,
+                    const G4ParticleDefinition* particle, const G4Material* material,
+                    KillReason& reason);
+  G4double TimeCutFor(const G4Region* region) const;
+  G4double DistanceToNearestGasGap(const G4ThreeVector& pos) const;
+  G4double LocalRadius(const G4ThreeVector& pos, G4int iSector) const;
+  G4int SectorOf(const G4ThreeVector& pos) const;
+  void CacheGeometry();
+  void Count(KillReason reason, G4double kinE);
+
+  G4GenericMessenger* fMessenger;
+  G4EmCalculator* fEmCalculator; // built on the first range query, reused for every step
+
+  // --- Configuration ---
+  G4bool fEnabled;
+  G4bool fKillOutsideEnvelope;
+  G4bool fKillRangedOut;
+  G4double fEnvelopeMargin;
+  G4double fRangeSafetyFactor; // range must be below factor * distance
+  G4double fDefaultTimeCut;    // applies to regions without their own cut
+  std::map<G4String, G4double> fRegionTimeCutsByName;
+
+  // --- Geometry cache (from DetectorConstruction) ---
+  G4bool fGeometryCached;
+  G4double fOuterRadius;
+  G4double fHalfLength;
+  G4double fSectorAngle;
+  G4int fNumSectors;
+  const G4Material* fIronMaterial;
+  std::vector<std::pair<G4double, G4double> > fGasGaps; // (rMin, rMax), sorted
+  std::map<const G4Region*, G4double> fRegionTimeCuts;   // resolved from fRegionTimeCutsByName
+  G4bool fTimeCutActive;
+
+  // --- Statistics ---
+  std::array<G4long, kNumKillReasons> fKilledTracks;
+  std::array<G4double, kNumKillReasons> fKilledEnergy;
+  G4long fTracksSeen;        // every track passing through the stacking stage
+  G4long fKilledAtStacking;
+  std::clock_t fRunStartClock;
+};
+
+#endif // TRACKKILLER_HH
@@ -6,42 +6,264 @@
 #include "FTFP_BERT.hh"
 
 #include "DetectorConstruction.hh"
+#include "KLMFastSimulationPhysics.hh"
 #include "ActionInitialization.hh"
 
+#include "GeometryCheck.hh"
+#include "StartupProfiler.hh"
+#include "PhysicsTableCache.hh"
+#include "SimulationServer.hh"
+#include "MultiProcessRunner.hh"
+#include "GeometrySweep.hh"
+#include "EventSeeder.hh"
+#include "RunCheckpoint.hh"
+
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include <vector>
+
 int main(int argc, char** argv)
 {
     G4UIExecutive* ui = nullptr;
     G4String macroName = "";
-    G4String         inputFileName = argv[1];
+    G4String         inputFileName = "";
     // Default
 
-    if (argc == 2) {
-        ui = new G4UIExecutive(argc, argv);
-    } else {
-        if (argc > 2) {
-            macroName = argv[2];
+    // Start the startup clock and observe G4 state transitions from here on
+    StartupProfiler* startupProfiler = StartupProfiler::Instance();
+
+    // --- Command line: [options] input [macro] ---
+    G4bool checkGeometry = false;
+    G4int nCheckWorkers = std::max(1u, std::thread::hardware_concurrency());
+    G4String physicsCacheDir = "";
+    if (const char* env = std::getenv("KLM_PHYSICS_CACHE")) physicsCacheDir = env;
+    G4String serverSocket = "";
+    G4String serverSpool = "";
+    G4int nForkWorkers = 0;
+    G4String sweepFile = "";
+    G4int maxEvents = -1;
+    G4int replayEvent = -1;
+    G4bool resume = false;
+    G4String checkpointSeconds = "";
+    G4bool haveSeed = false;
+    long runSeed = 0;
+    std::vector<G4String> positional;
+    for (G4int i = 1; i < argc; ++i) {
+        G4String arg = argv[i];
+        if (arg == "--check-geometry") {
+            checkGeometry = true;
+        } else if (arg == "--check-workers" && i + 1 < argc) {
+            nCheckWorkers = std::atoi(argv[++i]);
+        } else if (arg == "--startup-report" && i + 1 < argc) {
+            startupProfiler->SetReportFileName(argv[++i]); // "" disables the JSON file
+        } else if (arg == "--server" && i + 1 < argc) {
+            serverSocket = argv[++i];
+        } else if (arg == "--spool" && i + 1 < argc) {
+            serverSpool = argv[++i];
+        } else if (arg == "--fork" && i + 1 < argc) {
+            nForkWorkers = std::atoi(argv[++i]);
+        } else if (arg == "--sweep" && i + 1 < argc) {
+            sweepFile = argv[++i];
+        } else if (arg == "--events" && i + 1 < argc) {
+            maxEvents = std::atoi(argv[++i]);
+        } else if (arg == "--replay-event" && i + 1 < argc) {
+            replayEvent = std::atoi(argv[++i]);
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpointSeconds = argv[++i];
+        } else if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            runSeed = std::atol(argv[++i]);
+            haveSeed = true;
+        } else if (arg == "--physics-cache" && i + 1 < argc) {
+            physicsCacheDir = argv[++i]; // "" disables the cache
+        } else {
+            positional.push_back(arg);
         }
     }
+    const G4bool serverMode = !serverSocket.empty() || !serverSpool.empty();
+    const G4bool replayMode = replayEvent >= 0 && !serverMode && !checkGeometry;
+    const G4bool resumeMode = resume && !replayMode && !serverMode && !checkGeometry;
+    const G4bool sweepMode = !sweepFile.empty() && !serverMode && !checkGeometry && !replayMode && !resumeMode;
+    const G4bool forkMode = nForkWorkers > 0 && !serverMode && !checkGeometry && !replayMode && !resumeMode && !sweepMode;
+    const G4bool configOnly = forkMode || sweepMode || replayMode || resumeMode; // macros after the input configure only
+    if (!serverMode) {
+        if (positional.size() > 0) inputFileName = positional[0];
+        if (positional.size() > 1 && !configOnly) macroName = positional[1];
+    }
+
+    if (inputFileName.empty() && !checkGeometry && !serverMode) {
+        G4cerr << "Usage: klm_barrel <particles.txt|events.hepmc|gun> [macro.mac]\n"
+               << "       klm_barrel --check-geometry [--check-workers N] [config.mac ...]\n"
+               << "       klm_barrel --fork N [--events M] <input> [config.mac ...]\n"
+               << "       klm_barrel --sweep GRID [--fork N] [--events M] <input> [config.mac ...]\n"
+               << "       klm_barrel --replay-event N <input> [config.mac ...]\n"
+               << "       klm_barrel --resume <input> [config.mac ...]\n"
+               << "       klm_barrel --server SOCKET | --spool DIR [config.mac ...]\n"
+               << "Options: --startup-report FILE (default startup_profile.json)\n"
+               << "         --physics-cache DIR (or $KLM_PHYSICS_CACHE)\n"
+               << "         --checkpoint T (write <output>.ckpt every T seconds, /klm/checkpoint/everySeconds)\n"
+               << "         --seed S (run seed of the per-event seeding, /klm/random/runSeed)" << G4endl;
+        return 1;
+    }
+    if (positional.size() == 1 && !checkGeometry && !serverMode && !configOnly) {
+        ui = new G4UIExecutive(argc, argv);
+    }
+
+    // Events are seeded from (run seed, input event index); macros may still change it
+    if (haveSeed) {
+        EventSeeder::Instance()->SetRunSeed(runSeed);
+        G4Random::setTheSeed(runSeed);
+    }
 
     // --- Construct the RunManager ---
     auto* runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::Serial);
 
     // --- Set mandatory user initialization classes ---
     // 1. Detector construction
-    runManager->SetUserInitialization(new DetectorConstruction());
+    DetectorConstruction* detector = new DetectorConstruction();
+    runManager->SetUserInitialization(detector);
 
     // 2. Physics list
     G4VModularPhysicsList* physicsList = new FTFP_BERT;
     physicsList->SetVerboseLevel(1); // Set verbosity before initialization if needed
+    // Fast-simulation hook for muons and K_L, constructed only with /klm/fastsim/physics true
+    physicsList->RegisterPhysics(new KLMFastSimulationPhysics());
     runManager->SetUserInitialization(physicsList);
 
+    // Reuse physics tables of an earlier job with identical physics, cuts and materials
+    PhysicsTableCache* physicsTableCache = nullptr;
+    if (!physicsCacheDir.empty() && !checkGeometry) {
+        physicsTableCache = new PhysicsTableCache(physicsList, "FTFP_BERT", physicsCacheDir);
+    }
+
+    // --- Geometry validation mode: initialise, check overlaps in parallel, exit ---
+    // Positional arguments are configuration macros here (e.g. /klm/geometry/layering)
+    if (checkGeometry) {
+        for (const auto& macro : positional) {
+            G4UImanager::GetUIpointer()->ApplyCommand("/control/execute " + macro);
+        }
+        runManager->Initialize();
+        G4bool pass = false;
+        {
+            StartupProfiler::Scope profile("OverlapCheck");
+            GeometryCheck geometryCheck(detector);
+            pass = geometryCheck.Run(nCheckWorkers);
+        }
+        startupProfiler->Report();
+        delete runManager;
+        return pass ? 0 : 2;
+    }
+
     // 3. User action initialization
     // This creates instances of PrimaryGeneratorAction, RunAction, EventAction etc.
     runManager->SetUserInitialization(new ActionInitialization(inputFileName));
+    // Checkpoints are opt-in; macros may still change the interval
+    if (!checkpointSeconds.empty()) {
+        G4UImanager::GetUIpointer()->ApplyCommand("/klm/checkpoint/everySeconds " + checkpointSeconds);
+    }
+
+    // --- Server mode: initialise once, then run jobs until told to shut down ---
+    // Positional arguments are configuration macros, applied before initialisation
+    if (serverMode) {
+        for (const auto& macro : positional) {
+            G4UImanager::GetUIpointer()->ApplyCommand("/control/execute " + macro);
+        }
+        runManager->Initialize();
+        G4int status = 0;
+        {
+            SimulationServer server(runManager);
+            status = serverSocket.empty() ? server.ServeSpool(serverSpool)
+                                          : server.ServeSocket(serverSocket);
+        }
+        startupProfiler->Report();
+        delete runManager;
+        delete physicsTableCache;
+        return status;
+    }
+
+    // --- Fork mode: initialise once, then N worker processes over event ranges ---
+    // Arguments after the input are configuration macros (no /run/beamOn)
+    if (forkMode) {
+        for (std::size_t i = 1; i < positional.size(); ++i) {
+            G4UImanager::GetUIpointer()->ApplyCommand("/control/execute " + positional[i]);
+        }
+        runManager->Initialize();
+        MultiProcessRunner runner(runManager, inputFileName);
+        G4int status = runner.Run(nForkWorkers, maxEvents);
+        startupProfiler->Report();
+        delete runManager;
+        delete physicsTableCache;
+        return status;
+    }
+
+    // --- Sweep mode: initialise once, then one run per geometry grid point ---
+    // Arguments after the input are configuration macros (no /run/beamOn); --fork sets the worker count
+    if (sweepMode) {
+        for (std::size_t i = 1; i < positional.size(); ++i) {
+            G4UImanager::GetUIpointer()->ApplyCommand("/control/execute " + positional[i]);
+        }
+        runManager->Initialize();
+        G4int status = 1;
+        {
+            GeometrySweep sweep(runManager, inputFileName);
+            if (sweep.LoadGrid(sweepFile)) {
+                G4int nWorkers = nForkWorkers > 0 ? nForkWorkers
+                                                  : (G4int)std::max(1u, std::thread::hardware_concurrency());
+                status = sweep.Run(nWorkers, maxEvents);
+            }
+        }
+        startupProfiler->Report();
+        delete runManager;
+        delete physicsTableCache;
+        return status;
+    }
+
+    // --- Replay mode: re-simulate one input event with its recorded seed ---
+    // Arguments after the input are configuration macros (no /run/beamOn)
+    if (replayMode) {
+        for (std::size_t i = 1; i < positional.size(); ++i) {
+            G4UImanager::GetUIpointer()->ApplyCommand("/control/execute " + positional[i]);
+        }
+        runManager->Initialize();
+        G4int status = 0;
+        {
+            SimulationServer replay(runManager);
+            std::ostringstream job;
+            job << "input=" << inputFileName << " output=replay_event" << replayEvent << ".txt"
+                << " first=" << replayEvent << " count=1 id=replay";
+            status = replay.RunJob(job.str()).compare(0, 2, "OK") == 0 ? 0 : 1;
+        }
+        startupProfiler->Report();
+        delete runManager;
+        delete physicsTableCache;
+        return status;
+    }
+
+    // --- Resume mode: continue the run recorded in <output>.ckpt ---
+    // Arguments after the input are the configuration macros of the original run (no /run/beamOn)
+    if (resumeMode) {
+        for (std::size_t i = 1; i < positional.size(); ++i) {
+            G4UImanager::GetUIpointer()->ApplyCommand("/control/execute " + positional[i]);
+        }
+        runManager->Initialize();
+        G4int status = RunCheckpoint::Resume(runManager, inputFileName);
+        startupProfiler->Report();
+        delete runManager;
+        delete physicsTableCache;
+        return status;
+    }
 
     // --- Initialize Visualization AFTER User Initializations ---
     G4VisManager* visManager = new G4VisExecutive;
-    visManager->Initialize(); // This might internally call /run/initialize if not done yet
+    {
+        StartupProfiler::Scope profile("VisManagerInitialize");
+        visManager->Initialize(); // This might internally call /run/initialize if not done yet
+    }
 
     // --- Get UI manager ---
     G4UImanager* UImanager = G4UImanager::GetUIpointer();
@@ -64,10 +286,14 @@ int main(int argc, char** argv)
         }
     }
 
+    // No-op if the first run already produced the report
+    startupProfiler->Report();
+
     // --- Job termination ---
     delete visManager;
     delete runManager; // This will delete ActionInitialization and its actions,
                        // triggering destructors (like PrimaryGeneratorAction's destructor)
+    delete physicsTableCache;
 
     G4cout << "----> End of main()." << G4endl;
     return 0;
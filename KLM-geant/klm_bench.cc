@@ -0,0 +1,248 @@
+// Reference throughput benchmarks: geometry and physics are built once, then
+// fixed workloads run with pinned seeds and a JSON report is written.
+//   klm_bench [--out klm_bench.json] [--scale X] [--workers N] [--hepmc FILE] [--verbose] [config.mac ...]
+// The JSON layout ("schema": "klm_bench/1") is kept stable so reports of
+// different commits or detector configurations can be compared directly.
+// Each workload runs in its own child process forked after startup, so its
+// CPU time and peak RSS (from wait4) are its own and not the high-water mark
+// of the workloads before it.
+#include "G4RunManagerFactory.hh"
+#include "G4UImanager.hh"
+#include "G4UIsession.hh"
+#include "G4Version.hh"
+#include "FTFP_BERT.hh"
+
+#include "DetectorConstruction.hh"
+#include "KLMFastSimulationPhysics.hh"
+#include "ActionInitialization.hh"
+#include "RunAction.hh"
+#include "SimulationServer.hh"
+#include "MultiProcessRunner.hh"
+#include "EventSeeder.hh"
+#include "EventTelemetry.hh"
+#include "ForkWorker.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+// Drops G4cout while workloads run; errors still reach the terminal
+class QuietSession : public G4UIsession
+{
+public:
+    virtual G4int ReceiveG4cout(const G4String&) { return 0; }
+    virtual G4int ReceiveG4cerr(const G4String& text) { std::cerr << text; return 0; }
+};
+
+struct Workload {
+    std::string name;
+    std::string input;     // "gun" or a HepMC file
+    G4int pdgCode;
+    G4double energyGeV;
+    G4int multiplicity;
+    G4int events;          // before --scale
+    G4int workers;         // 0: serial path, N: fork path
+};
+
+struct Result {
+    Workload workload;
+    G4int events;
+    G4double wallSeconds;
+    G4double cpuSeconds;
+    long peakRssBytes;
+    long outputBytes;
+};
+
+const long kRunSeed = 20240501; // pinned: every workload starts from the same run seed
+
+G4double CpuSeconds(const rusage& usage)
+{
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           1.e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+long FileBytes(const std::string& name)
+{
+    std::ifstream file(name, std::ios::binary | std::ios::ate);
+    return file ? static_cast<long>(file.tellg()) : 0L;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    auto processStart = std::chrono::steady_clock::now();
+
+    // --- Command line ---
+    std::string reportFileName = "klm_bench.json";
+    G4double scale = 1.;
+    G4int nWorkers = 4;
+    std::string hepmcFileName = "";
+    G4bool verbose = false;
+    std::vector<std::string> macros;
+    for (G4int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) reportFileName = argv[++i];
+        else if (arg == "--scale" && i + 1 < argc) scale = std::atof(argv[++i]);
+        else if (arg == "--workers" && i + 1 < argc) nWorkers = std::atoi(argv[++i]);
+        else if (arg == "--hepmc" && i + 1 < argc) hepmcFileName = argv[++i];
+        else if (arg == "--verbose") verbose = true;
+        else macros.push_back(arg);
+    }
+
+    // --- Reference workloads ---
+    std::vector<Workload> workloads = {
+        {"mu_1GeV",         "gun", 13,  1., 1,  2000, 0},
+        {"mu_3GeV",         "gun", 13,  3., 1,  2000, 0},
+        {"kl_1GeV",         "gun", 130, 1., 1,  1000, 0},
+        {"kl_3GeV",         "gun", 130, 3., 1,  1000, 0},
+        {"pi_1GeV_x30",     "gun", 211, 1., 30, 200,  0},
+        {"kl_1GeV_fork",    "gun", 130, 1., 1,  1000, nWorkers},
+    };
+    if (!hepmcFileName.empty()) {
+        workloads.push_back({"hepmc", hepmcFileName, 0, 0., 0, 200, 0});
+        workloads.push_back({"hepmc_fork", hepmcFileName, 0, 0., 0, 200, nWorkers});
+    }
+
+    QuietSession* quiet = verbose ? nullptr : new QuietSession();
+    if (quiet) G4UImanager::GetUIpointer()->SetCoutDestination(quiet);
+
+    // --- Startup, as in klm_barrel ---
+    auto* runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::Serial);
+    runManager->SetUserInitialization(new DetectorConstruction());
+    G4VModularPhysicsList* physicsList = new FTFP_BERT(0);
+    physicsList->RegisterPhysics(new KLMFastSimulationPhysics());
+    runManager->SetUserInitialization(physicsList);
+    runManager->SetUserInitialization(new ActionInitialization(""));
+    G4UImanager* ui = G4UImanager::GetUIpointer();
+    for (const auto& macro : macros) ui->ApplyCommand("/control/execute " + macro);
+    runManager->Initialize();
+    RunAction* runAction = const_cast<RunAction*>(dynamic_cast<const RunAction*>(runManager->GetUserRunAction()));
+    runAction->SetOutputFileName("klm_bench_startup.txt");
+    runManager->BeamOn(0); // physics tables, so the first workload does not pay for them
+    std::remove("klm_bench_startup.txt");
+    const G4double startupSeconds =
+        std::chrono::duration<G4double>(std::chrono::steady_clock::now() - processStart).count();
+    const std::size_t startupRssBytes = EventTelemetry::GetResidentBytes();
+
+    // One server for all serial workloads; each child gets a copy, so every job starts from the same RNG state
+    SimulationServer* server = new SimulationServer(runManager);
+
+    // --- Workloads ---
+    std::vector<Result> results;
+    for (const Workload& workload : workloads) {
+        const G4int nEvents = std::max(1, static_cast<G4int>(workload.events * scale));
+        const std::string output = "klm_bench_" + workload.name + ".txt";
+        if (workload.input == "gun") {
+            ui->ApplyCommand("/klm/gun/pdg " + std::to_string(workload.pdgCode));
+            ui->ApplyCommand("/klm/gun/multiplicity " + std::to_string(workload.multiplicity));
+            ui->ApplyCommand("/klm/gun/spectrum flat");
+            ui->ApplyCommand("/klm/gun/energyMin " + std::to_string(workload.energyGeV) + " GeV");
+            ui->ApplyCommand("/klm/gun/energyMax " + std::to_string(workload.energyGeV) + " GeV");
+            ui->ApplyCommand("/klm/gun/events 0");
+        }
+        EventSeeder::Instance()->SetRunSeed(kRunSeed);
+        std::cerr << "klm_bench: " << workload.name << " (" << nEvents << " events"
+                  << (workload.workers > 0 ? ", " + std::to_string(workload.workers) + " workers" : "") << ")" << std::endl;
+
+        // The workload runs in a child that reports "ok events output_bytes" through a pipe
+        int channel[2];
+        if (pipe(channel) != 0) {
+            std::cerr << "klm_bench: pipe failed" << std::endl;
+            return 1;
+        }
+        auto wallStart = std::chrono::steady_clock::now();
+        pid_t pid = ForkWorker::Start([&]() {
+            close(channel[0]);
+            G4int events = 0;
+            G4bool ok = false;
+            if (workload.workers > 0) {
+                runAction->SetOutputFileName(output);
+                MultiProcessRunner runner(runManager, workload.input);
+                ok = runner.Run(workload.workers, nEvents) == 0;
+                events = ok ? nEvents : 0;
+            } else {
+                std::ostringstream job;
+                job << "input=" << workload.input << " output=" << output << " count=" << nEvents
+                    << " seed=" << kRunSeed << " id=" << workload.name;
+                ok = server->RunJob(job.str()).compare(0, 2, "OK") == 0;
+                events = runAction->GetLastRunNumberOfEvents();
+                std::remove((output + ".timing").c_str());
+            }
+            const std::string reply = std::to_string(ok ? 1 : 0) + " " + std::to_string(events) + " " +
+                                      std::to_string(FileBytes(output)) + "\n";
+            std::remove(output.c_str());
+            const G4bool sent = write(channel[1], reply.data(), reply.size()) == static_cast<ssize_t>(reply.size());
+            return ok && sent;
+        });
+        close(channel[1]);
+        if (pid < 0) {
+            close(channel[0]);
+            std::cerr << "klm_bench: fork failed for " << workload.name << std::endl;
+            return 1;
+        }
+        std::string reply;
+        char buffer[256];
+        ssize_t n = 0;
+        while ((n = read(channel[0], buffer, sizeof(buffer))) > 0) reply.append(buffer, n);
+        close(channel[0]);
+        // rusage of the child and, in fork workloads, of the workers it waited for:
+        // CPU is their sum, ru_maxrss the largest of these processes
+        rusage usage = {};
+        const G4bool exited = ForkWorker::Wait(pid, &usage);
+        const G4double wall = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - wallStart).count();
+        G4int okFlag = 0, events = 0;
+        long outputBytes = 0;
+        std::istringstream(reply) >> okFlag >> events >> outputBytes;
+        const G4bool ok = okFlag == 1 && exited;
+        if (!ok) std::cerr << "klm_bench: workload " << workload.name << " failed" << std::endl;
+
+        const long peakRss = usage.ru_maxrss * 1024L; // kB on Linux
+        results.push_back(Result{workload, events, wall, CpuSeconds(usage), peakRss, outputBytes});
+    }
+
+    // --- Report ---
+    std::ofstream report(reportFileName);
+    report << std::fixed << std::setprecision(6);
+    report << "{\n"
+           << "  \"schema\": \"klm_bench/1\",\n"
+           << "  \"geant4\": \"" << G4Version << "\",\n"
+           << "  \"run_seed\": " << kRunSeed << ",\n"
+           << "  \"scale\": " << scale << ",\n"
+           << "  \"startup_s\": " << startupSeconds << ",\n"
+           << "  \"startup_rss_bytes\": " << startupRssBytes << ",\n"
+           << "  \"workloads\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const G4double perEvent = r.events > 0 ? 1. / r.events : 0.;
+        report << "    {\"name\": \"" << r.workload.name << "\""
+               << ", \"workers\": " << r.workload.workers
+               << ", \"events\": " << r.events
+               << ", \"wall_s\": " << r.wallSeconds
+               << ", \"events_per_s\": " << (r.wallSeconds > 0. ? r.events / r.wallSeconds : 0.)
+               << ", \"cpu_ms_per_event\": " << 1.e3 * r.cpuSeconds * perEvent
+               << ", \"peak_rss_bytes\": " << r.peakRssBytes
+               << ", \"output_bytes_per_event\": " << r.outputBytes * perEvent
+               << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    report << "  ]\n}\n";
+    report.close();
+    std::cerr << "klm_bench: report written to " << reportFileName << std::endl;
+
+    delete server;
+    delete runManager;
+    if (quiet) G4UImanager::GetUIpointer()->SetCoutDestination(nullptr);
+    delete quiet;
+    return 0;
+}
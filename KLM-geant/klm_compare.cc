@@ -0,0 +1,375 @@
+// Compares a cell-energy file (summarized_cell_energy.txt and the like)
+// against a reference, for the golden-output regression tests:
+//   exact  the same cells in every event, energies within --rel-tol/--abs-tol
+//   stat   per-event quantities, since the cells of a shower are
+//          correlated: per stack the mean cells per event (with its sample
+//          variance) and the per-event edep distribution (two-sample
+//          Kolmogorov-Smirnov), overall the per-event cell count and edep
+//          distributions; for changes that alter the random sequence but
+//          must keep the physics
+//   efficiency  per-stack fraction of events with a hit (chi2 of the
+//          proportions), for approximate models such as the fast muon
+//          propagation that keep the hit pattern but not the deposits
+// Golden files start with "# golden geant4 <version>"; with --geant4 a
+// reference of another (or no recorded) Geant4 version is rejected.
+// Exit status: 0 pass, 1 differences, 2 usage, unreadable candidate or
+// Geant4 version mismatch, 77 reference missing with --skip-missing
+// (ctest SKIP_RETURN_CODE).
+#include "globals.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// (EventID, Sector, Stack, ZCell, PhiCell)
+typedef std::tuple<G4int, G4int, G4int, G4int, G4int> CellKey;
+
+struct CellFile {
+    std::map<CellKey, G4double> cells; // keV
+    G4int nEvents = 0;                 // highest event ID seen + 1
+    G4int maxStack = 0;                // highest stack seen (the stack count is a geometry parameter)
+    std::string geant4Version;         // from the "# golden geant4" line, if any
+};
+
+G4bool Load(const std::string& fileName, CellFile& file)
+{
+    std::ifstream in(fileName);
+    if (!in) return false;
+    G4int maxEventID = -1;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            // "# event N ..." seed records also cover events without cells
+            std::istringstream comment(line.substr(1));
+            std::string word, version;
+            G4int eventID = -1;
+            if (comment >> word && word == "event" && comment >> eventID) maxEventID = std::max(maxEventID, eventID);
+            if (word == "golden" && comment >> word && word == "geant4" && comment >> version) file.geant4Version = version;
+            continue;
+        }
+        std::istringstream fields(line);
+        G4int eventID, sector, stack, zCell, phiCell;
+        G4double edep;
+        if (!(fields >> eventID >> sector >> stack >> zCell >> phiCell >> edep)) continue;
+        file.cells[std::make_tuple(eventID, sector, stack, zCell, phiCell)] += edep;
+        maxEventID = std::max(maxEventID, eventID);
+        file.maxStack = std::max(file.maxStack, stack);
+    }
+    file.nEvents = maxEventID + 1;
+    return true;
+}
+
+// Upper regularised incomplete gamma Q(a, x), series or continued fraction
+G4double GammaQ(G4double a, G4double x)
+{
+    if (x <= 0.) return 1.;
+    const G4double logPrefactor = -x + a * std::log(x) - std::lgamma(a);
+    if (x < a + 1.) {
+        G4double term = 1. / a, sum = term;
+        for (G4int n = 1; n < 500 && std::fabs(term) > std::fabs(sum) * 1e-15; ++n) {
+            term *= x / (a + n);
+            sum += term;
+        }
+        return 1. - sum * std::exp(logPrefactor);
+    }
+    G4double b = x + 1. - a, c = 1. / 1e-300, d = 1. / b, h = d;
+    for (G4int i = 1; i < 500; ++i) {
+        const G4double an = -i * (i - a);
+        b += 2.;
+        d = an * d + b;
+        if (std::fabs(d) < 1e-300) d = 1e-300;
+        c = b + an / c;
+        if (std::fabs(c) < 1e-300) c = 1e-300;
+        d = 1. / d;
+        const G4double delta = d * c;
+        h *= delta;
+        if (std::fabs(delta - 1.) < 1e-15) break;
+    }
+    return std::exp(logPrefactor) * h;
+}
+
+// Asymptotic Kolmogorov distribution, P(D > observed)
+G4double KolmogorovQ(G4double lambda)
+{
+    if (lambda < 0.2) return 1.;
+    G4double sum = 0., sign = 1.;
+    for (G4int j = 1; j <= 100; ++j) {
+        const G4double term = sign * 2. * std::exp(-2. * j * j * lambda * lambda);
+        sum += term;
+        if (std::fabs(term) < 1e-12) break;
+        sign = -sign;
+    }
+    return std::min(1., std::max(0., sum));
+}
+
+// Two-sample KS p-value of the sorted samples a and b
+G4double KSProbability(const std::vector<G4double>& a, const std::vector<G4double>& b, G4double& distance)
+{
+    distance = 0.;
+    if (a.empty() || b.empty()) return a.empty() && b.empty() ? 1. : 0.;
+    std::size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        const G4double value = std::min(a[i], b[j]);
+        while (i < a.size() && a[i] <= value) ++i;
+        while (j < b.size() && b[j] <= value) ++j;
+        distance = std::max(distance, std::fabs(G4double(i) / a.size() - G4double(j) / b.size()));
+    }
+    const G4double effective = std::sqrt(G4double(a.size()) * b.size() / (a.size() + b.size()));
+    return KolmogorovQ((effective + 0.12 + 0.11 / effective) * distance);
+}
+
+G4bool CompareExact(const CellFile& reference, const CellFile& candidate, G4double relTol, G4double absTol)
+{
+    G4int onlyReference = 0, onlyCandidate = 0, energyDiffers = 0, shown = 0;
+    auto show = [&shown](const std::string& text) {
+        if (shown++ < 10) G4cout << "  " << text << G4endl;
+    };
+    auto describe = [](const CellKey& key) {
+        std::ostringstream text;
+        text << "event " << std::get<0>(key) << " cell " << std::get<1>(key) << " " << std::get<2>(key) << " "
+             << std::get<3>(key) << " " << std::get<4>(key);
+        return text.str();
+    };
+    auto r = reference.cells.begin();
+    auto c = candidate.cells.begin();
+    while (r != reference.cells.end() || c != candidate.cells.end()) {
+        if (c == candidate.cells.end() || (r != reference.cells.end() && r->first < c->first)) {
+            show(describe(r->first) + ": only in the reference");
+            ++onlyReference;
+            ++r;
+        } else if (r == reference.cells.end() || c->first < r->first) {
+            show(describe(c->first) + ": only in the candidate");
+            ++onlyCandidate;
+            ++c;
+        } else {
+            const G4double a = r->second, b = c->second;
+            if (std::fabs(a - b) > absTol + relTol * std::max(std::fabs(a), std::fabs(b))) {
+                std::ostringstream text;
+                text << describe(r->first) << ": " << std::setprecision(9) << a << " keV vs " << b << " keV";
+                show(text.str());
+                ++energyDiffers;
+            }
+            ++r;
+            ++c;
+        }
+    }
+    const G4bool pass = reference.nEvents == candidate.nEvents && onlyReference + onlyCandidate + energyDiffers == 0;
+    G4cout << "exact: " << (pass ? "PASS" : "FAIL") << " (events " << reference.nEvents << " vs " << candidate.nEvents
+           << ", cells " << reference.cells.size() << " vs " << candidate.cells.size()
+           << "; only in reference " << onlyReference << ", only in candidate " << onlyCandidate
+           << ", energy beyond tolerance " << energyDiffers << ")" << G4endl;
+    return pass;
+}
+
+// Per-event sums of one file: cells and edep per stack, and the event totals.
+// Cells of one shower are correlated, so the event, not the cell, is the independent draw.
+struct EventSums {
+    std::vector<std::vector<G4double>> cells; // [stack][event]
+    std::vector<std::vector<G4double>> edep;  // [stack][event], keV
+    std::vector<G4double> totalCells, totalEdep;
+};
+
+EventSums SumEvents(const CellFile& file, G4int maxStack)
+{
+    EventSums sums;
+    sums.cells.assign(maxStack + 1, std::vector<G4double>(file.nEvents, 0.));
+    sums.edep.assign(maxStack + 1, std::vector<G4double>(file.nEvents, 0.));
+    sums.totalCells.assign(file.nEvents, 0.);
+    sums.totalEdep.assign(file.nEvents, 0.);
+    for (const auto& cell : file.cells) {
+        const G4int event = std::get<0>(cell.first), stack = std::max(0, std::get<2>(cell.first));
+        if (event < 0) continue;
+        sums.cells[stack][event] += 1.;
+        sums.edep[stack][event] += cell.second;
+        sums.totalCells[event] += 1.;
+        sums.totalEdep[event] += cell.second;
+    }
+    return sums;
+}
+
+// Two-sided p-value that two samples have the same mean (Welch, normal approximation)
+G4double MeanProbability(const std::vector<G4double>& a, const std::vector<G4double>& b, G4double& meanA, G4double& meanB)
+{
+    auto moments = [](const std::vector<G4double>& x, G4double& mean, G4double& variance) {
+        mean = 0.;
+        for (G4double value : x) mean += value;
+        mean /= x.size();
+        variance = 0.;
+        for (G4double value : x) variance += (value - mean) * (value - mean);
+        variance = x.size() > 1 ? variance / (x.size() - 1) : 0.;
+    };
+    G4double varianceA = 0., varianceB = 0.;
+    moments(a, meanA, varianceA);
+    moments(b, meanB, varianceB);
+    const G4double error2 = varianceA / a.size() + varianceB / b.size();
+    if (error2 <= 0.) return meanA == meanB ? 1. : 0.;
+    return std::erfc(std::fabs(meanA - meanB) / std::sqrt(2. * error2));
+}
+
+G4double SortedKS(std::vector<G4double> a, std::vector<G4double> b, G4double& distance)
+{
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return KSProbability(a, b, distance);
+}
+
+G4bool CompareStatistics(const CellFile& reference, const CellFile& candidate, G4double alpha)
+{
+    if (reference.nEvents <= 0 || candidate.nEvents <= 0) {
+        G4cout << "stat: FAIL (no events)" << G4endl;
+        return false;
+    }
+    const G4int maxStack = std::max(reference.maxStack, candidate.maxStack);
+    const EventSums r = SumEvents(reference, maxStack), c = SumEvents(candidate, maxStack);
+
+    // Per populated stack: mean cells per event (sample variance) and KS of the per-event edep;
+    // overall: KS of the per-event cell count and edep. Bonferroni-corrected over all tests.
+    std::vector<G4int> stacks;
+    for (G4int stack = 0; stack <= maxStack; ++stack) {
+        const G4bool populated = std::any_of(r.cells[stack].begin(), r.cells[stack].end(), [](G4double n) { return n > 0.; }) ||
+                                 std::any_of(c.cells[stack].begin(), c.cells[stack].end(), [](G4double n) { return n > 0.; });
+        if (populated) stacks.push_back(stack);
+    }
+    const G4int nTests = 2 * static_cast<G4int>(stacks.size()) + 2;
+    const G4double threshold = alpha / nTests;
+    G4bool pass = true;
+    auto verdict = [threshold, &pass](G4double p) {
+        if (p < threshold) pass = false;
+        return p >= threshold ? "" : "  <-- differs";
+    };
+    G4cout << std::setprecision(4);
+    for (G4int stack : stacks) {
+        G4double meanR = 0., meanC = 0., distance = 0.;
+        const G4double occupancyP = MeanProbability(r.cells[stack], c.cells[stack], meanR, meanC);
+        G4cout << "  stack " << std::setw(2) << stack << ": cells/event " << meanR << " vs " << meanC
+               << " p " << occupancyP << verdict(occupancyP);
+        const G4double edepP = SortedKS(r.edep[stack], c.edep[stack], distance);
+        G4cout << ", edep/event KS D " << distance << " p " << edepP << verdict(edepP) << G4endl;
+    }
+    G4double distance = 0.;
+    const G4double cellsP = SortedKS(r.totalCells, c.totalCells, distance);
+    G4cout << "  all stacks: cells/event KS D " << distance << " p " << cellsP << verdict(cellsP);
+    const G4double edepP = SortedKS(r.totalEdep, c.totalEdep, distance);
+    G4cout << ", edep/event KS D " << distance << " p " << edepP << verdict(edepP) << G4endl;
+    G4cout << "stat: " << (pass ? "PASS" : "FAIL") << " (events " << reference.nEvents << " vs " << candidate.nEvents
+           << ", alpha " << alpha << ", " << nTests << " tests)" << G4endl;
+    return pass;
+}
+
+G4bool CompareEfficiency(const CellFile& reference, const CellFile& candidate, G4double alpha)
+{
+    if (reference.nEvents <= 0 || candidate.nEvents <= 0) {
+        G4cout << "efficiency: FAIL (no events)" << G4endl;
+        return false;
+    }
+    // Events with at least one cell, per stack
+    auto eventsWithHits = [](const CellFile& file) {
+        std::map<G4int, std::set<G4int>> events;
+        for (const auto& cell : file.cells) events[std::get<2>(cell.first)].insert(std::get<0>(cell.first));
+        return events;
+    };
+    std::map<G4int, std::set<G4int>> referenceEvents = eventsWithHits(reference);
+    std::map<G4int, std::set<G4int>> candidateEvents = eventsWithHits(candidate);
+    std::set<G4int> stacks;
+    for (const auto& entry : referenceEvents) stacks.insert(entry.first);
+    for (const auto& entry : candidateEvents) stacks.insert(entry.first);
+
+    const G4double nr = reference.nEvents, nc = candidate.nEvents;
+    G4double chi2 = 0.;
+    G4int ndf = 0;
+    for (G4int stack : stacks) {
+        const G4double kr = referenceEvents[stack].size(), kc = candidateEvents[stack].size();
+        const G4double pooled = (kr + kc) / (nr + nc);
+        G4double term = 0.;
+        if (pooled > 0. && pooled < 1.) {
+            const G4double difference = kr / nr - kc / nc;
+            term = difference * difference / (pooled * (1. - pooled) * (1. / nr + 1. / nc));
+            chi2 += term;
+            ++ndf;
+        }
+        G4cout << std::setprecision(4) << "  stack " << std::setw(2) << stack << ": efficiency " << kr / nr
+               << " vs " << kc / nc << ", chi2 " << term << G4endl;
+    }
+    const G4double p = ndf > 0 ? GammaQ(0.5 * ndf, 0.5 * chi2) : 1.;
+    const G4bool pass = p >= alpha;
+    G4cout << "efficiency: " << (pass ? "PASS" : "FAIL") << " (chi2/ndf " << chi2 << "/" << ndf << " p " << p
+           << ", alpha " << alpha << ")" << G4endl;
+    return pass;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    G4String mode = "exact";
+    G4double relTol = 1e-6;
+    G4double absTol = 1e-6; // keV
+    G4double alpha = 0.001;
+    G4bool skipMissing = false;
+    std::string geant4Version = "";
+    std::vector<G4String> files;
+    for (G4int i = 1; i < argc; ++i) {
+        G4String arg = argv[i];
+        if (arg == "--mode" && i + 1 < argc) {
+            mode = argv[++i];
+        } else if (arg == "--rel-tol" && i + 1 < argc) {
+            relTol = std::atof(argv[++i]);
+        } else if (arg == "--abs-tol" && i + 1 < argc) {
+            absTol = std::atof(argv[++i]);
+        } else if (arg == "--alpha" && i + 1 < argc) {
+            alpha = std::atof(argv[++i]);
+        } else if (arg == "--skip-missing") {
+            skipMissing = true;
+        } else if (arg == "--geant4" && i + 1 < argc) {
+            geant4Version = argv[++i];
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != 2 || (mode != "exact" && mode != "stat" && mode != "both" && mode != "efficiency")) {
+        G4cerr << "Usage: klm_compare [options] <reference.txt> <candidate.txt>\n"
+               << "Options: --mode exact|stat|both|efficiency (exact)  --rel-tol (1e-6)  --abs-tol keV (1e-6)\n"
+               << "         --alpha (0.001)  --skip-missing (exit 77 if the reference does not exist)\n"
+               << "         --geant4 VERSION (reject a reference made with another Geant4 version)" << G4endl;
+        return 2;
+    }
+
+    CellFile reference, candidate;
+    if (!Load(files[0], reference)) {
+        if (skipMissing) {
+            G4cout << "klm_compare: no reference " << files[0] << ", skipped (see README: golden outputs)" << G4endl;
+            return 77;
+        }
+        G4cerr << "klm_compare: cannot read reference " << files[0] << G4endl;
+        return 2;
+    }
+    if (!Load(files[1], candidate)) {
+        G4cerr << "klm_compare: cannot read candidate " << files[1] << G4endl;
+        return 2;
+    }
+    // Golden outputs are only exact for the Geant4 version that produced them
+    if (!geant4Version.empty() && reference.geant4Version != geant4Version) {
+        G4cerr << "klm_compare: reference " << files[0] << " was made with Geant4 "
+               << (reference.geant4Version.empty() ? std::string("(not recorded)") : reference.geant4Version)
+               << ", this build uses " << geant4Version << "; regenerate it (make klm_update_golden)" << G4endl;
+        return 2;
+    }
+
+    G4bool pass = true;
+    if (mode == "exact" || mode == "both") pass = CompareExact(reference, candidate, relTol, absTol) && pass;
+    if (mode == "stat" || mode == "both") pass = CompareStatistics(reference, candidate, alpha) && pass;
+    if (mode == "efficiency") pass = CompareEfficiency(reference, candidate, alpha) && pass;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+// Standalone strip digitization of stored cell-energy files
+// (summarized_cell_energy.txt and the like), with the same KLMDigitizer
+// and per-event seeding as the inline /klm/digi/ stage. With --overlay,
+// background frames are mixed in first, so one signal file gives many
+// background variants (--overlay-seed).
+#include "KLMDigitizer.hh"
+#include "BackgroundOverlay.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    KLMDigitizer digitizer;
+    BackgroundOverlay overlay;
+    G4String inputFileName = "";
+    G4String outputFileName = "";
+    G4String mixedCellsFileName = "";
+    for (G4int i = 1; i < argc; ++i) {
+        G4String arg = argv[i];
+        if (arg == "--threshold" && i + 1 < argc) {
+            digitizer.SetThreshold(std::atof(argv[++i]) * keV);
+        } else if (arg == "--efficiency" && i + 1 < argc) {
+            digitizer.SetEfficiency(std::atof(argv[++i]));
+        } else if (arg == "--cluster-size" && i + 1 < argc) {
+            digitizer.SetMeanClusterSize(std::atof(argv[++i]));
+        } else if (arg == "--time-resolution" && i + 1 < argc) {
+            digitizer.SetTimeResolution(std::atof(argv[++i]) * ns);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            digitizer.SetSeed(std::atol(argv[++i]));
+        } else if (arg == "--dead" && i + 1 < argc) {
+            if (!digitizer.LoadDeadChannels(argv[++i])) return 1;
+        } else if (arg == "--overlay" && i + 1 < argc) {
+            if (!overlay.Open(argv[++i])) return 1;
+        } else if (arg == "--overlay-rate" && i + 1 < argc) {
+            overlay.SetRate(std::atof(argv[++i]));
+        } else if (arg == "--overlay-seed" && i + 1 < argc) {
+            overlay.SetSeed(std::atol(argv[++i]));
+        } else if (arg == "--mixed-cells" && i + 1 < argc) {
+            mixedCellsFileName = argv[++i];
+        } else if (inputFileName.empty()) {
+            inputFileName = arg;
+        } else {
+            outputFileName = arg;
+        }
+    }
+    if (inputFileName.empty()) {
+        G4cerr << "Usage: klm_digitize [options] <cells.txt> [digits.txt]\n"
+               << "Options: --threshold keV (0.1)  --efficiency (0.95)  --cluster-size (1.5)\n"
+               << "         --time-resolution ns (2)  --seed N (0)  --dead FILE\n"
+               << "         --overlay LIB [--overlay-rate R (1)] [--overlay-seed N (0)] [--mixed-cells FILE]" << G4endl;
+        return 1;
+    }
+    if (outputFileName.empty()) outputFileName = inputFileName + ".digits";
+
+    std::ifstream input(inputFileName);
+    if (!input) {
+        G4cerr << "klm_digitize: cannot read " << inputFileName << G4endl;
+        return 1;
+    }
+    if (!digitizer.OpenOutput(outputFileName)) return 1;
+    std::ofstream mixedCells;
+    if (!mixedCellsFileName.empty()) {
+        mixedCells.open(mixedCellsFileName);
+        mixedCells << "# EventID Sector Stack ZCell(0-95) PhiCell(0-35) TotalEnergyDep_keV\n";
+    }
+
+    // Cell lines of one event are consecutive: "EventID Sector Stack ZCell PhiCell Edep_keV"
+    std::vector<KLMCellDeposit> cells;
+    std::vector<KLMDigit> digits;
+    G4int currentEvent = -1;
+    G4long nEvents = 0, nDigits = 0;
+    auto flush = [&]() {
+        if (currentEvent < 0) return;
+        if (overlay.IsActive()) {
+            overlay.Sample(currentEvent, cells);
+            BackgroundOverlay::MergeCells(cells);
+        }
+        if (mixedCells.is_open()) {
+            for (const KLMCellDeposit& cell : cells) {
+                mixedCells << currentEvent << " " << cell.sector << " " << cell.stack << " " << cell.zCell
+                           << " " << cell.phiCell << " " << cell.edep / keV << "\n";
+            }
+        }
+        digitizer.Digitize(currentEvent, cells, digits);
+        digitizer.Write(currentEvent, digits);
+        nEvents++;
+        nDigits += digits.size();
+        cells.clear();
+    };
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.compare(0, 8, "# event ") == 0) {
+            // Seed record: opens an event even if it has no cells (background still mixes in)
+            std::istringstream fields(line);
+            std::string hash, word;
+            G4int eventID;
+            if (fields >> hash >> word >> eventID && eventID != currentEvent) {
+                flush();
+                currentEvent = eventID;
+            }
+            continue;
+        }
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        G4int eventID;
+        KLMCellDeposit cell;
+        G4double edepKeV;
+        if (!(fields >> eventID >> cell.sector >> cell.stack >> cell.zCell >> cell.phiCell >> edepKeV)) {
+            G4cerr << "klm_digitize: skipping malformed line: " << line << G4endl;
+            continue;
+        }
+        if (eventID != currentEvent) {
+            flush();
+            currentEvent = eventID;
+        }
+        cell.edep = edepKeV * keV;
+        cell.time = 0.; // not stored in cell files
+        cells.push_back(cell);
+    }
+    flush();
+    digitizer.CloseOutput();
+
+    G4cout << "klm_digitize: " << nEvents << " events, " << nDigits << " strip hits -> "
+           << outputFileName << G4endl;
+    return 0;
+}
@@ -0,0 +1,518 @@
+// Microbenchmarks of the hot kernels that run without Geant4 tracking:
+//   cells   MylarSD cell assignment (MylarSD::ComputeCells)
+//   parse   custom-format line parsing (PrimaryGeneratorAction::ParseParticleLine)
+//   accum   per-event hit accumulation (EventAction::AccumulateHits)
+//   format  per-event cell lines (EventAction::WriteCells)
+// Each group times the production code ("baseline") and its alternative
+// implementations on the same synthetic, production-like data (pinned seed).
+// Every variant returns a checksum of its results; a variant whose checksum
+// differs from the baseline is marked, since it would change the output.
+// To try an alternative, add a function next to the others and one line to
+// the Variant table in main().
+//   klm_microbench [--filter substring] [--min-time 0.5] [--json file]
+#include "DetectorConstruction.hh"
+#include "MylarSD.hh"
+#include "PrimaryGeneratorAction.hh"
+#include "EventAction.hh"
+
+#include "G4ThreeVector.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// --- Synthetic data ---
+
+struct CellGrid {
+    G4double halfZ;
+    G4double sectorAngle;
+    G4int numZCells;
+    G4int numPhiCells06;
+    G4int numPhiCells714;
+    G4int numStacks;
+    std::vector<KLMRadialLayer> gasGaps; // sector-local radial range of every gas gap
+};
+
+struct LocalHit {
+    G4ThreeVector localPos;
+    G4int stack;
+};
+
+struct CellHit {
+    G4int sector, stack, subLayerID, zCell, phiCell;
+    G4double edep; // MeV, as in MylarHit
+    G4double time;
+};
+
+// Hits per event: a few tracks crossing several stacks, each with some steps per gas gap
+const G4int kEvents = 2000;
+const G4int kHitsPerEvent = 60;
+const G4int kParticlesPerEvent = 30;
+
+// Local hit positions spread like production: in the gas gaps of the built geometry, inner
+// stacks favoured, a few hits just outside the sector edges and the barrel ends
+std::vector<LocalHit> MakeLocalHits(const CellGrid& grid, std::mt19937_64& rng)
+{
+    std::uniform_real_distribution<G4double> unit(0., 1.);
+    std::vector<LocalHit> hits;
+    hits.reserve(kEvents * kHitsPerEvent);
+    const std::size_t gapsPerStack = grid.gasGaps.size() / grid.numStacks;
+    for (G4int i = 0; i < kEvents * kHitsPerEvent; ++i) {
+        const G4int stack = std::min(grid.numStacks - 1, static_cast<G4int>(grid.numStacks * unit(rng) * unit(rng)));
+        const std::size_t gap = std::min(gapsPerStack - 1, static_cast<std::size_t>(gapsPerStack * unit(rng)));
+        const KLMRadialLayer& layer = grid.gasGaps[stack * gapsPerStack + gap];
+        G4double r = layer.rMin + (layer.rMax - layer.rMin) * unit(rng);
+        G4double phi = (unit(rng) - 0.5) * grid.sectorAngle * 1.01;
+        G4double z = (2. * unit(rng) - 1.) * grid.halfZ * 1.02;
+        hits.push_back(LocalHit{G4ThreeVector(r * std::cos(phi), r * std::sin(phi), z), layer.stack});
+    }
+    return hits;
+}
+
+// Cell hits grouped in events; repeated cells as several steps share a gas gap
+std::vector<std::vector<CellHit>> MakeCellEvents(const CellGrid& grid, std::mt19937_64& rng)
+{
+    std::uniform_real_distribution<G4double> unit(0., 1.);
+    std::exponential_distribution<G4double> edep(1. / (1.5 * keV));
+    std::vector<std::vector<CellHit>> events(kEvents);
+    const std::size_t gapsPerStack = grid.gasGaps.size() / grid.numStacks;
+    for (auto& event : events) {
+        event.reserve(kHitsPerEvent);
+        while (static_cast<G4int>(event.size()) < kHitsPerEvent) {
+            const G4int sector = static_cast<G4int>(8. * unit(rng));
+            G4int zCell = static_cast<G4int>(grid.numZCells * unit(rng));
+            G4int phiCell = static_cast<G4int>(grid.numPhiCells06 * unit(rng));
+            G4double time = 5. * ns + 2. * ns * unit(rng);
+            for (G4int stack = 0; stack < grid.numStacks && static_cast<G4int>(event.size()) < kHitsPerEvent; ++stack) {
+                if (unit(rng) < 0.1) break; // track stops
+                const G4int steps = 1 + static_cast<G4int>(3. * unit(rng));
+                const std::size_t gap = std::min(gapsPerStack - 1, static_cast<std::size_t>(gapsPerStack * unit(rng)));
+                const G4int subLayerID = grid.gasGaps[stack * gapsPerStack + gap].subLayerID;
+                for (G4int s = 0; s < steps; ++s) {
+                    event.push_back(CellHit{sector, stack, subLayerID, zCell, phiCell, edep(rng), time + 0.1 * ns * s});
+                }
+                time += 0.3 * ns;
+                zCell = std::min(grid.numZCells - 1, std::max(0, zCell + static_cast<G4int>(3. * unit(rng)) - 1));
+                phiCell = std::min(grid.numPhiCells06 - 1, std::max(0, phiCell + static_cast<G4int>(3. * unit(rng)) - 1));
+            }
+        }
+    }
+    return events;
+}
+
+// Custom-format particle lines with the number formats of the generator outputs
+std::vector<std::string> MakeParticleLines(std::mt19937_64& rng)
+{
+    std::uniform_real_distribution<G4double> unit(0., 1.);
+    const G4int pdgCodes[] = {22, 22, 211, -211, 111, 130, 2112, 321, 13, 11};
+    std::vector<std::string> lines;
+    lines.reserve(kEvents * kParticlesPerEvent);
+    char buffer[512];
+    for (G4int event = 0; event < kEvents; ++event) {
+        for (G4int i = 0; i < kParticlesPerEvent; ++i) {
+            const G4double px = 2. * unit(rng) - 1., py = 2. * unit(rng) - 1., pz = 3. * unit(rng) - 1.;
+            const G4double e = std::sqrt(px * px + py * py + pz * pz + 0.0195);
+            const G4int mother = i < 2 ? -1 : static_cast<G4int>(i * unit(rng));
+            G4int n = std::snprintf(buffer, sizeof(buffer), "%d %d %.9g %.9g %.9g %.9g %.6g %.6g %.6g %.6g %d",
+                                    event, pdgCodes[static_cast<G4int>(10. * unit(rng))], px, py, pz, e,
+                                    0.01 * unit(rng), 0.01 * unit(rng), 0.5 * unit(rng), 0.01 * unit(rng), mother);
+            if (unit(rng) < 0.3) {
+                std::snprintf(buffer + n, sizeof(buffer) - n, " %d %d", i + 1, i + 2);
+            }
+            lines.push_back(buffer);
+        }
+    }
+    return lines;
+}
+
+// --- Checksums ---
+
+inline std::uint64_t Mix(std::uint64_t hash, std::uint64_t value)
+{
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+inline std::uint64_t Bits(G4double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+std::uint64_t HashText(const char* text, std::size_t length, std::uint64_t hash)
+{
+    for (std::size_t i = 0; i < length; ++i) hash = (hash ^ static_cast<unsigned char>(text[i])) * 0x100000001b3ULL;
+    return hash;
+}
+
+// --- Data shared by the variants ---
+
+CellGrid gGrid;
+const MylarSD* gMylarSD = nullptr;
+std::vector<LocalHit> gLocalHits;
+std::vector<std::vector<CellHit>> gCellEvents;
+std::vector<MylarHitsCollection*> gHitCollections;
+std::vector<std::map<CellIdentifier, G4double>> gCellMaps;
+std::vector<std::string> gParticleLines;
+
+// --- cells ---
+
+std::uint64_t CellsBaseline()
+{
+    std::uint64_t hash = 0;
+    for (const LocalHit& hit : gLocalHits) {
+        G4int zCell, phiCell;
+        gMylarSD->ComputeCells(hit.localPos, hit.stack, zCell, phiCell);
+        hash = Mix(hash, (static_cast<std::uint64_t>(zCell + 1) << 32) | static_cast<std::uint32_t>(phiCell + 1));
+    }
+    return hash;
+}
+
+// Reciprocal scales instead of divisions, and atan2 and the clamps inlined
+std::uint64_t CellsReciprocal()
+{
+    const G4double zScale = gGrid.numZCells / (2. * gGrid.halfZ);
+    const G4double delta = gGrid.sectorAngle;
+    const G4double invDelta = 1. / delta;
+    std::uint64_t hash = 0;
+    for (const LocalHit& hit : gLocalHits) {
+        const G4int numPhiCells = hit.stack > 6 ? gGrid.numPhiCells714 : gGrid.numPhiCells06;
+        const G4double localZ = hit.localPos.z();
+        G4int zCell = -1;
+        if (localZ >= -gGrid.halfZ && localZ < gGrid.halfZ) {
+            zCell = std::min(gGrid.numZCells - 1, std::max(0, static_cast<G4int>((localZ + gGrid.halfZ) * zScale)));
+        }
+        G4double phi = std::atan2(hit.localPos.y(), hit.localPos.x()) + 0.5 * delta;
+        if (phi < 0) phi += CLHEP::twopi;
+        while (phi >= delta + 1e-9) phi -= delta;
+        G4int phiCell = std::min(numPhiCells - 1, std::max(0, static_cast<G4int>(phi * invDelta * numPhiCells)));
+        hash = Mix(hash, (static_cast<std::uint64_t>(zCell + 1) << 32) | static_cast<std::uint32_t>(phiCell + 1));
+    }
+    return hash;
+}
+
+// --- parse ---
+
+std::uint64_t HashParticle(std::uint64_t hash, const ParticleData& data)
+{
+    hash = Mix(hash, static_cast<std::uint64_t>(data.eventID) << 32 | static_cast<std::uint32_t>(data.pdgID));
+    for (G4double value : {data.px, data.py, data.pz, data.E, data.x, data.y, data.z, data.t}) hash = Mix(hash, Bits(value));
+    hash = Mix(hash, static_cast<std::uint32_t>(data.motherPID));
+    return HashText(data.daughtersStr.data(), data.daughtersStr.size(), hash);
+}
+
+std::uint64_t ParseBaseline()
+{
+    ParticleData data;
+    std::uint64_t hash = 0;
+    for (const std::string& line : gParticleLines) {
+        if (PrimaryGeneratorAction::ParseParticleLine(line, data)) hash = HashParticle(hash, data);
+    }
+    return hash;
+}
+
+// strtol/strtod over the line buffer, no stream construction per line
+std::uint64_t ParseStrtod()
+{
+    ParticleData data;
+    std::uint64_t hash = 0;
+    for (const std::string& line : gParticleLines) {
+        const char* p = line.c_str();
+        char* end = nullptr;
+        G4bool ok = true;
+        auto nextInt = [&](G4int& value) {
+            long parsed = std::strtol(p, &end, 10);
+            ok = ok && end != p;
+            value = static_cast<G4int>(parsed);
+            p = end;
+        };
+        auto nextDouble = [&](G4double& value) {
+            value = std::strtod(p, &end);
+            ok = ok && end != p;
+            p = end;
+        };
+        nextInt(data.eventID); nextInt(data.pdgID);
+        nextDouble(data.px); nextDouble(data.py); nextDouble(data.pz); nextDouble(data.E);
+        nextDouble(data.x); nextDouble(data.y); nextDouble(data.z); nextDouble(data.t);
+        nextInt(data.motherPID);
+        if (!ok) continue;
+        while (*p == ' ' || *p == '\t') ++p;
+        data.daughtersStr.assign(p);
+        data.isValid = true;
+        hash = HashParticle(hash, data);
+    }
+    return hash;
+}
+
+// --- accum ---
+
+std::uint64_t HashCells(std::uint64_t hash, G4int sector, G4int stack, G4int zCell, G4int phiCell, G4double edep)
+{
+    hash = Mix(hash, static_cast<std::uint64_t>(sector) << 48 | static_cast<std::uint64_t>(stack) << 32 |
+                     static_cast<std::uint64_t>(zCell + 1) << 16 | static_cast<std::uint64_t>(phiCell + 1));
+    return Mix(hash, Bits(edep));
+}
+
+std::uint64_t AccumBaseline()
+{
+    std::map<CellIdentifier, G4double> cellEnergyMap;
+    std::uint64_t hash = 0;
+    for (const MylarHitsCollection* hits : gHitCollections) {
+        cellEnergyMap.clear();
+        EventAction::AccumulateHits(*hits, cellEnergyMap, nullptr);
+        for (const auto& pair : cellEnergyMap) {
+            const CellIdentifier& cell = pair.first;
+            hash = HashCells(hash, std::get<0>(cell), std::get<1>(cell), std::get<2>(cell), std::get<3>(cell), pair.second);
+        }
+    }
+    return hash;
+}
+
+// Packed keys in a reused vector, stable-sorted and summed run by run: same cell order
+// and the same summation order as the map
+std::uint64_t AccumSortedVector()
+{
+    std::vector<std::pair<std::uint64_t, G4double>> deposits;
+    std::uint64_t hash = 0;
+    for (const MylarHitsCollection* hits : gHitCollections) {
+        deposits.clear();
+        const G4int nHits = hits->entries();
+        for (G4int i = 0; i < nHits; ++i) {
+            const MylarHit* hit = (*hits)[i];
+            const std::uint64_t key = static_cast<std::uint64_t>(hit->GetSectorNumber()) << 48 |
+                                      static_cast<std::uint64_t>(hit->GetStackNumber()) << 32 |
+                                      static_cast<std::uint64_t>(hit->GetZCellID() + 1) << 16 |
+                                      static_cast<std::uint64_t>(hit->GetPhiCellID() + 1);
+            deposits.emplace_back(key, hit->GetEnergyDeposited());
+        }
+        std::stable_sort(deposits.begin(), deposits.end(),
+                         [](const std::pair<std::uint64_t, G4double>& a, const std::pair<std::uint64_t, G4double>& b) {
+                             return a.first < b.first;
+                         });
+        for (std::size_t i = 0; i < deposits.size();) {
+            const std::uint64_t key = deposits[i].first;
+            G4double sum = 0.;
+            for (; i < deposits.size() && deposits[i].first == key; ++i) sum += deposits[i].second;
+            hash = HashCells(hash, static_cast<G4int>(key >> 48), static_cast<G4int>((key >> 32) & 0xffff),
+                             static_cast<G4int>((key >> 16) & 0xffff) - 1, static_cast<G4int>(key & 0xffff) - 1, sum);
+        }
+    }
+    return hash;
+}
+
+// --- format ---
+
+std::uint64_t FormatBaseline()
+{
+    std::ostringstream out;
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::size_t event = 0; event < gCellMaps.size(); ++event) {
+        out.str("");
+        EventAction::WriteCells(out, static_cast<G4int>(event), gCellMaps[event]);
+        const std::string text = out.str();
+        hash = HashText(text.data(), text.size(), hash);
+    }
+    return hash;
+}
+
+// snprintf into a reused buffer; "%g" is the default ostream floating-point format
+std::uint64_t FormatSnprintf()
+{
+    std::string text;
+    char line[96];
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::size_t event = 0; event < gCellMaps.size(); ++event) {
+        text.clear();
+        for (const auto& pair : gCellMaps[event]) {
+            const CellIdentifier& cell = pair.first;
+            const G4int n = std::snprintf(line, sizeof(line), "%d %d %d %d %d %g\n", static_cast<G4int>(event),
+                                          std::get<0>(cell), std::get<1>(cell), std::get<2>(cell), std::get<3>(cell),
+                                          pair.second / keV);
+            text.append(line, n);
+        }
+        hash = HashText(text.data(), text.size(), hash);
+    }
+    return hash;
+}
+
+// --- Harness ---
+
+struct Variant {
+    std::string group;
+    std::string name;  // "baseline" is the production code
+    std::uint64_t (*pass)();
+    std::size_t itemsPerPass;
+};
+
+struct Result {
+    Variant variant;
+    G4double nsPerItem;
+    std::uint64_t checksum;
+    G4bool matchesBaseline;
+    G4double speedup;
+};
+
+volatile std::uint64_t gSink; // keeps the passes from being optimised away
+
+// Repeats whole passes until minTime has elapsed; the best of five such batches is kept
+G4double TimePass(const Variant& variant, G4double minTime)
+{
+    G4double best = 0.;
+    for (G4int batch = 0; batch < 5; ++batch) {
+        G4int passes = 0;
+        auto start = std::chrono::steady_clock::now();
+        G4double elapsed = 0.;
+        do {
+            gSink = variant.pass();
+            ++passes;
+            elapsed = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < minTime / 5.);
+        const G4double ns = 1.e9 * elapsed / (static_cast<G4double>(passes) * variant.itemsPerPass);
+        if (batch == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string filter = "";
+    G4double minTime = 0.5;
+    std::string jsonFileName = "";
+    for (G4int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc) minTime = std::atof(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc) jsonFileName = argv[++i];
+        else {
+            std::cerr << "Usage: klm_microbench [--filter substring] [--min-time seconds] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Grid and radial layers of the detector as built with its default (/klm/geometry/) parameters;
+    // the sensitive detector is the production one, only not attached to the geometry
+    DetectorConstruction* detector = new DetectorConstruction();
+    detector->Construct();
+    MylarSD* mylarSD = new MylarSD("MicrobenchSD", "MicrobenchHits", detector);
+    gMylarSD = mylarSD;
+    gGrid.halfZ = detector->GetKLMHalfLength();
+    gGrid.sectorAngle = detector->GetKLMSectorAngle();
+    gGrid.numZCells = detector->GetNumZCells();
+    gGrid.numPhiCells06 = detector->GetNumPhiCells06();
+    gGrid.numPhiCells714 = detector->GetNumPhiCells714();
+    gGrid.numStacks = 0;
+    for (const KLMRadialLayer& layer : detector->GetRadialLayers()) {
+        gGrid.numStacks = std::max(gGrid.numStacks, layer.stack + 1);
+        if (layer.isGasGap) gGrid.gasGaps.push_back(layer);
+    }
+    std::mt19937_64 rng(20240501);
+    gLocalHits = MakeLocalHits(gGrid, rng);
+    gCellEvents = MakeCellEvents(gGrid, rng);
+    gParticleLines = MakeParticleLines(rng);
+    // Hits collections as MylarSD fills them, including the strings of every hit
+    for (const auto& event : gCellEvents) {
+        MylarHitsCollection* hits = new MylarHitsCollection("MicrobenchSD", "MicrobenchHits");
+        for (const CellHit& cell : event) {
+            MylarHit* hit = new MylarHit();
+            hit->SetParticleName(cell.edep > 2. * keV ? "e-" : "mu-");
+            const G4String volumeName = detector->GetSublayerName(cell.subLayerID) + "_S" + std::to_string(cell.stack) + "_Log";
+            hit->SetVolumeName(volumeName);
+            hit->SetMylarLayerType(detector->GetSublayerName(cell.subLayerID));
+            hit->SetEnergyDeposited(cell.edep);
+            hit->SetGlobalTime(cell.time);
+            hit->SetSectorNumber(cell.sector);
+            hit->SetStackNumber(cell.stack);
+            hit->SetZCellID(cell.zCell);
+            hit->SetPhiCellID(cell.phiCell);
+            hits->insert(hit);
+        }
+        gHitCollections.push_back(hits);
+    }
+    std::size_t nCellLines = 0;
+    for (const MylarHitsCollection* hits : gHitCollections) {
+        std::map<CellIdentifier, G4double> cells;
+        EventAction::AccumulateHits(*hits, cells, nullptr);
+        nCellLines += cells.size();
+        gCellMaps.push_back(std::move(cells));
+    }
+    const std::size_t nCellHits = static_cast<std::size_t>(kEvents) * kHitsPerEvent;
+
+    // The first variant of each group is its baseline
+    const std::vector<Variant> variants = {
+        {"cells",  "baseline",      CellsBaseline,     gLocalHits.size()},
+        {"cells",  "reciprocal",    CellsReciprocal,   gLocalHits.size()},
+        {"parse",  "baseline",      ParseBaseline,     gParticleLines.size()},
+        {"parse",  "strtod",        ParseStrtod,       gParticleLines.size()},
+        {"accum",  "baseline",      AccumBaseline,     nCellHits},
+        {"accum",  "sorted_vector", AccumSortedVector, nCellHits},
+        {"format", "baseline",      FormatBaseline,    nCellLines},
+        {"format", "snprintf",      FormatSnprintf,    nCellLines},
+    };
+
+    std::vector<Result> results;
+    std::uint64_t baselineChecksum = 0;
+    G4double baselineNs = 0.;
+    std::cout << std::left << std::setw(24) << "benchmark" << std::right << std::setw(12) << "ns/item"
+              << std::setw(14) << "items/s" << std::setw(10) << "speedup" << "  check" << std::endl;
+    for (const Variant& variant : variants) {
+        const std::string fullName = variant.group + "/" + variant.name;
+        const G4bool isBaseline = variant.name == "baseline";
+        // A selected variant always runs with its group baseline
+        const G4bool groupSelected = std::any_of(variants.begin(), variants.end(), [&](const Variant& other) {
+            return other.group == variant.group && (other.group + "/" + other.name).find(filter) != std::string::npos;
+        });
+        if (!groupSelected || (!isBaseline && fullName.find(filter) == std::string::npos)) continue;
+
+        const std::uint64_t checksum = variant.pass();
+        const G4double ns = TimePass(variant, minTime);
+        if (isBaseline) {
+            baselineChecksum = checksum;
+            baselineNs = ns;
+        }
+        Result result{variant, ns, checksum, checksum == baselineChecksum, ns > 0. ? baselineNs / ns : 0.};
+        results.push_back(result);
+        std::cout << std::left << std::setw(24) << fullName << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(12) << ns
+                  << std::setprecision(0) << std::setw(14) << (ns > 0. ? 1.e9 / ns : 0.)
+                  << std::setprecision(2) << std::setw(9) << result.speedup << "x"
+                  << "  " << (result.matchesBaseline ? "ok" : "DIFFERS") << std::endl;
+    }
+
+    if (!jsonFileName.empty()) {
+        std::ofstream json(jsonFileName);
+        json << std::fixed << std::setprecision(3) << "{\n  \"schema\": \"klm_microbench/1\",\n  \"results\": [\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            json << "    {\"group\": \"" << r.variant.group << "\", \"variant\": \"" << r.variant.name
+                 << "\", \"ns_per_item\": " << r.nsPerItem << ", \"speedup\": " << r.speedup
+                 << ", \"matches_baseline\": " << (r.matchesBaseline ? "true" : "false") << "}"
+                 << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        json << "  ]\n}\n";
+    }
+
+    for (MylarHitsCollection* hits : gHitCollections) delete hits;
+    delete mylarSD;
+    delete detector;
+    const G4bool allMatch = std::all_of(results.begin(), results.end(), [](const Result& r) { return r.matchesBaseline; });
+    return allMatch ? 0 : 3;
+}
@@ -0,0 +1,97 @@
+// Builds a background frame library for /klm/overlay/ (BackgroundOverlay)
+// from cell-energy files of background-only simulations: every event,
+// including events without cells ("# event" lines), becomes one frame.
+// Cell files carry no times, and background is not in time with the
+// trigger: each source event gets one time drawn uniformly over the readout
+// window (--window), shared by all its cells.
+#include "BackgroundOverlay.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    G4String libraryFileName = "";
+    std::vector<G4String> cellFileNames;
+    G4double windowMin = 0. * ns;
+    G4double windowMax = 1000. * ns;
+    G4long seed = 0;
+    for (G4int i = 1; i < argc; ++i) {
+        G4String arg = argv[i];
+        if (arg == "--window" && i + 2 < argc) {
+            windowMin = std::atof(argv[++i]) * ns;
+            windowMax = std::atof(argv[++i]) * ns;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::atol(argv[++i]);
+        } else if (libraryFileName.empty()) {
+            libraryFileName = arg;
+        } else {
+            cellFileNames.push_back(arg);
+        }
+    }
+    if (cellFileNames.empty() || windowMax < windowMin) {
+        G4cerr << "Usage: klm_mkbkg [options] <library.bkg> <background_cells.txt> [more_cells.txt ...]\n"
+               << "Options: --window MIN MAX (readout window in ns, default 0 1000)  --seed N (0)" << G4endl;
+        return 1;
+    }
+
+    std::mt19937_64 engine(static_cast<std::uint64_t>(seed));
+    std::uniform_real_distribution<G4double> frameTime(windowMin, windowMax);
+    std::vector<std::vector<KLMCellDeposit> > frames;
+    std::size_t nCells = 0;
+    for (const G4String& cellFileName : cellFileNames) {
+        std::ifstream input(cellFileName);
+        if (!input) {
+            G4cerr << "klm_mkbkg: cannot read " << cellFileName << G4endl;
+            return 1;
+        }
+        G4int currentEvent = -1;
+        G4double currentTime = 0.;
+        std::string line;
+        while (std::getline(input, line)) {
+            if (line.empty()) continue;
+            std::istringstream fields(line);
+            G4int eventID = -1;
+            KLMCellDeposit cell = {};
+            G4double edepKeV = 0.;
+            if (line.compare(0, 8, "# event ") == 0) {
+                std::string hash, word;
+                fields >> hash >> word >> eventID; // seed record of an event, possibly without cells
+            } else if (line[0] == '#') {
+                continue;
+            } else if (!(fields >> eventID >> cell.sector >> cell.stack >> cell.zCell >> cell.phiCell >> edepKeV)) {
+                G4cerr << "klm_mkbkg: skipping malformed line: " << line << G4endl;
+                continue;
+            }
+            if (eventID != currentEvent) {
+                frames.emplace_back();
+                currentEvent = eventID;
+                currentTime = frameTime(engine);
+            }
+            if (line[0] != '#') {
+                cell.edep = edepKeV * keV;
+                cell.time = currentTime;
+                frames.back().push_back(cell);
+                nCells++;
+            }
+        }
+    }
+    if (frames.empty()) {
+        G4cerr << "klm_mkbkg: no events in the input files." << G4endl;
+        return 1;
+    }
+    if (!BackgroundOverlay::Write(libraryFileName, frames)) {
+        G4cerr << "klm_mkbkg: cannot write " << libraryFileName << G4endl;
+        return 1;
+    }
+    G4cout << "klm_mkbkg: " << frames.size() << " frames, " << nCells << " cells -> "
+           << libraryFileName << G4endl;
+    return 0;
+}
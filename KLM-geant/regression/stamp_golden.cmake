@@ -0,0 +1,5 @@
+# Copies a sample output to its golden file, with the Geant4 version that made it
+# as the first line ("klm_compare --geant4" rejects a golden of another version).
+#   cmake -DSOURCE=<cells.txt> -DGOLDEN=<golden.txt> -DGEANT4_VERSION=<version> -P stamp_golden.cmake
+file(READ ${SOURCE} cells)
+file(WRITE ${GOLDEN} "# golden geant4 ${GEANT4_VERSION}\n${cells}")
@@ -3,7 +3,17 @@
 #include "RunAction.hh"
 #include "EventAction.hh"
 #include "SteppingAction.hh" // If still used
+#include "StackingAction.hh"
+#include "TrackKiller.hh"
+#include "StepProfiler.hh"
+#include "EventTelemetry.hh"
+#include "EventWatchdog.hh"
+#include "RunCheckpoint.hh"
+#include "KLMDigitizer.hh"
+#include "BackgroundOverlay.hh"
+#include "KLMClusterReco.hh"
 #include "G4HepMCInterface.hh"
+#include "GunGeneratorAction.hh"
 // #include "TrackingAction.hh" // <<< REMOVE or comment out
 
 ActionInitialization::ActionInitialization(const G4String& inputFilename)
@@ -14,26 +24,63 @@ ActionInitialization::ActionInitialization(const G4String& inputFilename)
 ActionInitialization::~ActionInitialization()
 {}
 
-void ActionInitialization::Build() const
+InputGeneratorAction* ActionInitialization::CreateGenerator(const G4String& inputFilename)
 {
-  if (fInputFilename.contains(".hepmc")) {
-    G4cout << "ActionInitialization: Using G4HepMCInterface for file: " << fInputFilename << G4endl;
-    SetUserAction(new G4HepMCInterface(fInputFilename)); // Use YOUR HepMC interface
-} else {
-    G4cout << "ActionInitialization: Using PrimaryGeneratorAction (custom format) for file: " << fInputFilename << G4endl;
-    SetUserAction(new PrimaryGeneratorAction(fInputFilename)); // Use your custom format reader
+  if (inputFilename == "gun") {
+    G4cout << "ActionInitialization: Using the built-in gun (/klm/gun/)" << G4endl;
+    return new GunGeneratorAction();
+  }
+  if (inputFilename.contains(".hepmc")) {
+    G4cout << "ActionInitialization: Using G4HepMCInterface for file: " << inputFilename << G4endl;
+    return new G4HepMCInterface(inputFilename); // Use YOUR HepMC interface
+  }
+  G4cout << "ActionInitialization: Using PrimaryGeneratorAction (custom format) for file: " << inputFilename << G4endl;
+  return new PrimaryGeneratorAction(inputFilename); // Use your custom format reader
 }
 
+void ActionInitialization::Build() const
+{
+  // No input in server mode: each job installs its own generator
+  if (!fInputFilename.empty()) {
+    SetUserAction(CreateGenerator(fInputFilename));
+  }
+
   RunAction* runAction = new RunAction("summarized_cell_energy.txt"); // New output file name
   SetUserAction(runAction);
 
-  SteppingAction* steppingAction = nullptr;
-  // if (you_need_stepping_action) {
-  //   steppingAction = new SteppingAction("RPCSuperlayer");
-  //   SetUserAction(steppingAction);
-  // }
+  // Geometry-aware track killer, shared by the stacking and stepping actions
+  TrackKiller* trackKiller = new TrackKiller();
+  runAction->SetTrackKiller(trackKiller);
+  StackingAction* stackingAction = new StackingAction(trackKiller);
+  SetUserAction(stackingAction);
+
+  // Empty material name: no kill-after-RPC, only the hooks below
+  SteppingAction* steppingAction = new SteppingAction();
+  steppingAction->SetTrackKiller(trackKiller);
+  // Step profiler, off until /klm/profile/steps/enable true
+  StepProfiler* stepProfiler = new StepProfiler();
+  runAction->SetStepProfiler(stepProfiler);
+  steppingAction->SetStepProfiler(stepProfiler);
+  // Runaway-event guard, inactive until a /klm/watchdog/ limit is set
+  EventWatchdog* eventWatchdog = new EventWatchdog();
+  runAction->SetEventWatchdog(eventWatchdog);
+  stackingAction->SetEventWatchdog(eventWatchdog);
+  steppingAction->SetEventWatchdog(eventWatchdog);
+  SetUserAction(steppingAction);
+
+  // Per-event telemetry (slowest-event report always, files on request)
+  runAction->SetEventTelemetry(new EventTelemetry());
+  // Periodic <output>.ckpt for "klm_barrel --resume"
+  runAction->SetRunCheckpoint(new RunCheckpoint());
+  // Strip digitizer, off until /klm/digi/enable true
+  runAction->SetKLMDigitizer(new KLMDigitizer());
+  // Background overlay, off until /klm/overlay/library is set
+  runAction->SetBackgroundOverlay(new BackgroundOverlay());
+  // Inline cluster reconstruction, off until /klm/reco/enable true
+  runAction->SetKLMClusterReco(new KLMClusterReco());
 
   EventAction* eventAction = new EventAction(runAction, steppingAction);
+  eventAction->SetStackingAction(stackingAction);
   SetUserAction(eventAction);
 
   // TrackingAction* trackingAction = new TrackingAction(eventAction); // <<< REMOVE or comment out
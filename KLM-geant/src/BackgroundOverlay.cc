@@ -0,0 +1,175 @@
+#include "BackgroundOverlay.hh"
+#include "EventSeeder.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  const char kMagic[8] = {'K', 'L', 'M', 'B', 'K', 'G', '0', '1'};
+}
+
+BackgroundOverlay::BackgroundOverlay()
+ : fMessenger(nullptr),
+   fRate(1.),
+   fSeed(0),
+   fMapping(nullptr),
+   fMappingSize(0),
+   fNumFrames(0),
+   fOffsets(nullptr),
+   fCells(nullptr)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/overlay/", "Background overlay from a frame library");
+  fMessenger->DeclareMethod("library", &BackgroundOverlay::SetLibrary,
+      "Background frame library written by klm_mkbkg (empty: no overlay).");
+  fMessenger->DeclareProperty("rate", fRate, "Mean background frames per signal event (0: off).");
+  fMessenger->DeclareProperty("seed", fSeed, "Overlay seed; each seed gives an independent background variant.");
+}
+
+BackgroundOverlay::~BackgroundOverlay()
+{
+  Close();
+  delete fMessenger;
+}
+
+G4bool BackgroundOverlay::Open(const G4String& fileName)
+{
+  Close();
+  if (fileName.empty()) return true;
+
+  int fd = open(fileName.c_str(), O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0) {
+    G4cerr << "BackgroundOverlay: cannot open " << fileName << G4endl;
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  fMappingSize = static_cast<std::size_t>(status.st_size);
+  void* mapping = fMappingSize > 0 ? mmap(nullptr, fMappingSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd); // the mapping stays valid
+  if (mapping == MAP_FAILED) {
+    G4cerr << "BackgroundOverlay: cannot map " << fileName << G4endl;
+    fMappingSize = 0;
+    return false;
+  }
+
+  // --- Validate header and index against the file size ---
+  const char* bytes = static_cast<const char*>(mapping);
+  std::uint64_t nFrames = 0;
+  G4bool valid = fMappingSize >= 16 && std::memcmp(bytes, kMagic, 8) == 0;
+  if (valid) {
+    std::memcpy(&nFrames, bytes + 8, sizeof(nFrames));
+    valid = nFrames > 0 && (fMappingSize - 16) / 8 > nFrames;
+  }
+  const std::uint64_t* offsets = reinterpret_cast<const std::uint64_t*>(bytes + 16);
+  const std::size_t cellStart = 16 + 8 * (nFrames + 1);
+  for (std::uint64_t i = 0; valid && i < nFrames; ++i) valid = offsets[i] <= offsets[i + 1];
+  if (valid) {
+    valid = (fMappingSize - cellStart) / sizeof(Cell) >= offsets[nFrames];
+  }
+  if (!valid) {
+    G4cerr << "BackgroundOverlay: " << fileName << " is not a valid background library." << G4endl;
+    munmap(mapping, fMappingSize);
+    fMappingSize = 0;
+    return false;
+  }
+
+  fMapping = mapping;
+  fNumFrames = nFrames;
+  fOffsets = offsets;
+  fCells = reinterpret_cast<const Cell*>(bytes + cellStart);
+  G4cout << "BackgroundOverlay: " << fNumFrames << " frames, " << offsets[nFrames]
+         << " cells mapped from " << fileName << G4endl;
+  return true;
+}
+
+void BackgroundOverlay::Close()
+{
+  if (fMapping) munmap(fMapping, fMappingSize);
+  fMapping = nullptr;
+  fMappingSize = 0;
+  fNumFrames = 0;
+  fOffsets = nullptr;
+  fCells = nullptr;
+}
+
+void BackgroundOverlay::AppendFrame(std::uint64_t frame, G4double keepProbability,
+                                    std::vector<KLMCellDeposit>& cells)
+{
+  std::uniform_real_distribution<G4double> uniform(0., 1.);
+  for (std::uint64_t i = fOffsets[frame]; i < fOffsets[frame + 1]; ++i) {
+    if (keepProbability < 1. && uniform(fEngine) >= keepProbability) continue;
+    const Cell& cell = fCells[i];
+    cells.push_back(KLMCellDeposit{cell.sector, cell.stack, cell.zCell, cell.phiCell,
+                                   cell.edepKeV * keV, cell.timeNs * ns});
+  }
+}
+
+void BackgroundOverlay::Sample(G4int eventID, std::vector<KLMCellDeposit>& cells)
+{
+  if (!IsActive()) return;
+  fEngine.seed(static_cast<std::uint64_t>(EventSeeder::EventSeed(fSeed, eventID)));
+  std::uniform_int_distribution<std::uint64_t> pickFrame(0, fNumFrames - 1);
+  const G4double whole = std::floor(fRate);
+  for (G4int i = 0; i < static_cast<G4int>(whole); ++i) AppendFrame(pickFrame(fEngine), 1., cells);
+  if (fRate > whole) AppendFrame(pickFrame(fEngine), fRate - whole, cells);
+}
+
+void BackgroundOverlay::MergeCells(std::vector<KLMCellDeposit>& cells)
+{
+  auto key = [](const KLMCellDeposit& cell) {
+    return std::make_tuple(cell.sector, cell.stack, cell.zCell, cell.phiCell);
+  };
+  std::sort(cells.begin(), cells.end(), [&](const KLMCellDeposit& a, const KLMCellDeposit& b) {
+    return key(a) < key(b);
+  });
+  std::size_t nMerged = 0;
+  for (std::size_t i = 0; i < cells.size(); ++i) {
+    if (nMerged > 0 && key(cells[nMerged - 1]) == key(cells[i])) {
+      cells[nMerged - 1].edep += cells[i].edep;
+      cells[nMerged - 1].time = std::min(cells[nMerged - 1].time, cells[i].time);
+    } else {
+      cells[nMerged++] = cells[i];
+    }
+  }
+  cells.resize(nMerged);
+}
+
+G4bool BackgroundOverlay::Write(const G4String& fileName, const std::vector<std::vector<KLMCellDeposit> >& frames)
+{
+  const std::string tmpName = fileName + ".tmp";
+  std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+  if (!out) return false;
+  const std::uint64_t nFrames = frames.size();
+  out.write(kMagic, 8);
+  out.write(reinterpret_cast<const char*>(&nFrames), sizeof(nFrames));
+  std::uint64_t offset = 0;
+  for (const auto& frame : frames) {
+    out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    offset += frame.size();
+  }
+  out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  for (const auto& frame : frames) {
+    for (const KLMCellDeposit& deposit : frame) {
+      Cell cell = {static_cast<std::int16_t>(deposit.sector), static_cast<std::int16_t>(deposit.stack),
+                   static_cast<std::int16_t>(deposit.zCell), static_cast<std::int16_t>(deposit.phiCell),
+                   static_cast<float>(deposit.edep / keV), static_cast<float>(deposit.time / ns)};
+      out.write(reinterpret_cast<const char*>(&cell), sizeof(cell));
+    }
+  }
+  out.close();
+  if (!out) return false;
+  return std::rename(tmpName.c_str(), fileName.c_str()) == 0;
+}
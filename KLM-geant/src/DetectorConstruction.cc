@@ -1,13 +1,21 @@
 #include "DetectorConstruction.hh"
 #include "MylarSD.hh" // Will create this later
+#include "KLMSublayerParameterisation.hh"
+#include "StartupProfiler.hh"
+#include "FastMuonModel.hh"
+#include "KLShowerModel.hh"
 
 #include "G4NistManager.hh"
 #include "G4Material.hh"
 #include "G4Element.hh"
 #include "G4Box.hh"
 #include "G4Polyhedra.hh"
+#include "G4Trd.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
+#include "G4PVParameterised.hh"
+#include "G4VTouchable.hh"
+#include "G4GenericMessenger.hh"
 #include "G4RotationMatrix.hh"
 #include "G4ThreeVector.hh"
 #include "G4SystemOfUnits.hh"
@@ -21,7 +29,13 @@
 #include "G4RunManager.hh"
 #include "G4UnitsTable.hh"
 #include "G4GeometryManager.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCutsTable.hh"
 #include <numeric> // For std::accumulate if needed, though manual sum is fine
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
 
 // Constructor: Initialize material pointers and calculate fRPCStackThickness
 DetectorConstruction::DetectorConstruction()
@@ -29,20 +43,114 @@ DetectorConstruction::DetectorConstruction()
   fWorldMaterial(nullptr), fIronMaterial(nullptr),
   fMylarMaterial(nullptr), fCopperMaterial(nullptr), fFoamMaterial(nullptr),
   fRPCGasMaterial(nullptr), fGlassMaterial(nullptr),
-  fWorldPV(nullptr)
+  fWorldPV(nullptr),
+  fMessenger(nullptr),
+  fLayeringMode("placement"),
+  fParameterisedLayering(false),
+  fCheckOverlaps(false),
+  fKLMBarrelOuterRadius(0.),
+  fMylarSD(nullptr),
+  fFastMuonModel(nullptr),
+  fKLShowerModel(nullptr),
+  fRPCStackThickness(0.)
 {
-    // Calculate total thickness of one RPC superlayer stack based on component thicknesses
-    fRPCStackThickness = (t_Mylar_GP_CP * 2) * 2 +  // 2x Mylar in 2x GP/CP structures
-                         (t_Copper_GP_CP * 2) * 2 + // 2x Copper in 2x GP/CP structures
-                         (t_Foam * 2) +             // 2x Foam layers
-                         (t_HV_Region_Glass * 4) +  // 4x Glass layers
-                         (t_GasGap * 2) +           // 2x Gas Gaps
-                         t_Mylar_Insulator;         // 1x Insulator Mylar
-    G4cout << "Calculated fRPCStackThickness: " << G4BestUnit(fRPCStackThickness, "Length") << G4endl;
+    fMessenger = new G4GenericMessenger(this, "/klm/geometry/", "KLM geometry control");
+    fMessenger->DeclareProperty("layering", fLayeringMode,
+        "Sublayer build mode: placement (one LV per sublayer) or parameterised (shared LV per stack).")
+        .SetCandidates("placement parameterised")
+        .SetStates(G4State_PreInit);
+    fMessenger->DeclareProperty("checkOverlaps", fCheckOverlaps,
+        "Check overlaps serially at every placement (slow; prefer klm_barrel --check-geometry).")
+        .SetStates(G4State_PreInit);
+
+    // Dimensions and granularity: before /run/initialize, or between runs followed by /klm/geometry/update
+    fMessenger->DeclareProperty("nStacks", fNbDetectorLayers, "Number of RPC stacks (detector layers).")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclareProperty("nSectors", fKLMBarrelNumSides, "Number of barrel sectors (polygon sides).")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclareProperty("nIronLayers", fNbIronLayers, "Number of iron plates, one behind each of the first stacks.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclarePropertyWithUnit("ironThickness", "mm", fIronThickness, "Iron plate thickness.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclarePropertyWithUnit("innerRadius", "cm", fKLMBarrelInnerRadius, "Inner radius of the barrel (face distance).")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclarePropertyWithUnit("halfLength", "cm", fKLMBarrelHalfLength, "Half length of the barrel.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclarePropertyWithUnit("gasGapThickness", "mm", t_GasGap, "RPC gas gap thickness.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclarePropertyWithUnit("glassThickness", "mm", t_HV_Region_Glass, "RPC glass electrode thickness.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclarePropertyWithUnit("foamThickness", "mm", t_Foam, "Dielectric foam thickness.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclarePropertyWithUnit("mylarThickness", "mm", t_Mylar_GP_CP, "Mylar thickness of the ground and cathode planes.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclarePropertyWithUnit("copperThickness", "mm", t_Copper_GP_CP, "Copper thickness of the ground and cathode planes.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclarePropertyWithUnit("insulatorThickness", "mm", t_Mylar_Insulator, "Central insulator Mylar thickness.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclareProperty("phiCellsInner", fNumPhiCells_MylarGrid06, "Phi cells per sector in stacks 0-6.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclareProperty("phiCellsOuter", fNumPhiCells_MylarGrid714, "Phi cells per sector in stacks 7-14.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclareProperty("zCells", fNumZCells_MylarGrid, "Z cells along the barrel.")
+        .SetStates(G4State_PreInit, G4State_Idle);
+    fMessenger->DeclareMethod("update", &DetectorConstruction::UpdateGeometry,
+        "Rebuild the geometry with the current parameters (physics tables are kept).")
+        .SetStates(G4State_Idle);
+}
+
+// FNV-1a over every parameter that shapes the geometry; keys the overlap-check cache
+std::string DetectorConstruction::GetGeometryHash() const
+{
+  std::uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](const void* data, std::size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+  };
+  const G4int ints[] = {fNbIronLayers, fNbDetectorLayers, fKLMBarrelNumSides};
+  const G4double doubles[] = {fIronThickness, fKLMBarrelInnerRadius, fKLMBarrelHalfLength,
+                              t_Mylar_GP_CP, t_Copper_GP_CP, t_Foam, t_HV_Region_Glass,
+                              t_GasGap, t_Mylar_Insulator};
+  mix(ints, sizeof(ints));
+  mix(doubles, sizeof(doubles));
+  mix(fLayeringMode.data(), fLayeringMode.size());
+
+  std::ostringstream os;
+  os << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return os.str();
+}
+
+std::string DetectorConstruction::ParameterKey() const
+{
+  std::ostringstream os;
+  os << GetGeometryHash() << " " << fNumPhiCells_MylarGrid06 << " " << fNumPhiCells_MylarGrid714
+     << " " << fNumZCells_MylarGrid;
+  return os.str();
 }
 
 DetectorConstruction::~DetectorConstruction()
 {
+  delete fMessenger;
+}
+
+void DetectorConstruction::DecodeTouchable(const G4VTouchable* touchable, G4int& sector, G4int& stack,
+                                           G4int& subLayerID, G4int& sectorDepth) const
+{
+  if (fParameterisedLayering) {
+    // sublayer copy (== subLayerID) -> stack envelope (copyNo == stack) -> sector
+    subLayerID = touchable->GetReplicaNumber(0);
+    stack = touchable->GetCopyNumber(1);
+    sectorDepth = 2;
+  } else {
+    G4int sublayerCopyNo = touchable->GetCopyNumber(0); // iStack * 100 + subLayerID
+    stack = sublayerCopyNo / 100;
+    subLayerID = sublayerCopyNo % 100;
+    sectorDepth = 1;
+  }
+  sector = touchable->GetCopyNumber(sectorDepth);
 }
 
 // DefineMaterials based on user's provided code
@@ -138,6 +246,47 @@ void DetectorConstruction::DefineMaterials()
   G4cout << "------------------------------------" << G4endl;
 }
 
+G4bool DetectorConstruction::CheckParameters() const
+{
+  G4bool valid = true;
+  auto require = [&valid](G4bool condition, const char* message) {
+    if (!condition) {
+      G4cerr << "DetectorConstruction: " << message << G4endl;
+      valid = false;
+    }
+  };
+  // Channel keys (KLMDigitizer) and cluster layer masks (KLMClusterReco) pack the stack in 6 bits
+  require(fNbDetectorLayers >= 1 && fNbDetectorLayers <= 64, "nStacks must be between 1 and 64");
+  require(fKLMBarrelNumSides >= 3, "nSectors must be at least 3");
+  require(fNbIronLayers >= 0 && fNbIronLayers <= fNbDetectorLayers, "nIronLayers must be between 0 and nStacks");
+  require(fIronThickness > 0., "ironThickness must be positive");
+  require(fKLMBarrelInnerRadius > 0. && fKLMBarrelHalfLength > 0., "innerRadius and halfLength must be positive");
+  require(t_GasGap > 0. && t_HV_Region_Glass > 0. && t_Foam > 0. && t_Mylar_GP_CP > 0. &&
+          t_Copper_GP_CP > 0. && t_Mylar_Insulator > 0., "RPC sublayer thicknesses must be positive");
+  // One strip per cell; channel keys pack the strip in 10 bits
+  require(fNumPhiCells_MylarGrid06 >= 1 && fNumPhiCells_MylarGrid714 >= 1 && fNumZCells_MylarGrid >= 1 &&
+          fNumPhiCells_MylarGrid06 <= 1024 && fNumPhiCells_MylarGrid714 <= 1024 && fNumZCells_MylarGrid <= 1024,
+          "phiCellsInner, phiCellsOuter and zCells must be between 1 and 1024");
+  return valid;
+}
+
+// Between runs: drop the old volumes and construct again right away, so errors show at the
+// command and the next run starts with the new layout. Materials and cuts are unchanged,
+// so the physics tables are not rebuilt.
+void DetectorConstruction::UpdateGeometry()
+{
+  if (!CheckParameters()) {
+    G4cerr << "DetectorConstruction: geometry not updated, the previous layout stays in place;"
+           << " runs are refused until the parameters are fixed and updated." << G4endl;
+    return;
+  }
+  G4RunManager* runManager = G4RunManager::GetRunManager();
+  runManager->ReinitializeGeometry(true);
+  runManager->Initialize();
+  G4cout << "DetectorConstruction: geometry rebuilt (hash " << GetGeometryHash() << ", outer radius "
+         << G4BestUnit(fKLMBarrelOuterRadius, "Length") << ")" << G4endl;
+}
+
 // Helper GetKLMSectorLayerLogical remains the same
 G4LogicalVolume* DetectorConstruction::GetKLMSectorLayerLogical(
     const G4String& name, G4double innerRadius, G4double outerRadius, G4double halfLength,
@@ -161,7 +310,26 @@ G4LogicalVolume* DetectorConstruction::GetKLMSectorLayerLogical(
 // --- Construct method with Detailed RPC Stack ---
 G4VPhysicalVolume* DetectorConstruction::Construct()
 {
-  DefineMaterials(); // Define all materials first
+  if (!CheckParameters()) {
+    G4Exception("DetectorConstruction::Construct", "KLMGeometry001", FatalErrorInArgument,
+                "Invalid /klm/geometry/ parameters (see above).");
+  }
+  fBuiltParameters = ParameterKey();
+  // Materials are defined once; a rebuilt geometry (/klm/geometry/update) reuses them
+  if (!fWorldMaterial) {
+    StartupProfiler::Scope profile("DefineMaterials");
+    DefineMaterials(); // Define all materials first
+  }
+  StartupProfiler::Scope profile("GeometryBuild");
+
+  // Calculate total thickness of one RPC superlayer stack based on component thicknesses
+  fRPCStackThickness = (t_Mylar_GP_CP * 2) * 2 +  // 2x Mylar in 2x GP/CP structures
+                       (t_Copper_GP_CP * 2) * 2 + // 2x Copper in 2x GP/CP structures
+                       (t_Foam * 2) +             // 2x Foam layers
+                       (t_HV_Region_Glass * 4) +  // 4x Glass layers
+                       (t_GasGap * 2) +           // 2x Gas Gaps
+                       t_Mylar_Insulator;         // 1x Insulator Mylar
+  G4cout << "Calculated fRPCStackThickness: " << G4BestUnit(fRPCStackThickness, "Length") << G4endl;
 
   // --- Basic KLM Parameters ---
   G4double klmInnerRadius = fKLMBarrelInnerRadius;
@@ -177,7 +345,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 
   G4Box* solidWorld = new G4Box("WorldSolid", worldSizeXY, worldSizeXY, worldSizeZ);
   G4LogicalVolume* logicWorld = new G4LogicalVolume(solidWorld, fWorldMaterial, "WorldLog");
-  fWorldPV = new G4PVPlacement(0, G4ThreeVector(), logicWorld, "World", 0, false, 0, true);
+  fWorldPV = new G4PVPlacement(0, G4ThreeVector(), logicWorld, "World", 0, false, 0, fCheckOverlaps);
 
   // --- Visualization Attributes for Sublayers ---
   G4VisAttributes* visAttMylar  = new G4VisAttributes(G4Colour(0.9, 0.9, 0.2, 0.5)); // Yellowish
@@ -215,24 +383,52 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
                                                               "KLMSectorMotherLog");
   logicKLMSectorMother->SetVisAttributes(G4VisAttributes::GetInvisible());
 
+  // Region covering the whole sector structure (per-region time cuts, fast simulation)
+  G4Region* klmRegion = G4RegionStore::GetInstance()->GetRegion("KLMSectorRegion", false);
+  if (!klmRegion) {
+    klmRegion = new G4Region("KLMSectorRegion");
+    // Share the default cuts object so the region follows the physics list cuts
+    klmRegion->SetProductionCuts(G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts());
+  }
+  klmRegion->AddRootLogicalVolume(logicKLMSectorMother);
+
+  // --- Sublayer build mode ---
+  fParameterisedLayering = (fLayeringMode == "parameterised");
+  G4cout << "Sublayer layering mode: " << fLayeringMode << G4endl;
+  G4LogicalVolume* logicSharedSublayer = nullptr; // parameterised mode only
+
   // --- Loop to build fNbDetectorLayers of (RPC Stack + Iron) ---
   G4double currentRadialPosition = klmInnerRadius; // Starting radius for the first layer
+  fRadialLayers.clear();
+  fSublayerNames.clear();
+  fSublayerIsGas.clear();
 
   for (G4int iStack = 0; iStack < fNbDetectorLayers; ++iStack)
   {
     G4cout << "Building RPC Stack " << iStack << " starting at R = "
            << G4BestUnit(currentRadialPosition, "Length") << G4endl;
     G4double rpcStackStartR = currentRadialPosition;
+    std::vector<KLMSublayerParameterisation::Sublayer> stackSublayers; // parameterised mode only
 
-    // Define helper lambda to place a sublayer
+    // Define helper lambda to place a sublayer (or, in parameterised mode, record it for the stack)
     auto PlaceSublayer = [&](const G4String& namePrefix, G4double thickness, G4Material* mat, G4VisAttributes* visAtt, G4int subLayerID) {
-        G4String volName = namePrefix + "_S" + std::to_string(iStack); // Unique name
-        G4LogicalVolume* logicSub = GetKLMSectorLayerLogical(
-            volName, currentRadialPosition, currentRadialPosition + thickness, klmHalfLength,
-            -klmSectorAngle/2.0, klmSectorAngle, mat);
-        logicSub->SetVisAttributes(visAtt);
-        new G4PVPlacement(0, G4ThreeVector(), logicSub, volName + "_PV",
-                          logicKLMSectorMother, false, iStack * 100 + subLayerID, true); // Unique copyNo
+        if (fParameterisedLayering) {
+            stackSublayers.push_back({currentRadialPosition, currentRadialPosition + thickness, mat, visAtt});
+        } else {
+            G4String volName = namePrefix + "_S" + std::to_string(iStack); // Unique name
+            G4LogicalVolume* logicSub = GetKLMSectorLayerLogical(
+                volName, currentRadialPosition, currentRadialPosition + thickness, klmHalfLength,
+                -klmSectorAngle/2.0, klmSectorAngle, mat);
+            logicSub->SetVisAttributes(visAtt);
+            new G4PVPlacement(0, G4ThreeVector(), logicSub, volName + "_PV",
+                              logicKLMSectorMother, false, iStack * 100 + subLayerID, fCheckOverlaps); // Unique copyNo
+        }
+        if (iStack == 0) {
+            fSublayerNames.push_back(namePrefix);
+            fSublayerIsGas.push_back(mat == fRPCGasMaterial);
+        }
+        fRadialLayers.push_back({currentRadialPosition, currentRadialPosition + thickness,
+                                 iStack, subLayerID, mat == fRPCGasMaterial, mat});
         currentRadialPosition += thickness;
     };
 
@@ -305,6 +501,31 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
     PlaceSublayer("InnerGPCu2", t_Copper_GP_CP, fCopperMaterial, visAttCopper, 32);
     PlaceSublayer("InnerGPMylar2", t_Mylar_GP_CP, fMylarMaterial, visAttMylar, 33);
 
+    // --- Parameterised mode: one stack envelope holding the 34 sublayers as copies of a shared LV ---
+    // (a parameterised volume must be the only daughter of its mother, hence the envelope)
+    if (fParameterisedLayering) {
+        if (!logicSharedSublayer) {
+            const KLMSublayerParameterisation::Sublayer& first = stackSublayers.front();
+            G4Trd* solidSublayer = new G4Trd("RPCSublayer_Solid", klmHalfLength, klmHalfLength,
+                                             first.rMin * std::tan(klmSectorAngle/2.0),
+                                             first.rMax * std::tan(klmSectorAngle/2.0),
+                                             0.5 * (first.rMax - first.rMin));
+            logicSharedSublayer = new G4LogicalVolume(solidSublayer, first.material, "RPCSublayer_Log");
+        }
+        G4String stackName = "RPCStack_S" + std::to_string(iStack);
+        G4LogicalVolume* logicStack = GetKLMSectorLayerLogical(
+            stackName, stackSublayers.front().rMin, stackSublayers.back().rMax, klmHalfLength,
+            -klmSectorAngle/2.0, klmSectorAngle, fWorldMaterial);
+        logicStack->SetVisAttributes(G4VisAttributes::GetInvisible());
+        new G4PVPlacement(0, G4ThreeVector(), logicStack, stackName + "_PV",
+                          logicKLMSectorMother, false, iStack, fCheckOverlaps); // copyNo == stack
+        auto* parameterisation = new KLMSublayerParameterisation(iStack, stackSublayers,
+                                                                 klmHalfLength, klmSectorAngle);
+        new G4PVParameterised(stackName + "_Sublayers_PV", logicSharedSublayer, logicStack,
+                              kUndefined, parameterisation->GetNumberOfSublayers(),
+                              parameterisation, fCheckOverlaps);
+    }
+
     // --- Place Iron layer if applicable ---
     if (iStack < fNbIronLayers) {
         G4cout << "Building Iron Layer " << iStack << " after RPC Stack, starting at R = "
@@ -315,7 +536,9 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
             -klmSectorAngle/2.0, klmSectorAngle, fIronMaterial);
         logicIron->SetVisAttributes(visAttIron);
         new G4PVPlacement(0, G4ThreeVector(), logicIron, ironName + "_PV",
-                          logicKLMSectorMother, false, iStack, true); // Simpler copyNo for iron
+                          logicKLMSectorMother, false, iStack, fCheckOverlaps); // Simpler copyNo for iron
+        fRadialLayers.push_back({currentRadialPosition, currentRadialPosition + fIronThickness,
+                                 iStack, -1, false, fIronMaterial});
         currentRadialPosition += fIronThickness;
     }
     G4cout << "Stack " << iStack << " finished. Current Radial Position: "
@@ -324,6 +547,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 
   // --- Place the 8 KLM Sector Mother Volumes in the World ---
   G4double finalOuterRadius = currentRadialPosition; // Actual outer radius after construction
+  fKLMBarrelOuterRadius = finalOuterRadius;
   G4cout << "\n--- Placing " << fKLMBarrelNumSides << " KLM Sectors into World ---" << G4endl;
   G4cout << "Final outer radius of constructed layers: " << G4BestUnit(finalOuterRadius, "Length") << G4endl;
 
@@ -339,7 +563,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
     new G4PVPlacement(rotation, G4ThreeVector(), // Place at world origin, then rotate
                       logicKLMSectorMother,
                       "KLMSectorPV_" + std::to_string(iSector),
-                      logicWorld, false, iSector, true);
+                      logicWorld, false, iSector, fCheckOverlaps);
     G4cout << "Placed KLM Sector " << iSector << " at Phi = " << phi/deg << " deg" << G4endl;
   }
 
@@ -383,15 +607,20 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 
 void DetectorConstruction::ConstructSDandField()
 {
+  StartupProfiler::Scope profile("ConstructSDandField");
   G4cout << "\nDetectorConstruction::ConstructSDandField() called." << G4endl;
 
   // Assuming MylarSD constructor is: MylarSD(const G4String& name, const G4String& hitsCollectionName, DetectorConstruction* det)
   // If it changed to just MylarSD(const G4String& name) because EventAction handles hits,
   // then the MylarSD.hh/cc would need to reflect that (no hitsCollectionName, no detConstruction ptr).
   // Based on your MylarSD.cc it seems it still takes 3 args.
-  MylarSD* mylarSD = new MylarSD("KLM/MylarSD", "MylarHitsCollection", this);
-  G4SDManager::GetSDMpointer()->AddNewDetector(mylarSD);
-  G4cout << "MylarSD instance created and added to SDManager." << G4endl;
+  // One SD for the lifetime of the application: a rebuilt geometry only attaches it to the new volumes
+  if (!fMylarSD) {
+    fMylarSD = new MylarSD("KLM/MylarSD", "MylarHitsCollection", this);
+    G4SDManager::GetSDMpointer()->AddNewDetector(fMylarSD);
+    G4cout << "MylarSD instance created and added to SDManager." << G4endl;
+  }
+  MylarSD* mylarSD = fMylarSD;
 
   std::vector<std::string> mylarLogVolBaseNames = {
     "InnerGas_Log", "OuterGas_Log",
@@ -403,7 +632,12 @@ void DetectorConstruction::ConstructSDandField()
 
   G4LogicalVolumeStore* lvStore = G4LogicalVolumeStore::GetInstance();
   G4int sensitiveMylarVolumesCount = 0;
-  if (lvStore) { // Check if lvStore is not null
+  if (fParameterisedLayering) {
+      // One shared sublayer LV; MylarSD itself filters to the gas sublayers
+      G4cout << "Assigning MylarSD to: RPCSublayer_Log (parameterised layering)" << G4endl;
+      SetSensitiveDetector("RPCSublayer_Log", mylarSD);
+      sensitiveMylarVolumesCount++;
+  } else if (lvStore) { // Check if lvStore is not null
     for (auto const& lv : *lvStore) {
         if (!lv) continue; // Skip null logical volumes
         const G4String& lvName = lv->GetName();
@@ -431,4 +665,14 @@ void DetectorConstruction::ConstructSDandField()
   } else {
       G4cout << "Assigned MylarSD to " << sensitiveMylarVolumesCount << " Mylar logical volumes." << G4endl;
   }
+
+  // Fast simulation models on the sector mother envelope (inactive until enabled by macro)
+  G4Region* klmRegion = G4RegionStore::GetInstance()->GetRegion("KLMSectorRegion", false);
+  // The region outlives a geometry rebuild, and so do the models registered with it
+  if (klmRegion && !fFastMuonModel) {
+    fFastMuonModel = new FastMuonModel("KLMFastMuonModel", klmRegion, this, mylarSD);
+    fKLShowerModel = new KLShowerModel(klmRegion, this, mylarSD);
+  } else if (fKLShowerModel) {
+    fKLShowerModel->GeometryChanged();
+  }
 }
\ No newline at end of file
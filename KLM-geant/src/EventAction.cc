@@ -1,7 +1,17 @@
 #include "EventAction.hh"
 #include "RunAction.hh"
 #include "SteppingAction.hh" // If used
+#include "StackingAction.hh"
+#include "EventTelemetry.hh"
+#include "EventWatchdog.hh"
+#include "EventSeeder.hh"
+#include "RunCheckpoint.hh"
+#include "BackgroundOverlay.hh"
+#include "KLMClusterReco.hh"
+#include "PrimaryFilter.hh"
+#include "InputGeneratorAction.hh"
 #include "MylarHit.hh"       // For MylarHitsCollection and MylarHit
+#include "KLShowerModel.hh"
 
 #include "G4Event.hh"
 #include "G4RunManager.hh"
@@ -12,14 +22,18 @@
 #include "G4ios.hh"
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
+#include <algorithm>
+#include <cstdint>
 #include <iomanip>
 #include <fstream>      // For std::ofstream
+#include <sstream>
 
 // Constructor
 EventAction::EventAction(RunAction* runAction, SteppingAction* steppingAction)
  : G4UserEventAction(),
    fRunAction(runAction),
    fSteppingAction(steppingAction),
+   fStackingAction(nullptr),
    fMylarHitsCollectionID(-1)
 {
     G4cout << "EventAction created." << G4endl;
@@ -30,8 +44,63 @@ EventAction::~EventAction()
 
 // AddTrackData is REMOVED
 
+std::size_t EventAction::AccumulateHits(const MylarHitsCollection& hits,
+                                        std::map<CellIdentifier, G4double>& cellEnergyMap,
+                                        std::map<CellIdentifier, G4double>* cellTimeMap)
+{
+  std::size_t hitBytes = 0;
+  const G4int nHits = hits.entries();
+  for (G4int i = 0; i < nHits; i++) {
+    const MylarHit* hit = hits[i];
+
+    // Create cell identifier from the hit information
+    CellIdentifier cellID = std::make_tuple(
+        hit->GetSectorNumber(),
+        hit->GetStackNumber(),
+        hit->GetZCellID(),    // Should be 0-95
+        hit->GetPhiCellID()   // Should be 0-35
+    );
+    // Accumulate energy in the map
+    cellEnergyMap[cellID] += hit->GetEnergyDeposited();
+    if (cellTimeMap) {
+      auto inserted = cellTimeMap->emplace(cellID, hit->GetGlobalTime());
+      if (!inserted.second) inserted.first->second = std::min(inserted.first->second, hit->GetGlobalTime());
+    }
+
+    // Hit memory for the telemetry: the object plus string storage outside it
+    // (characters held inside the string object itself are already in sizeof)
+    hitBytes += sizeof(MylarHit);
+    for (const G4String* text : {&hit->GetParticleName(), &hit->GetVolumeName(), &hit->GetMylarLayerType()}) {
+      const std::uintptr_t object = reinterpret_cast<std::uintptr_t>(text);
+      const std::uintptr_t chars = reinterpret_cast<std::uintptr_t>(text->data());
+      if (chars < object || chars >= object + sizeof(*text)) hitBytes += text->capacity() + 1;
+    }
+  }
+  return hitBytes;
+}
+
+void EventAction::WriteCells(std::ostream& out, G4int outputEventID,
+                             const std::map<CellIdentifier, G4double>& cellEnergyMap)
+{
+  for (const auto& pair : cellEnergyMap) {
+    const CellIdentifier& cell = pair.first;
+    G4double totalEdep = pair.second;
+
+    out << outputEventID << " "
+        << std::get<0>(cell) << " " // Sector
+        << std::get<1>(cell) << " " // Stack
+        << std::get<2>(cell) << " " // ZCell (0-95)
+        << std::get<3>(cell) << " " // PhiCell (0-35)
+        << totalEdep / keV      // Write energy in MeV
+        << "\n";
+  }
+}
+
 void EventAction::BeginOfEventAction(const G4Event* event)
 {
+  if (fRunAction && fRunAction->GetEventTelemetry()) fRunAction->GetEventTelemetry()->BeginOfEvent();
+  if (fRunAction && fRunAction->GetEventWatchdog()) fRunAction->GetEventWatchdog()->BeginOfEvent();
+
   if (fSteppingAction) {
     fSteppingAction->Reset();
   }
@@ -39,6 +108,7 @@ void EventAction::BeginOfEventAction(const G4Event* event)
 
   // Clear the cell energy map for the new event
   fCellEnergyMap.clear();
+  fCellTimeMap.clear();
 
   // Get Hits Collection ID for Mylar hits (do this once)
   if (fMylarHitsCollectionID < 0) {
@@ -61,6 +131,22 @@ void EventAction::BeginOfEventAction(const G4Event* event)
 void EventAction::EndOfEventAction(const G4Event* event)
 {
   G4int eventID = event->GetEventID();
+  // The generator hit the end of the input and aborted the run: this event has no input event,
+  // so it gets no seed record, overlay, telemetry or checkpoint (serial and --fork runs agree)
+  const InputGeneratorAction* inputGenerator = dynamic_cast<const InputGeneratorAction*>(
+      G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+  if (inputGenerator && inputGenerator->IsEndOfInput()) {
+    G4cout << "---> End of input at event " << eventID << ", nothing recorded" << G4endl;
+    return;
+  }
+  G4int nHits = 0;
+  std::size_t hitBytes = 0;
+  KLMDigitizer* digitizer = fRunAction ? fRunAction->GetKLMDigitizer() : nullptr;
+  KLMClusterReco* clusterReco = fRunAction ? fRunAction->GetKLMClusterReco() : nullptr;
+  const G4bool reconstruct = clusterReco && clusterReco->IsEnabled();
+  const G4bool digitize = digitizer && digitizer->IsEnabled();
+  // Hit times per cell are needed by the digitizer and by the reconstruction
+  const G4bool needCellTimes = digitize || reconstruct;
 
   // --- Retrieve Mylar Hits and SUMMARIZE them into fCellEnergyMap ---
   if (fMylarHitsCollectionID >= 0) {
@@ -71,44 +157,86 @@ void EventAction::EndOfEventAction(const G4Event* event)
     }
 
     if (mylarHC) {
-      G4int n_hit_steps = mylarHC->entries(); // Number of individual steps recorded as hits
-      // G4cout << "Event " << eventID << ": Number of Mylar hit steps = " << n_hit_steps << G4endl;
-
-      for (G4int i = 0; i < n_hit_steps; i++) {
-        MylarHit* hit = (*mylarHC)[i];
-
-        // Create cell identifier from the hit information
-        CellIdentifier cellID = std::make_tuple(
-            hit->GetSectorNumber(),
-            hit->GetStackNumber(),
-            hit->GetZCellID(),    // Should be 0-95
-            hit->GetPhiCellID()   // Should be 0-35
-        );
-        // Accumulate energy in the map
-        fCellEnergyMap[cellID] += hit->GetEnergyDeposited();
-      }
+      hitBytes = AccumulateHits(*mylarHC, fCellEnergyMap, needCellTimes ? &fCellTimeMap : nullptr);
+      nHits = mylarHC->entries(); // Number of individual steps recorded as hits
+    }
+    // K_L shower library recording (no-op unless /klm/fastsim/kl/mode record)
+    if (KLShowerModel* klShowerModel = KLShowerModel::Find()) {
+      klShowerModel->EndOfEvent(eventID, mylarHC);
     }
   } else {
     G4cerr << "EventAction Warning (Event " << eventID << "): MylarHitsCollectionID not set or invalid!" << G4endl;
   }
 
+  // --- Background overlay: library frames mixed into the cells before any output ---
+  BackgroundOverlay* overlay = fRunAction ? fRunAction->GetBackgroundOverlay() : nullptr;
+  if (overlay && overlay->IsActive()) {
+    fOverlayCells.clear();
+    overlay->Sample(eventID + fRunAction->GetEventIDOffset(), fOverlayCells);
+    for (const KLMCellDeposit& background : fOverlayCells) {
+      CellIdentifier cellID = std::make_tuple(background.sector, background.stack, background.zCell, background.phiCell);
+      fCellEnergyMap[cellID] += background.edep;
+      if (needCellTimes) {
+        auto inserted = fCellTimeMap.emplace(cellID, background.time);
+        if (!inserted.second) inserted.first->second = std::min(inserted.first->second, background.time);
+      }
+    }
+  }
+
   // --- Write SUMMARIZED Mylar Cell Energies from fCellEnergyMap to file ---
   if (fRunAction && fRunAction->GetOutputFileStream().is_open()) {
     std::ofstream& outFile = fRunAction->GetOutputFileStream();
+    G4int outputEventID = eventID + fRunAction->GetEventIDOffset();
+
+    // Seed record: "klm_barrel --replay-event <input_event>" re-simulates this event alone
+    EventSeeder* seeder = EventSeeder::Instance();
+    if (seeder->IsPerEvent()) {
+      outFile << "# event " << outputEventID << " input_event " << seeder->GetInputEvent()
+              << " run_seed " << seeder->GetRunSeed() << " seed " << seeder->GetEventSeed() << "\n";
+    }
+
+    // Event emptied by the pre-filter: simulated without primaries, kept traceable here
+    PrimaryFilter* primaryFilter = PrimaryFilter::Instance();
+    if (primaryFilter->LastEventFiltered()) {
+      outFile << "# filtered event " << outputEventID << " input_event " << seeder->GetInputEvent()
+              << " primaries " << primaryFilter->GetLastEventPrimaries() << " kept 0\n";
+    }
+
+    // Over-budget event: flag it with its RNG state; an aborted event writes no cells
+    EventWatchdog* watchdog = fRunAction->GetEventWatchdog();
+    if (watchdog && watchdog->IsTriggered()) {
+      std::ostringstream rngFileName;
+      rngFileName << fRunAction->GetOutputFileName() << ".event" << outputEventID << ".rndm";
+      outFile << watchdog->Describe(outputEventID, rngFileName.str()) << "\n";
+      watchdog->Flag(outputEventID);
+      if (watchdog->IsAbortAction()) fCellEnergyMap.clear();
+    }
 
-    if (!fCellEnergyMap.empty()) {
+    if (!fCellEnergyMap.empty() && (!clusterReco || clusterReco->WriteCells())) {
       G4cout << "EventAction: Writing " << fCellEnergyMap.size() << " summarized cell energy entries for Event " << eventID << G4endl;
+      WriteCells(outFile, outputEventID, fCellEnergyMap);
+    }
+
+    // --- Strip digitization and reconstruction straight from the cell buffer ---
+    if (needCellTimes) {
+      fCellDeposits.clear();
+      fCellDeposits.reserve(fCellEnergyMap.size());
       for (const auto& pair : fCellEnergyMap) {
         const CellIdentifier& cell = pair.first;
-        G4double totalEdep = pair.second;
-
-        outFile << eventID << " "
-                << std::get<0>(cell) << " " // Sector
-                << std::get<1>(cell) << " " // Stack
-                << std::get<2>(cell) << " " // ZCell (0-95)
-                << std::get<3>(cell) << " " // PhiCell (0-35)
-                << totalEdep / keV      // Write energy in MeV
-                << "\n";
+        auto time = fCellTimeMap.find(cell);
+        fCellDeposits.push_back(KLMCellDeposit{std::get<0>(cell), std::get<1>(cell), std::get<2>(cell),
+                                               std::get<3>(cell), pair.second,
+                                               time != fCellTimeMap.end() ? time->second : 0.});
+      }
+      if (digitize) {
+        digitizer->Digitize(outputEventID, fCellDeposits, fDigits);
+        digitizer->Write(outputEventID, fDigits);
+      }
+      if (reconstruct) {
+        // From strips when digitizing (z x phi matching), else each cell is a 2D hit
+        if (digitize) clusterReco->ReconstructDigits(fDigits, fClusters);
+        else clusterReco->ReconstructCells(fCellDeposits, fClusters);
+        clusterReco->Write(outputEventID, fClusters);
       }
     }
   } else {
@@ -121,5 +249,18 @@ void EventAction::EndOfEventAction(const G4Event* event)
   // --- Remove Particle Table Summary (from TrackingAction) ---
   // G4cout << "\n--- Track Summary for Event ... (REMOVED)
 
+  if (fRunAction && fRunAction->GetEventTelemetry()) {
+    fRunAction->GetEventTelemetry()->EndOfEvent(eventID + fRunAction->GetEventIDOffset(),
+        fStackingAction ? fStackingAction->GetTracksThisEvent() : -1, nHits, hitBytes);
+  }
+
+  // Checkpoint after the event is complete in the output
+  if (fRunAction && fRunAction->GetRunCheckpoint()) {
+    const InputGeneratorAction* generator = dynamic_cast<const InputGeneratorAction*>(
+        G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+    fRunAction->GetRunCheckpoint()->EndOfEvent(fRunAction->GetOutputFileStream(),
+        generator ? generator->GetNextInputEvent() : eventID + 1);
+  }
+
   G4cout << "---> End of Event: " << eventID << G4endl;
 }
\ No newline at end of file
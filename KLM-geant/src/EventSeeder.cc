@@ -0,0 +1,56 @@
+#include "EventSeeder.hh"
+
+#include "G4GenericMessenger.hh"
+#include "Randomize.hh"
+
+#include <cstdint>
+
+EventSeeder* EventSeeder::fInstance = nullptr;
+
+EventSeeder* EventSeeder::Instance()
+{
+  if (!fInstance) fInstance = new EventSeeder();
+  return fInstance;
+}
+
+EventSeeder::EventSeeder()
+ : fMessenger(nullptr),
+   fRunSeed(0),
+   fPerEvent(true),
+   fEventSeed(0),
+   fInputEvent(-1)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/random/", "Per-event random seeding");
+  fMessenger->DeclareProperty("runSeed", fRunSeed,
+      "Run seed; each event is seeded from (run seed, input event index).");
+  fMessenger->DeclareProperty("perEvent", fPerEvent,
+      "Reseed the engine before every event (false: one engine stream for the whole run).");
+}
+
+EventSeeder::~EventSeeder()
+{
+  delete fMessenger;
+}
+
+// splitmix64 finaliser over (run seed, event): neighbouring events get unrelated seeds
+G4long EventSeeder::EventSeed(G4long runSeed, G4int inputEvent)
+{
+  std::uint64_t z = static_cast<std::uint64_t>(runSeed) * 0x9E3779B97F4A7C15ULL +
+                    static_cast<std::uint64_t>(static_cast<std::uint32_t>(inputEvent));
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  return static_cast<G4long>(z & 0x7FFFFFFFFFFFFFFFULL);
+}
+
+G4long EventSeeder::SeedEvent(G4int inputEvent)
+{
+  fInputEvent = inputEvent;
+  if (!fPerEvent) return 0;
+  fEventSeed = EventSeed(fRunSeed, inputEvent);
+  // Two non-zero 31-bit words and the terminating 0 expected by the CLHEP engines
+  long seeds[3] = { 1 + static_cast<long>((fEventSeed & 0xFFFFFFFF) % 0x7FFFFFFE),
+                    1 + static_cast<long>((fEventSeed >> 32) % 0x7FFFFFFE), 0 };
+  G4Random::setTheSeeds(seeds);
+  return fEventSeed;
+}
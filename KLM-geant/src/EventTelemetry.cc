@@ -0,0 +1,143 @@
+#include "EventTelemetry.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <unistd.h>
+
+EventTelemetry::EventTelemetry()
+ : fMessenger(nullptr),
+   fTelemetryFileName(""),
+   fStatusFileName(""),
+   fStatusInterval(10.),
+   fSlowestN(10),
+   fRunID(-1),
+   fEventsToProcess(0),
+   fEventsDone(0),
+   fLastEventSeconds(0.)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/telemetry/", "Per-event timing, memory and progress telemetry");
+  fMessenger->DeclareProperty("file", fTelemetryFileName,
+      "JSON-lines file with one record per event (empty: off).");
+  fMessenger->DeclareProperty("statusFile", fStatusFileName,
+      "Progress status file, rewritten periodically (empty: off).");
+  fMessenger->DeclareProperty("statusInterval", fStatusInterval,
+      "Seconds between status file updates.");
+  fMessenger->DeclareProperty("slowest", fSlowestN,
+      "Number of slowest events kept and reported at end of run.");
+}
+
+EventTelemetry::~EventTelemetry()
+{
+  delete fMessenger;
+}
+
+std::size_t EventTelemetry::GetResidentBytes()
+{
+  // Second field of /proc/self/statm: resident pages
+  std::FILE* statm = std::fopen("/proc/self/statm", "r");
+  if (!statm) return 0;
+  unsigned long sizePages = 0, residentPages = 0;
+  G4int fields = std::fscanf(statm, "%lu %lu", &sizePages, &residentPages);
+  std::fclose(statm);
+  return fields == 2 ? residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+void EventTelemetry::BeginOfRun(G4int runID, G4int eventsToProcess)
+{
+  fRunID = runID;
+  fEventsToProcess = eventsToProcess;
+  fEventsDone = 0;
+  fSlowest.clear();
+  fRunStart = fLastStatus = std::chrono::steady_clock::now();
+  if (fTelemetryFile.is_open()) fTelemetryFile.close();
+  if (!fTelemetryFileName.empty()) {
+    fTelemetryFile.open(fTelemetryFileName, std::ios::out | std::ios::trunc);
+    if (!fTelemetryFile) G4cerr << "EventTelemetry: cannot write " << fTelemetryFileName << G4endl;
+  }
+}
+
+void EventTelemetry::BeginOfEvent()
+{
+  fEventStart = std::chrono::steady_clock::now();
+}
+
+void EventTelemetry::EndOfEvent(G4int eventID, G4int nTracks, G4int nHits, std::size_t hitBytes)
+{
+  auto now = std::chrono::steady_clock::now();
+  fLastEventSeconds = std::chrono::duration<G4double>(now - fEventStart).count();
+  fEventsDone++;
+
+  // Keep the N slowest events (min-heap: the fastest of them on top)
+  if (fSlowestN > 0) {
+    auto later = std::greater<std::pair<G4double, G4int> >();
+    if (static_cast<G4int>(fSlowest.size()) < fSlowestN) {
+      fSlowest.push_back(std::make_pair(fLastEventSeconds, eventID));
+      std::push_heap(fSlowest.begin(), fSlowest.end(), later);
+    } else if (fLastEventSeconds > fSlowest.front().first) {
+      std::pop_heap(fSlowest.begin(), fSlowest.end(), later);
+      fSlowest.back() = std::make_pair(fLastEventSeconds, eventID);
+      std::push_heap(fSlowest.begin(), fSlowest.end(), later);
+    }
+  }
+
+  if (fTelemetryFile.is_open()) {
+    fTelemetryFile << "{\"run\": " << fRunID << ", \"event\": " << eventID
+                   << ", \"wall_s\": " << fLastEventSeconds << ", \"tracks\": " << nTracks
+                   << ", \"hits\": " << nHits << ", \"hit_bytes\": " << hitBytes
+                   << ", \"rss_bytes\": " << GetResidentBytes() << "}\n";
+  }
+  if (!fStatusFileName.empty() &&
+      std::chrono::duration<G4double>(now - fLastStatus).count() >= fStatusInterval) {
+    WriteStatus(false);
+    fLastStatus = now;
+  }
+}
+
+std::vector<std::pair<G4double, G4int> > EventTelemetry::SlowestEvents() const
+{
+  std::vector<std::pair<G4double, G4int> > sorted(fSlowest);
+  std::sort(sorted.begin(), sorted.end(), std::greater<std::pair<G4double, G4int> >());
+  return sorted;
+}
+
+void EventTelemetry::WriteStatus(G4bool final)
+{
+  G4double elapsed = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fRunStart).count();
+  G4double rate = elapsed > 0. ? fEventsDone / elapsed : 0.;
+  std::ostringstream status;
+  status << std::fixed << std::setprecision(2)
+         << "run " << fRunID << (final ? " finished" : " running")
+         << " events " << fEventsDone << "/" << fEventsToProcess
+         << " elapsed_s " << elapsed << " events_per_s " << rate;
+  if (!final && rate > 0. && fEventsToProcess > fEventsDone) {
+    status << " eta_s " << (fEventsToProcess - fEventsDone) / rate;
+  }
+  status << " rss_mb " << GetResidentBytes() / (1024. * 1024.) << " slowest";
+  for (const auto& event : SlowestEvents()) status << " " << event.second << ":" << event.first << "s";
+
+  // Rewritten atomically so a scraper never sees a partial line
+  const std::string tmpName = fStatusFileName + ".tmp";
+  {
+    std::ofstream out(tmpName, std::ios::out | std::ios::trunc);
+    out << status.str() << "\n";
+  }
+  std::rename(tmpName.c_str(), fStatusFileName.c_str());
+}
+
+void EventTelemetry::EndOfRun()
+{
+  if (fTelemetryFile.is_open()) fTelemetryFile.close();
+  if (!fStatusFileName.empty()) WriteStatus(true);
+  if (fSlowest.empty()) return;
+  G4cout << "\n--- Slowest " << fSlowest.size() << " events of run " << fRunID << " ---" << G4endl;
+  for (const auto& event : SlowestEvents()) {
+    G4cout << "     event " << std::setw(8) << event.second << " : " << event.first << " s" << G4endl;
+  }
+  G4cout << "------------------------------" << G4endl;
+}
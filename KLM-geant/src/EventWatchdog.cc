@@ -0,0 +1,134 @@
+#include "EventWatchdog.hh"
+
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4RunManager.hh"
+#include "G4GenericMessenger.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <fstream>
+#include <sstream>
+
+namespace {
+  // Wall-clock reads are amortised over this many steps
+  const G4long kWallTimeCheckEvery = 256;
+}
+
+EventWatchdog::EventWatchdog()
+ : fMessenger(nullptr),
+   fMaxSteps(0),
+   fMaxTracks(0),
+   fMaxWallTime(0.),
+   fAction("abort"),
+   fReason(kNone),
+   fAbortRequested(false),
+   fSteps(0),
+   fTracks(0)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/watchdog/", "Per-event step/track/time budget");
+  fMessenger->DeclareProperty("maxSteps", fMaxSteps, "Maximum steps per event (0: unlimited).");
+  fMessenger->DeclareProperty("maxTracks", fMaxTracks, "Maximum tracks per event (0: unlimited).");
+  fMessenger->DeclareProperty("maxWallTime", fMaxWallTime, "Maximum wall time per event in seconds (0: unlimited).");
+  fMessenger->DeclareProperty("action", fAction,
+      "abort: drop the event; truncate: kill all remaining tracks and keep the hits so far.")
+      .SetCandidates("abort truncate");
+}
+
+EventWatchdog::~EventWatchdog()
+{
+  delete fMessenger;
+}
+
+const char* EventWatchdog::GetReasonName(Reason reason)
+{
+  switch (reason) {
+    case kMaxSteps:    return "maxSteps";
+    case kMaxTracks:   return "maxTracks";
+    case kMaxWallTime: return "maxWallTime";
+    default:           return "none";
+  }
+}
+
+void EventWatchdog::BeginOfEvent()
+{
+  fReason = kNone;
+  fAbortRequested = false;
+  fSteps = 0;
+  fTracks = 0;
+  if (!IsActive()) return;
+  fEventStart = std::chrono::steady_clock::now();
+  std::ostringstream state;
+  G4Random::saveFullState(state);
+  fRandomState = state.str();
+}
+
+void EventWatchdog::Trigger(Reason reason)
+{
+  if (fReason != kNone) return;
+  fReason = reason;
+  G4cerr << "EventWatchdog: event over budget (" << GetReasonName(reason) << " after " << fSteps
+         << " steps, " << fTracks << " tracks), " << fAction << G4endl;
+}
+
+G4bool EventWatchdog::CheckNewTrack()
+{
+  if (!IsActive()) return false;
+  if (++fTracks > fMaxTracks && fMaxTracks > 0) Trigger(kMaxTracks);
+  // The abort itself is requested from the next step, not from inside the stack manager
+  return fReason != kNone;
+}
+
+G4bool EventWatchdog::CheckStep(const G4Step* step)
+{
+  if (!IsActive()) return false;
+  ++fSteps;
+  if (fReason == kNone) {
+    if (fMaxSteps > 0 && fSteps > fMaxSteps) {
+      Trigger(kMaxSteps);
+    } else if (fMaxWallTime > 0. && fSteps % kWallTimeCheckEvery == 0 &&
+               std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fEventStart).count() > fMaxWallTime) {
+      Trigger(kMaxWallTime);
+    }
+  }
+  if (fReason == kNone) return false;
+
+  if (IsAbortAction()) {
+    if (!fAbortRequested) {
+      fAbortRequested = true;
+      G4RunManager::GetRunManager()->AbortEvent();
+    }
+  } else {
+    // Truncate: every track still stepping is stopped at its next step
+    step->GetTrack()->SetTrackStatus(fStopAndKill);
+  }
+  return true;
+}
+
+std::string EventWatchdog::Describe(G4int eventID, const std::string& rngFileName) const
+{
+  std::ofstream rng(rngFileName);
+  rng << fRandomState;
+  std::ostringstream line;
+  line << "# watchdog event " << eventID << " reason=" << GetReasonName(fReason)
+       << " action=" << fAction << " steps=" << fSteps << " tracks=" << fTracks
+       << " wall_s=" << std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fEventStart).count()
+       << " rng_state=" << rngFileName;
+  return line.str();
+}
+
+void EventWatchdog::Flag(G4int eventID)
+{
+  fFlaggedEvents.push_back(std::make_pair(eventID, fReason));
+}
+
+void EventWatchdog::PrintStatistics() const
+{
+  if (fFlaggedEvents.empty()) return;
+  G4cout << "\n--- EventWatchdog: " << fFlaggedEvents.size() << " events over budget ("
+         << fAction << ") ---" << G4endl;
+  for (const auto& event : fFlaggedEvents) {
+    G4cout << "     event " << event.first << " : " << GetReasonName(event.second) << G4endl;
+  }
+  G4cout << "------------------------------" << G4endl;
+}
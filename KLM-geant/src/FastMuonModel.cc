@@ -0,0 +1,215 @@
+#include "FastMuonModel.hh"
+#include "DetectorConstruction.hh"
+#include "MylarSD.hh"
+
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4Track.hh"
+#include "G4VSolid.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4AffineTransform.hh"
+#include "G4Material.hh"
+#include "G4MuonMinus.hh"
+#include "G4MuonPlus.hh"
+#include "G4EmCalculator.hh"
+#include "G4EventManager.hh"
+#include "G4Event.hh"
+#include "G4GenericMessenger.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  // Log-spaced kinetic energy grid of the dE/dx tables
+  const G4double kTableEmin = 10. * MeV;
+  const G4double kTableEmax = 1. * TeV;
+  const G4int kTableBins = 120;
+}
+
+FastMuonModel::FastMuonModel(const G4String& name, G4Region* envelope,
+                             const DetectorConstruction* detector, MylarSD* mylarSD)
+ : G4VFastSimulationModel(name, envelope),
+   fDetector(detector),
+   fMylarSD(mylarSD),
+   fMessenger(nullptr),
+   fEnabled(false),
+   fEnergyThreshold(1. * GeV),
+   fHandBackEnergy(0.3 * GeV),
+   fMinCosNormal(0.2),
+   fScatterStepX0(0.5),
+   fHandedBackEventID(-1),
+   fHandedBackTrackID(-1)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/fastsim/muon/", "Fast muon propagation in the KLM sectors");
+  fMessenger->DeclareProperty("enable", fEnabled,
+      "Propagate muons analytically through the sector layers (checked per track, switch between runs).");
+  fMessenger->DeclarePropertyWithUnit("threshold", "GeV", fEnergyThreshold,
+      "Minimum kinetic energy for the fast model.");
+  fMessenger->DeclarePropertyWithUnit("handBackEnergy", "GeV", fHandBackEnergy,
+      "Return the muon to full simulation below this kinetic energy.");
+  fMessenger->DeclareProperty("minCosNormal", fMinCosNormal,
+      "Minimum direction cosine to the sector normal (outward) for the fast model.");
+  fMessenger->DeclareProperty("scatterStep", fScatterStepX0,
+      "Material thickness (in X0) accumulated between multiple-scattering kicks.");
+}
+
+FastMuonModel::~FastMuonModel()
+{
+  delete fMessenger;
+}
+
+G4bool FastMuonModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return &particle == G4MuonMinus::Definition() || &particle == G4MuonPlus::Definition();
+}
+
+G4bool FastMuonModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+  if (!fEnabled) return false;
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  if (track->GetKineticEnergy() < fEnergyThreshold) return false;
+  if (fastTrack.GetPrimaryTrackLocalDirection().x() < fMinCosNormal) return false;
+  const G4Event* event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
+  if (event && event->GetEventID() == fHandedBackEventID && track->GetTrackID() == fHandedBackTrackID) {
+    return false;
+  }
+  return true;
+}
+
+G4double FastMuonModel::MeanDEDX(G4double kinE, const G4ParticleDefinition* particle,
+                                 const G4Material* material)
+{
+  std::vector<G4double>& table = fDEDXTables[std::make_pair(particle, material)];
+  const G4double logStep = std::log(kTableEmax / kTableEmin) / kTableBins;
+  if (table.empty()) {
+    G4EmCalculator calculator;
+    table.resize(kTableBins + 1);
+    for (G4int i = 0; i <= kTableBins; ++i) {
+      table[i] = calculator.ComputeTotalDEDX(kTableEmin * std::exp(i * logStep), particle, material);
+    }
+  }
+  G4double x = std::log(std::max(kinE, kTableEmin) / kTableEmin) / logStep;
+  G4int i = std::min(static_cast<G4int>(x), kTableBins - 1);
+  G4double f = std::min(x - i, 1.);
+  return table[i] + f * (table[i + 1] - table[i]);
+}
+
+G4ThreeVector FastMuonModel::Scatter(const G4ThreeVector& dir, G4double momentum, G4double beta,
+                                     G4double charge, G4double thicknessX0) const
+{
+  if (thicknessX0 <= 0.) return dir;
+  // Highland formula (PDG), applied to the accumulated thickness
+  G4double theta0 = 13.6 * MeV / (beta * momentum) * std::abs(charge) * std::sqrt(thicknessX0)
+                  * (1. + 0.038 * std::log(thicknessX0 * charge * charge / (beta * beta)));
+  G4ThreeVector u = dir.orthogonal().unit();
+  G4ThreeVector v = dir.cross(u);
+  G4double thetaU = G4RandGauss::shoot(0., theta0);
+  G4double thetaV = G4RandGauss::shoot(0., theta0);
+  return (dir + std::tan(thetaU) * u + std::tan(thetaV) * v).unit();
+}
+
+void FastMuonModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  const G4ParticleDefinition* particle = track->GetParticleDefinition();
+  const G4double mass = particle->GetPDGMass();
+  const G4double charge = particle->GetPDGCharge() / eplus;
+  const G4VSolid* envelope = fastTrack.GetEnvelopeSolid();
+  const G4AffineTransform* toGlobal = fastTrack.GetInverseAffineTransformation();
+  const G4int sector = fastTrack.GetEnvelopePhysicalVolume()->GetCopyNo();
+
+  // Sector-local frame: x is the distance along the sector normal ("radius" of the layers)
+  G4ThreeVector pos = fastTrack.GetPrimaryTrackLocalPosition();
+  G4ThreeVector dir = fastTrack.GetPrimaryTrackLocalDirection();
+  G4double kinE = track->GetKineticEnergy();
+  G4double time = track->GetGlobalTime();
+  G4double properTime = track->GetProperTime();
+  G4double pathLength = 0.;
+  G4double totalEdep = 0.;
+  G4double pendingX0 = 0.;
+  G4bool handBack = false;
+  G4bool leftEnvelope = false;
+
+  // Straight move with constant velocity over the segment
+  auto advance = [&](G4double s) {
+    G4double gamma = (kinE + mass) / mass;
+    G4double beta = std::sqrt(1. - 1. / (gamma * gamma));
+    time += s / (beta * c_light);
+    properTime += s / (gamma * beta * c_light);
+    pos += s * dir;
+    pathLength += s;
+  };
+
+  for (const KLMRadialLayer& layer : fDetector->GetRadialLayers()) {
+    if (layer.rMax <= pos.x()) continue;
+    if (kinE < fHandBackEnergy || dir.x() < fMinCosNormal) {
+      handBack = true;
+      break;
+    }
+
+    // Gap in front of the layer (envelope material, no loss)
+    G4double sOut = envelope->DistanceToOut(pos, dir);
+    if (pos.x() < layer.rMin) {
+      G4double sGap = (layer.rMin - pos.x()) / dir.x();
+      if (sOut <= sGap) {
+        advance(sOut);
+        leftEnvelope = true;
+        break;
+      }
+      advance(sGap);
+      sOut -= sGap;
+    }
+
+    // Through the layer, or up to the sector side/end face
+    G4double s = (layer.rMax - pos.x()) / dir.x();
+    if (sOut < s) {
+      s = sOut;
+      leftEnvelope = true;
+    }
+    G4double dE = std::min(kinE, MeanDEDX(kinE, particle, layer.material) * s);
+    G4ThreeVector midpoint = pos + 0.5 * s * dir;
+    G4double entryTime = time;
+    advance(s);
+    kinE -= dE;
+    totalEdep += dE;
+
+    if (layer.isGasGap && fMylarSD) {
+      fMylarSD->AddHit(sector, layer.stack, layer.subLayerID, midpoint,
+                       toGlobal->TransformPoint(midpoint), dE, 0.5 * (entryTime + time), track);
+    }
+
+    pendingX0 += s / layer.material->GetRadlen();
+    if (pendingX0 >= fScatterStepX0 || leftEnvelope) {
+      G4double momentum = std::sqrt(kinE * (kinE + 2. * mass));
+      G4double beta = momentum / (kinE + mass);
+      if (momentum > 0.) dir = Scatter(dir, momentum, beta, charge, pendingX0);
+      pendingX0 = 0.;
+    }
+    if (leftEnvelope || kinE <= 0.) break;
+  }
+
+  // Beyond the last layer: straight to the envelope surface
+  if (!handBack && !leftEnvelope && kinE > 0.) {
+    advance(envelope->DistanceToOut(pos, dir));
+  }
+  if (handBack) {
+    const G4Event* event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
+    fHandedBackEventID = event ? event->GetEventID() : -1;
+    fHandedBackTrackID = track->GetTrackID();
+  }
+
+  fastStep.ProposePrimaryTrackFinalPosition(pos);
+  fastStep.ProposePrimaryTrackFinalTime(time);
+  fastStep.ProposePrimaryTrackFinalProperTime(properTime);
+  fastStep.ProposePrimaryTrackPathLength(pathLength);
+  fastStep.ProposeTotalEnergyDeposited(totalEdep);
+  if (kinE <= 0.) {
+    fastStep.KillPrimaryTrack();
+  } else {
+    fastStep.ProposePrimaryTrackFinalKineticEnergy(kinE);
+    fastStep.ProposePrimaryTrackFinalMomentumDirection(dir);
+  }
+}
@@ -0,0 +1,38 @@
+#include "ForkWorker.hh"
+
+#include "G4ios.hh"
+
+#include <cstdio>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void ForkWorker::FlushAll()
+{
+  G4cout << std::flush;
+  std::cout.flush();
+  std::fflush(nullptr);
+}
+
+pid_t ForkWorker::Start(const std::function<G4bool()>& body, const std::string& logFileName)
+{
+  FlushAll();
+  pid_t pid = fork();
+  if (pid != 0) return pid;
+
+  if (!logFileName.empty()) {
+    if (!std::freopen(logFileName.c_str(), "w", stdout)) _exit(1);
+    dup2(fileno(stdout), fileno(stderr));
+  }
+  const G4bool ok = body();
+  FlushAll();
+  _exit(ok ? 0 : 1);
+}
+
+G4bool ForkWorker::Wait(pid_t pid, rusage* usage)
+{
+  int status = 0;
+  rusage ignored;
+  if (wait4(pid, &status, 0, usage ? usage : &ignored) < 0) return false;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
@@ -1,4 +1,5 @@
 #include "G4HepMCInterface.hh"
+#include "PrimaryFilter.hh"
 
 #include "G4Event.hh"
 #include "G4PrimaryParticle.hh"
@@ -22,10 +23,11 @@
 // Constructor: Initialize the reader
 G4HepMCInterface::G4HepMCInterface(const G4String& hepmcFileName)
 {
-    m_asciiInput = new HepMC::IO_GenEvent(hepmcFileName.c_str(), std::ios::in);
+    m_inputFile.open(hepmcFileName.c_str(), std::ios::in);
+    m_asciiInput = new HepMC::IO_GenEvent(m_inputFile);
 
     // Check if the file stream is good *immediately* after opening
-    if (m_asciiInput->rdstate() != std::ios::goodbit) {
+    if (!m_inputFile.is_open() || m_asciiInput->rdstate() != std::ios::goodbit) {
          G4Exception("G4HepMCInterface::G4HepMCInterface",
                     "CannotOpenFile", FatalException,
                     ("Could not open HepMC file: " + hepmcFileName + " or stream is bad.").c_str());
@@ -42,8 +44,8 @@ G4HepMCInterface::~G4HepMCInterface()
     G4cout << "G4HepMCInterface: Reader deleted." << G4endl;
 }
 
-// GeneratePrimaries: Called by Geant4 for each event
-void G4HepMCInterface::GeneratePrimaries(G4Event* anEvent)
+// GenerateInputEvent: Called (via InputGeneratorAction::GeneratePrimaries) for each event
+void G4HepMCInterface::GenerateInputEvent(G4Event* anEvent)
 {
     if (!m_asciiInput) {
          G4Exception("G4HepMCInterface::GeneratePrimaries",
@@ -54,6 +56,7 @@ void G4HepMCInterface::GeneratePrimaries(G4Event* anEvent)
 
     // Use read_next_event() which allocates a new GenEvent object
     HepMC::GenEvent* hepmcEvt = m_asciiInput->read_next_event();
+    m_listingStarted = true;
 
     // Check if event reading failed (returns NULL on error or EOF)
     if (!hepmcEvt) {
@@ -71,7 +74,7 @@ void G4HepMCInterface::GeneratePrimaries(G4Event* anEvent)
              G4cout << "     Stream State Bits: eof=" << is_eof << " fail=" << is_fail << " bad=" << is_bad << G4endl;
         }
         // Signal G4RunManager to stop the run smoothly in either case (EOF or error)
-        G4RunManager::GetRunManager()->AbortRun(true); // Soft abort
+        EndOfInput(); // Soft abort
         return; // Do not proceed to conversion
     }
 
@@ -96,6 +99,40 @@ void G4HepMCInterface::GeneratePrimaries(G4Event* anEvent)
     hepmcEvt = nullptr; // Good practice to nullify pointer after delete
 }
 
+// Skip events without converting them (used to start at an event offset)
+G4int G4HepMCInterface::SkipInputEvents(G4int nEvents)
+{
+    G4int skipped = 0;
+    while (m_asciiInput && skipped < nEvents) {
+        HepMC::GenEvent* hepmcEvt = m_asciiInput->read_next_event();
+        m_listingStarted = true;
+        if (!hepmcEvt) break;
+        delete hepmcEvt;
+        skipped++;
+    }
+    return skipped;
+}
+
+// The reader stops in front of the next event line, so the stream position is the event's offset
+G4long G4HepMCInterface::GetInputOffset()
+{
+    if (!m_inputFile) return -1;
+    return static_cast<G4long>(m_inputFile.tellg());
+}
+
+G4bool G4HepMCInterface::SeekInput(G4long offset)
+{
+    if (!m_asciiInput) return false;
+    // HepMC finds the listing header before the first event only: read (and drop) one event first
+    if (!m_listingStarted) {
+        delete m_asciiInput->read_next_event();
+        m_listingStarted = true;
+    }
+    m_inputFile.clear();
+    m_inputFile.seekg(offset);
+    return bool(m_inputFile);
+}
+
 // --- Conversion Method --- (Modified to accept event pointer)
 // Converts the HepMC event (hepmcEvt) into Geant4 primaries
 // Focuses on *final state* particles (status == 1).
@@ -130,6 +167,15 @@ G4bool G4HepMCInterface::ConvertHepMCEvent(const HepMC::GenEvent* hepmcEvt, G4Ev
                 continue;
             }
 
+            // Pre-filter (/klm/filter/): vertices are only created for kept primaries
+            HepMC::FourVector prodPos = prodVertexHepMC->position();
+            HepMC::FourVector prodMom = hepmcParticle->momentum();
+            if (!AcceptPrimary(hepmcParticle->pdg_id(),
+                               G4ThreeVector(prodMom.px(), prodMom.py(), prodMom.pz()) * momentumUnit,
+                               G4ThreeVector(prodPos.x(), prodPos.y(), prodPos.z()) * lengthUnit)) {
+                continue;
+            }
+
             int vertexBarcode = prodVertexHepMC->barcode();
             G4PrimaryVertex* g4Vertex = nullptr;
 
@@ -162,7 +208,7 @@ G4bool G4HepMCInterface::ConvertHepMCEvent(const HepMC::GenEvent* hepmcEvt, G4Ev
         }
     } // End loop over particles
 
-    if (geant4Vertices.empty() && hepmcEvt->particles_size() > 0) {
+    if (geant4Vertices.empty() && hepmcEvt->particles_size() > 0 && !PrimaryFilter::Instance()->IsEnabled()) {
          G4cout<< "G4HepMCInterface: No final state particles (status=1) found in HepMC event "
                         << hepmcEvt->event_number() << "." << G4endl;
     }
@@ -0,0 +1,117 @@
+#include "GeometryCheck.hh"
+#include "DetectorConstruction.hh"
+
+#include "G4PhysicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4ios.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+GeometryCheck::GeometryCheck(const DetectorConstruction* detector,
+                             G4int resolution, G4double tolerance)
+ : fDetector(detector),
+   fResolution(resolution),
+   fTolerance(tolerance)
+{}
+
+GeometryCheck::~GeometryCheck()
+{}
+
+std::string GeometryCheck::CacheKey() const
+{
+  std::ostringstream os;
+  os << fDetector->GetGeometryHash() << " res=" << fResolution << " tol=" << fTolerance;
+  return os.str();
+}
+
+std::string GeometryCheck::CacheFileName() const
+{
+  const char* dir = std::getenv("KLM_CACHE_DIR");
+  return std::string(dir ? dir : ".") + "/klm_geometry_check.cache";
+}
+
+G4bool GeometryCheck::IsCachedPass() const
+{
+  std::ifstream in(CacheFileName());
+  std::string line;
+  const std::string expected = CacheKey() + " PASS";
+  while (std::getline(in, line)) {
+    if (line == expected) return true;
+  }
+  return false;
+}
+
+void GeometryCheck::StorePass() const
+{
+  std::ofstream out(CacheFileName(), std::ios::out | std::ios::app);
+  if (!out) {
+    G4cerr << "GeometryCheck: cannot write cache file " << CacheFileName() << G4endl;
+    return;
+  }
+  out << CacheKey() << " PASS\n";
+}
+
+G4bool GeometryCheck::Run(G4int nWorkers)
+{
+  G4cout << "\n--- GeometryCheck: geometry hash " << fDetector->GetGeometryHash() << " ---" << G4endl;
+  if (IsCachedPass()) {
+    G4cout << "GeometryCheck: cached PASS found in " << CacheFileName() << ", skipping checks." << G4endl;
+    return true;
+  }
+
+  // Every placement below the world; parameterised volumes check all of their copies
+  std::vector<G4VPhysicalVolume*> volumes;
+  for (G4VPhysicalVolume* pv : *G4PhysicalVolumeStore::GetInstance()) {
+    if (pv && pv->GetMotherLogical()) volumes.push_back(pv);
+  }
+  if (nWorkers < 1) nWorkers = 1;
+  G4cout << "GeometryCheck: checking " << volumes.size() << " volumes with "
+         << nWorkers << " worker processes (" << fResolution << " points each)." << G4endl;
+
+  // Volumes i == iWorker (mod nWorkers); returns the number of overlapping volumes
+  auto checkShare = [&](G4int iWorker) {
+    G4int overlaps = 0;
+    for (std::size_t i = iWorker; i < volumes.size(); i += nWorkers) {
+      if (volumes[i]->CheckOverlaps(fResolution, fTolerance, false, 1)) overlaps++;
+    }
+    return overlaps;
+  };
+
+  // Workers share the initialised geometry copy-on-write; the exit status carries the verdict
+  G4bool pass = true;
+  std::vector<pid_t> workers;
+  for (G4int iWorker = 0; iWorker < nWorkers; ++iWorker) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      G4int overlaps = checkShare(iWorker);
+      G4cout << std::flush;
+      _exit(overlaps > 0 ? 1 : 0);
+    }
+    if (pid < 0) {
+      G4cerr << "GeometryCheck: fork failed, checking the remaining shares in this process." << G4endl;
+      for (G4int jWorker = iWorker; jWorker < nWorkers; ++jWorker) {
+        if (checkShare(jWorker) > 0) pass = false;
+      }
+      break;
+    }
+    workers.push_back(pid);
+  }
+
+  for (pid_t pid : workers) {
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) pass = false;
+  }
+
+  if (pass) {
+    G4cout << "GeometryCheck: PASS, no overlaps found." << G4endl;
+    StorePass();
+  } else {
+    G4cerr << "GeometryCheck: FAIL, overlaps found (see G4Exception warnings above)." << G4endl;
+  }
+  return pass;
+}
@@ -0,0 +1,249 @@
+#include "GeometrySweep.hh"
+#include "ActionInitialization.hh"
+#include "InputGeneratorAction.hh"
+#include "RunAction.hh"
+#include "SimulationServer.hh"
+#include "EventSeeder.hh"
+#include "KLShowerModel.hh"
+#include "DetectorConstruction.hh"
+#include "ForkWorker.hh"
+
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "G4UIcommandStatus.hh"
+#include "G4UnitsTable.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <atomic>
+#include <new>
+#include <sys/mman.h>
+
+GeometrySweep::GeometrySweep(G4RunManager* runManager, const G4String& inputFileName)
+ : fRunManager(runManager),
+   fInputFileName(inputFileName)
+{
+  // Point outputs are named after the output a single run would write
+  const RunAction* runAction = dynamic_cast<const RunAction*>(fRunManager->GetUserRunAction());
+  fOutputFileName = runAction ? runAction->GetOutputFileName() : G4String("summarized_cell_energy.txt");
+}
+
+GeometrySweep::~GeometrySweep()
+{}
+
+std::string GeometrySweep::PointName(G4int iPoint) const
+{
+  return fOutputFileName + ".point" + std::to_string(iPoint);
+}
+
+G4bool GeometrySweep::LoadGrid(const G4String& gridFileName)
+{
+  std::ifstream grid(gridFileName);
+  if (!grid) {
+    G4cerr << "GeometrySweep: cannot open grid file " << gridFileName << G4endl;
+    return false;
+  }
+  fAxes.clear();
+  std::string line;
+  G4int lineNumber = 0;
+  while (std::getline(grid, line)) {
+    ++lineNumber;
+    line = line.substr(0, line.find('#'));
+    std::istringstream tokens(line);
+    std::vector<G4String> words;
+    std::string word;
+    while (tokens >> word) words.push_back(word);
+    if (words.empty()) continue;
+
+    Axis axis;
+    axis.command = words[0][0] == '/' ? words[0] : G4String("/klm/geometry/" + words[0]);
+    // Values are numbers with an optional unit word for all of them, or words (e.g. "true false")
+    auto isNumber = [](const G4String& text) {
+      char* end = nullptr;
+      std::strtod(text.c_str(), &end);
+      return end != text.c_str() && *end == '\0';
+    };
+    G4String unit = "";
+    if (words.size() > 2 && !isNumber(words.back()) && G4UnitDefinition::IsUnitDefined(words.back())) {
+      unit = words.back();
+      words.pop_back();
+    }
+    const std::size_t nNumbers = std::count_if(words.begin() + 1, words.end(), isNumber);
+    if ((nNumbers > 0 || !unit.empty()) && nNumbers != words.size() - 1) {
+      G4cerr << "GeometrySweep: " << gridFileName << ":" << lineNumber << ": " << axis.command
+             << " mixes numbers and words (a unit must be a known unit and follow numbers only)" << G4endl;
+      return false;
+    }
+    for (std::size_t i = 1; i < words.size(); ++i) {
+      axis.values.push_back(unit.empty() ? words[i] : words[i] + " " + unit);
+    }
+    if (axis.values.empty()) {
+      G4cerr << "GeometrySweep: " << gridFileName << ":" << lineNumber << ": no values for " << axis.command << G4endl;
+      return false;
+    }
+    if (!G4UImanager::GetUIpointer()->FindCommand(axis.command)) {
+      G4cerr << "GeometrySweep: " << gridFileName << ":" << lineNumber << ": unknown command " << axis.command << G4endl;
+      return false;
+    }
+    fAxes.push_back(axis);
+  }
+  if (fAxes.empty()) {
+    G4cerr << "GeometrySweep: no axes in " << gridFileName << G4endl;
+    return false;
+  }
+  return true;
+}
+
+G4int GeometrySweep::NumberOfPoints() const
+{
+  G4int nPoints = 1;
+  for (const Axis& axis : fAxes) nPoints *= static_cast<G4int>(axis.values.size());
+  return nPoints;
+}
+
+std::vector<G4String> GeometrySweep::PointCommands(G4int iPoint, G4String& tag) const
+{
+  std::vector<G4String> commands(fAxes.size());
+  std::vector<G4String> tags(fAxes.size());
+  // Last axis fastest
+  for (std::size_t i = fAxes.size(); i-- > 0;) {
+    const Axis& axis = fAxes[i];
+    const G4String& value = axis.values[iPoint % axis.values.size()];
+    iPoint /= static_cast<G4int>(axis.values.size());
+    commands[i] = axis.command + " " + value;
+    G4String name = axis.command.substr(axis.command.rfind('/') + 1);
+    G4String compact = value;
+    compact.erase(std::remove(compact.begin(), compact.end(), ' '), compact.end());
+    tags[i] = name + "=" + compact;
+  }
+  tag = "";
+  for (const G4String& text : tags) tag += (tag.empty() ? "" : " ") + text;
+  return commands;
+}
+
+// In a worker: set the point's parameters, rebuild the geometry, run the events
+G4bool GeometrySweep::RunPoint(G4int iPoint, G4int eventsPerPoint, G4long runSeed) const
+{
+  G4UImanager* ui = G4UImanager::GetUIpointer();
+  G4String tag;
+  for (const G4String& command : PointCommands(iPoint, tag)) {
+    if (ui->ApplyCommand(command) != fCommandSucceeded) {
+      G4cerr << "GeometrySweep: point " << iPoint << ": '" << command << "' failed" << G4endl;
+      return false;
+    }
+  }
+  G4cout << "GeometrySweep: point " << iPoint << ": " << tag << G4endl;
+  if (ui->ApplyCommand("/klm/geometry/update") != fCommandSucceeded) return false;
+  // Invalid parameters leave the old layout in place; the next point sets every axis again
+  const DetectorConstruction* detector = dynamic_cast<const DetectorConstruction*>(
+      fRunManager->GetUserDetectorConstruction());
+  if (detector && detector->HasPendingChanges()) {
+    G4cerr << "GeometrySweep: point " << iPoint << ": invalid geometry, skipped" << G4endl;
+    return false;
+  }
+
+  std::ostringstream job;
+  job << "input=" << fInputFileName << " output=" << PointName(iPoint)
+      << " id=point" << iPoint << " seed=" << runSeed;
+  if (eventsPerPoint >= 0) job << " count=" << eventsPerPoint;
+  SimulationServer server(fRunManager);
+  return server.RunJob(job.str()).compare(0, 2, "OK") == 0;
+}
+
+G4int GeometrySweep::Run(G4int nWorkers, G4int eventsPerPoint)
+{
+  auto wallStart = std::chrono::steady_clock::now();
+  const G4int nPoints = NumberOfPoints();
+  // A library holds one layout only; recording over a sweep would mix the points' showers
+  KLShowerModel* klShowerModel = KLShowerModel::Find();
+  if (klShowerModel && klShowerModel->IsRecording()) {
+    G4cerr << "GeometrySweep: /klm/fastsim/kl/mode record is not supported in sweeps." << G4endl;
+    return 1;
+  }
+  if (eventsPerPoint < 0) {
+    InputGeneratorAction* generator = ActionInitialization::CreateGenerator(fInputFileName);
+    const G4bool unbounded = generator->SkipEvents(std::numeric_limits<G4int>::max()) == std::numeric_limits<G4int>::max();
+    delete generator;
+    if (unbounded) {
+      G4cerr << "GeometrySweep: " << fInputFileName << " has no end; give --events or /klm/gun/events." << G4endl;
+      return 1;
+    }
+  }
+  nWorkers = std::max(1, std::min(nWorkers, nPoints));
+  G4cout << "GeometrySweep: " << nPoints << " points of "
+         << (eventsPerPoint >= 0 ? std::to_string(eventsPerPoint) : std::string("all")) << " events from "
+         << fInputFileName << " on " << nWorkers << " worker processes." << G4endl;
+
+  // Build the physics tables once, before forking; the geometry rebuilds keep them
+  RunAction* runAction = const_cast<RunAction*>(dynamic_cast<const RunAction*>(fRunManager->GetUserRunAction()));
+  const std::string initOutput = fOutputFileName + ".sweep.init";
+  if (runAction) runAction->SetOutputFileName(initOutput);
+  fRunManager->BeamOn(0);
+  std::remove(initOutput.c_str());
+  if (runAction) runAction->SetOutputFileName(fOutputFileName);
+  // One run seed for every point: the points differ by their parameters only
+  const G4long runSeed = EventSeeder::Instance()->GetRunSeed();
+
+  // --- Fork workers; each takes the next free point from a shared counter, so a slow point
+  // (thick iron, fine granularity) does not hold back the points queued behind it ---
+  void* shared = mmap(nullptr, sizeof(std::atomic<G4int>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shared == MAP_FAILED) {
+    G4cerr << "GeometrySweep: cannot map the shared point counter" << G4endl;
+    return 1;
+  }
+  std::atomic<G4int>* nextPoint = new (shared) std::atomic<G4int>(0);
+  std::vector<pid_t> pids;
+  for (G4int iWorker = 0; iWorker < nWorkers; ++iWorker) {
+    const std::string log = fOutputFileName + ".sweep.worker" + std::to_string(iWorker) + ".log";
+    pid_t pid = ForkWorker::Start([&]() {
+      G4bool ok = true;
+      for (G4int iPoint = nextPoint->fetch_add(1); iPoint < nPoints; iPoint = nextPoint->fetch_add(1)) {
+        ok = RunPoint(iPoint, eventsPerPoint, runSeed) && ok; // a failed point does not stop the others
+      }
+      return ok;
+    }, log);
+    if (pid < 0) {
+      G4cerr << "GeometrySweep: fork failed for worker " << iWorker << G4endl;
+      break;
+    }
+    pids.push_back(pid);
+  }
+
+  // --- Collect workers ---
+  G4bool allOk = (G4int)pids.size() == nWorkers;
+  for (std::size_t i = 0; i < pids.size(); ++i) {
+    if (!ForkWorker::Wait(pids[i])) {
+      G4cerr << "GeometrySweep: worker " << i << " had failures, see "
+             << fOutputFileName << ".sweep.worker" << i << ".log" << G4endl;
+      allOk = false;
+    }
+  }
+
+  munmap(shared, sizeof(std::atomic<G4int>));
+
+  // --- Index: one line per point with its parameters and timing line ---
+  const std::string indexName = fOutputFileName + ".sweep";
+  std::ofstream index(indexName);
+  index << "# Point Output Parameters | Report\n";
+  for (G4int iPoint = 0; iPoint < nPoints; ++iPoint) {
+    G4String tag;
+    PointCommands(iPoint, tag);
+    std::ifstream timing(PointName(iPoint) + ".timing");
+    std::string report;
+    if (!std::getline(timing, report)) report = "FAILED";
+    std::remove((PointName(iPoint) + ".timing").c_str());
+    index << iPoint << " " << PointName(iPoint) << " " << tag << " | " << report << "\n";
+  }
+  index.close();
+
+  G4double wall = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - wallStart).count();
+  G4cout << "GeometrySweep: " << nPoints << " points in " << wall << " s wall, index in " << indexName << G4endl;
+  return allOk ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+#include "GunGeneratorAction.hh"
+
+#include "G4Event.hh"
+#include "G4GenericMessenger.hh"
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cmath>
+
+GunSettings* GunSettings::fInstance = nullptr;
+
+GunSettings* GunSettings::Instance()
+{
+  if (!fInstance) fInstance = new GunSettings();
+  return fInstance;
+}
+
+GunSettings::GunSettings()
+ : pdgCode(130),
+   multiplicity(1),
+   events(0),
+   energyMin(1. * GeV),
+   energyMax(1. * GeV),
+   spectrum("flat"),
+   powerIndex(2.),
+   thetaMin(45. * deg),
+   thetaMax(135. * deg),
+   phiMin(0.),
+   phiMax(360. * deg),
+   angles("random"),
+   nEnergy(1),
+   nTheta(1),
+   nPhi(1),
+   vertex(),
+   fMessenger(nullptr)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/gun/", "Built-in particle gun (input 'gun')");
+  fMessenger->DeclareProperty("pdg", pdgCode, "PDG code of the primaries (default 130, K_L).");
+  fMessenger->DeclareProperty("multiplicity", multiplicity, "Primaries per event.");
+  fMessenger->DeclareProperty("events", events, "Events the gun provides before the run ends (0: unlimited).");
+  fMessenger->DeclarePropertyWithUnit("energyMin", "GeV", energyMin, "Lowest kinetic energy.");
+  fMessenger->DeclarePropertyWithUnit("energyMax", "GeV", energyMax, "Highest kinetic energy.");
+  fMessenger->DeclareProperty("spectrum", spectrum, "Energy spectrum: flat, log, power or grid.")
+      .SetCandidates("flat log power grid");
+  fMessenger->DeclareProperty("powerIndex", powerIndex, "dN/dE ~ E^-index for the power spectrum.");
+  fMessenger->DeclarePropertyWithUnit("thetaMin", "deg", thetaMin, "Lowest polar angle.");
+  fMessenger->DeclarePropertyWithUnit("thetaMax", "deg", thetaMax, "Highest polar angle.");
+  fMessenger->DeclarePropertyWithUnit("phiMin", "deg", phiMin, "Lowest azimuth.");
+  fMessenger->DeclarePropertyWithUnit("phiMax", "deg", phiMax, "Highest azimuth.");
+  fMessenger->DeclareProperty("angles", angles, "random (uniform in cos(theta) and phi) or grid.")
+      .SetCandidates("random grid");
+  fMessenger->DeclareProperty("nEnergy", nEnergy, "Energy points of the grid spectrum.");
+  fMessenger->DeclareProperty("nTheta", nTheta, "Theta points of the angle grid.");
+  fMessenger->DeclareProperty("nPhi", nPhi, "Phi points of the angle grid.");
+  fMessenger->DeclarePropertyWithUnit("vertex", "mm", vertex, "Common vertex of all primaries.");
+}
+
+GunSettings::~GunSettings()
+{
+  delete fMessenger;
+}
+
+GunGeneratorAction::GunGeneratorAction()
+ : InputGeneratorAction()
+{
+  const GunSettings* settings = GunSettings::Instance();
+  G4cout << "----> GunGeneratorAction: PDG " << settings->pdgCode << ", " << settings->multiplicity
+         << " per event, spectrum " << settings->spectrum << ", angles " << settings->angles << G4endl;
+}
+
+GunGeneratorAction::~GunGeneratorAction()
+{}
+
+// n points from min to max inclusive
+G4double GunGeneratorAction::GridValue(G4double min, G4double max, G4int n, G4int i)
+{
+  return n > 1 ? min + (max - min) * i / (n - 1) : min;
+}
+
+// The gun has no file; skipping only moves the event index (and stops at the event limit)
+G4int GunGeneratorAction::SkipInputEvents(G4int nEvents)
+{
+  const GunSettings* settings = GunSettings::Instance();
+  if (settings->events <= 0) return nEvents;
+  return std::max(0, std::min(nEvents, settings->events - GetNextInputEvent()));
+}
+
+void GunGeneratorAction::GenerateInputEvent(G4Event* anEvent)
+{
+  const GunSettings* settings = GunSettings::Instance();
+  const G4int inputEvent = GetNextInputEvent();
+  if (settings->events > 0 && inputEvent >= settings->events) {
+    G4cout << "[GunGeneratorAction] " << settings->events << " gun events done. Aborting run." << G4endl;
+    EndOfInput();
+    return;
+  }
+  const G4ParticleDefinition* particle = G4ParticleTable::GetParticleTable()->FindParticle(settings->pdgCode);
+  if (!particle) {
+    G4ExceptionDescription msg;
+    msg << "Unknown PDG code " << settings->pdgCode << " in /klm/gun/pdg.";
+    G4Exception("GunGeneratorAction::GenerateInputEvent", "KLMGun001", FatalException, msg);
+    return;
+  }
+
+  // Grid point of this event: phi fastest, then theta, then energy
+  const G4int nE = std::max(1, settings->nEnergy);
+  const G4int nTheta = std::max(1, settings->nTheta);
+  const G4int nPhi = std::max(1, settings->nPhi);
+  const G4int point = inputEvent % (nE * nTheta * nPhi);
+  const G4int iPhi = point % nPhi;
+  const G4int iTheta = (point / nPhi) % nTheta;
+  const G4int iE = point / (nPhi * nTheta);
+
+  for (G4int i = 0; i < settings->multiplicity; ++i) {
+    // --- Kinetic energy ---
+    G4double energy = settings->energyMin;
+    const G4double eMin = settings->energyMin, eMax = settings->energyMax;
+    if (settings->spectrum == "grid") {
+      energy = GridValue(eMin, eMax, nE, iE);
+    } else if (eMax > eMin) {
+      const G4double u = G4UniformRand();
+      if (settings->spectrum == "log" && eMin > 0.) {
+        energy = eMin * std::pow(eMax / eMin, u);
+      } else if (settings->spectrum == "power" && eMin > 0.) {
+        const G4double a = 1. - settings->powerIndex;
+        energy = std::abs(a) < 1.e-9 ? eMin * std::pow(eMax / eMin, u)
+                                      : std::pow(std::pow(eMin, a) + u * (std::pow(eMax, a) - std::pow(eMin, a)), 1. / a);
+      } else {
+        energy = eMin + u * (eMax - eMin);
+      }
+    }
+
+    // --- Direction ---
+    G4double theta, phi;
+    if (settings->angles == "grid") {
+      theta = GridValue(settings->thetaMin, settings->thetaMax, nTheta, iTheta);
+      phi = GridValue(settings->phiMin, settings->phiMax, nPhi, iPhi);
+    } else {
+      const G4double cosMin = std::cos(settings->thetaMax), cosMax = std::cos(settings->thetaMin);
+      theta = std::acos(cosMin + G4UniformRand() * (cosMax - cosMin));
+      phi = settings->phiMin + G4UniformRand() * (settings->phiMax - settings->phiMin);
+    }
+    const G4ThreeVector direction(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+    const G4double mass = particle->GetPDGMass();
+    const G4ThreeVector momentum = direction * std::sqrt(energy * (energy + 2. * mass));
+
+    // Same pre-filter as file input (/klm/filter/)
+    if (!AcceptPrimary(settings->pdgCode, momentum, settings->vertex)) continue;
+
+    G4PrimaryVertex* vertex = new G4PrimaryVertex(settings->vertex, 0.);
+    vertex->SetPrimary(new G4PrimaryParticle(particle, momentum.x(), momentum.y(), momentum.z()));
+    anEvent->AddPrimaryVertex(vertex);
+  }
+}
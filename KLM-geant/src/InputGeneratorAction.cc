@@ -0,0 +1,41 @@
+#include "InputGeneratorAction.hh"
+#include "EventSeeder.hh"
+#include "PrimaryFilter.hh"
+
+#include "G4RunManager.hh"
+
+void InputGeneratorAction::GeneratePrimaries(G4Event* anEvent)
+{
+  // Seed first, so generation and simulation both draw from the event's own stream
+  EventSeeder::Instance()->SeedEvent(fNextInputEvent);
+  PrimaryFilter::Instance()->BeginEvent();
+  fEndOfInput = false;
+  GenerateInputEvent(anEvent);
+  PrimaryFilter::Instance()->EndEvent();
+  if (!fEndOfInput) fNextInputEvent++;
+}
+
+void InputGeneratorAction::EndOfInput()
+{
+  fEndOfInput = true;
+  G4RunManager::GetRunManager()->AbortRun(true);
+}
+
+G4bool InputGeneratorAction::AcceptPrimary(G4int pdgCode, const G4ThreeVector& momentum, const G4ThreeVector& vertex)
+{
+  return PrimaryFilter::Instance()->Accept(pdgCode, momentum, vertex);
+}
+
+G4int InputGeneratorAction::SkipEvents(G4int nEvents)
+{
+  G4int skipped = SkipInputEvents(nEvents);
+  fNextInputEvent += skipped;
+  return skipped;
+}
+
+G4bool InputGeneratorAction::SeekEvent(G4int inputEvent, G4long offset)
+{
+  if (offset < 0 || !SeekInput(offset)) return false;
+  fNextInputEvent = inputEvent;
+  return true;
+}
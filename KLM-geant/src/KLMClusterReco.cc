@@ -0,0 +1,238 @@
+#include "KLMClusterReco.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <tuple>
+
+KLMClusterReco::KLMClusterReco()
+ : fMessenger(nullptr),
+   fEnabled(false),
+   fWriteCells(true),
+   fMaxLayerGap(2),
+   fZTolerance(100. * mm),
+   fPhiTolerance(3. * deg),
+   fHalfLength(1.),
+   fSectorAngle(45. * deg),
+   fNumZ(96),
+   fNumPhi06(36),
+   fNumPhi714(48),
+   fEvents(0),
+   fClusters(0),
+   fSeconds(0.)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/reco/", "Inline KLM cluster reconstruction");
+  fMessenger->DeclareProperty("enable", fEnabled, "Write <output>.clusters with the clusters of every event.");
+  fMessenger->DeclareProperty("writeCells", fWriteCells,
+      "Also write the cell lines to the main output (false: clusters only).");
+  fMessenger->DeclareProperty("maxLayerGap", fMaxLayerGap,
+      "Largest stack difference between hits of one cluster (2: one missing layer is bridged).");
+  fMessenger->DeclarePropertyWithUnit("zTolerance", "mm", fZTolerance, "Largest z distance between linked hits.");
+  fMessenger->DeclarePropertyWithUnit("phiTolerance", "deg", fPhiTolerance, "Largest phi distance between linked hits.");
+}
+
+KLMClusterReco::~KLMClusterReco()
+{
+  CloseOutput();
+  delete fMessenger;
+}
+
+void KLMClusterReco::SetGeometry(G4double halfLength, G4double sectorAngle, G4int nZ, G4int nPhi06, G4int nPhi714)
+{
+  fHalfLength = halfLength;
+  fSectorAngle = sectorAngle;
+  fNumZ = nZ;
+  fNumPhi06 = nPhi06;
+  fNumPhi714 = nPhi714;
+}
+
+// Cell centres, inverse of MylarSD::ComputeCells
+G4double KLMClusterReco::StripZ(G4double strip) const
+{
+  return (strip + 0.5) / fNumZ * 2. * fHalfLength - fHalfLength;
+}
+
+G4double KLMClusterReco::StripPhi(G4double strip, G4int stack) const
+{
+  const G4int nPhi = stack > 6 ? fNumPhi714 : fNumPhi06;
+  return (strip + 0.5) / nPhi * fSectorAngle - 0.5 * fSectorAngle;
+}
+
+void KLMClusterReco::ReconstructCells(const std::vector<KLMCellDeposit>& cells, std::vector<Cluster>& clusters)
+{
+  auto start = std::chrono::steady_clock::now();
+  fHits.clear();
+  for (const KLMCellDeposit& cell : cells) {
+    fHits.push_back(Hit2D{cell.sector, cell.stack, StripZ(cell.zCell), StripPhi(cell.phiCell, cell.stack),
+                          cell.time, cell.edep});
+  }
+  ClusterHits(clusters);
+  fSeconds += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void KLMClusterReco::ReconstructDigits(const std::vector<KLMDigit>& digits, std::vector<Cluster>& clusters)
+{
+  auto start = std::chrono::steady_clock::now();
+  fHits.clear();
+  fSortedDigits.assign(digits.begin(), digits.end());
+  std::sort(fSortedDigits.begin(), fSortedDigits.end(), [](const KLMDigit& a, const KLMDigit& b) {
+    return std::tie(a.sector, a.stack, a.plane, a.strip) < std::tie(b.sector, b.stack, b.plane, b.strip);
+  });
+
+  // --- Per (sector, stack): 1D clusters of adjacent strips, then every z x phi pair ---
+  std::size_t begin = 0;
+  while (begin < fSortedDigits.size()) {
+    const G4int sector = fSortedDigits[begin].sector;
+    const G4int stack = fSortedDigits[begin].stack;
+    fStripClusters[0].clear();
+    fStripClusters[1].clear();
+    std::size_t end = begin;
+    G4double stripSum = 0.;
+    G4int nStrips = 0;
+    for (; end < fSortedDigits.size() && fSortedDigits[end].sector == sector && fSortedDigits[end].stack == stack; ++end) {
+      const KLMDigit& digit = fSortedDigits[end];
+      std::vector<StripCluster>& planeClusters = fStripClusters[digit.plane];
+      const G4bool extends = end > begin && fSortedDigits[end - 1].plane == digit.plane &&
+                             fSortedDigits[end - 1].strip + 1 == digit.strip;
+      if (extends) {
+        StripCluster& cluster = planeClusters.back();
+        stripSum += digit.strip;
+        nStrips++;
+        cluster.centre = stripSum / nStrips;
+        cluster.time = std::min(cluster.time, digit.time);
+        cluster.edep += digit.edep;
+      } else {
+        stripSum = digit.strip;
+        nStrips = 1;
+        planeClusters.push_back(StripCluster{static_cast<G4double>(digit.strip), digit.time, digit.edep});
+      }
+    }
+    const std::size_t nPhiClusters = fStripClusters[1].size();
+    for (const StripCluster& zCluster : fStripClusters[0]) {
+      for (const StripCluster& phiCluster : fStripClusters[1]) {
+        // The z-plane energy is shared among the pairings, so ghosts do not inflate the sum
+        fHits.push_back(Hit2D{sector, stack, StripZ(zCluster.centre), StripPhi(phiCluster.centre, stack),
+                              std::min(zCluster.time, phiCluster.time), zCluster.edep / nPhiClusters});
+      }
+    }
+    begin = end;
+  }
+  ClusterHits(clusters);
+  fSeconds += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+}
+
+G4int KLMClusterReco::Find(G4int i)
+{
+  while (fParent[i] != i) {
+    fParent[i] = fParent[fParent[i]];
+    i = fParent[i];
+  }
+  return i;
+}
+
+void KLMClusterReco::ClusterHits(std::vector<Cluster>& clusters)
+{
+  clusters.clear();
+  fEvents++;
+  const G4int n = static_cast<G4int>(fHits.size());
+  if (n == 0) return;
+  std::sort(fHits.begin(), fHits.end(), [](const Hit2D& a, const Hit2D& b) {
+    return std::tie(a.sector, a.stack) < std::tie(b.sector, b.stack);
+  });
+
+  // --- Link hits of one sector within the layer gap and the spatial tolerances ---
+  fParent.resize(n);
+  for (G4int i = 0; i < n; ++i) fParent[i] = i;
+  for (G4int i = 0; i < n; ++i) {
+    for (G4int j = i + 1; j < n && fHits[j].sector == fHits[i].sector &&
+                          fHits[j].stack - fHits[i].stack <= fMaxLayerGap; ++j) {
+      if (std::abs(fHits[j].z - fHits[i].z) <= fZTolerance &&
+          std::abs(fHits[j].phi - fHits[i].phi) <= fPhiTolerance) {
+        fParent[Find(j)] = Find(i);
+      }
+    }
+  }
+
+  // --- Accumulate the clusters (energy-weighted centroid, unweighted if no energy) ---
+  fClusterOf.assign(n, -1);
+  fLayerMasks.clear();
+  fSumZ.clear();
+  fSumPhi.clear();
+  for (G4int i = 0; i < n; ++i) {
+    const G4int root = Find(i);
+    if (fClusterOf[root] < 0) {
+      fClusterOf[root] = static_cast<G4int>(clusters.size());
+      clusters.push_back(Cluster{fHits[i].sector, 0, fHits[i].stack, fHits[i].stack, 0., 0., fHits[i].time, 0., 0});
+      fLayerMasks.push_back(0);
+      fSumZ.push_back(0.);
+      fSumPhi.push_back(0.);
+    }
+    const G4int c = fClusterOf[root];
+    Cluster& cluster = clusters[c];
+    const Hit2D& hit = fHits[i];
+    cluster.firstLayer = std::min(cluster.firstLayer, hit.stack);
+    cluster.lastLayer = std::max(cluster.lastLayer, hit.stack);
+    cluster.time = std::min(cluster.time, hit.time);
+    cluster.z += hit.edep * hit.z;
+    cluster.phi += hit.edep * hit.phi;
+    cluster.edep += hit.edep;
+    cluster.nHits++;
+    fSumZ[c] += hit.z;
+    fSumPhi[c] += hit.phi;
+    if (hit.stack >= 0 && hit.stack < 64) fLayerMasks[c] |= 1ULL << hit.stack;
+  }
+  for (std::size_t c = 0; c < clusters.size(); ++c) {
+    Cluster& cluster = clusters[c];
+    if (cluster.edep > 0.) {
+      cluster.z /= cluster.edep;
+      cluster.phi /= cluster.edep;
+    } else {
+      cluster.z = fSumZ[c] / cluster.nHits;
+      cluster.phi = fSumPhi[c] / cluster.nHits;
+    }
+    cluster.nLayers = static_cast<G4int>(std::bitset<64>(fLayerMasks[c]).count());
+  }
+  fClusters += clusters.size();
+}
+
+G4bool KLMClusterReco::OpenOutput(const G4String& fileName, G4bool append)
+{
+  CloseOutput();
+  fOutput.open(fileName, std::ios::out | (append ? std::ios::app : std::ios::trunc));
+  if (!fOutput) {
+    G4cerr << "KLMClusterReco: cannot write " << fileName << G4endl;
+    return false;
+  }
+  if (!append) fOutput << "# EventID Sector NLayers FirstLayer LastLayer Z_mm Phi_deg Time_ns Edep_keV NHits\n";
+  fEvents = 0;
+  fClusters = 0;
+  fSeconds = 0.;
+  return true;
+}
+
+void KLMClusterReco::Write(G4int eventID, const std::vector<Cluster>& clusters)
+{
+  if (!fOutput.is_open()) return;
+  for (const Cluster& cluster : clusters) {
+    fOutput << eventID << " " << cluster.sector << " " << cluster.nLayers << " " << cluster.firstLayer << " "
+            << cluster.lastLayer << " " << cluster.z / mm << " " << cluster.phi / deg << " "
+            << cluster.time / ns << " " << cluster.edep / keV << " " << cluster.nHits << "\n";
+  }
+}
+
+void KLMClusterReco::CloseOutput()
+{
+  if (fOutput.is_open()) fOutput.close();
+}
+
+void KLMClusterReco::PrintStatistics() const
+{
+  if (!fEnabled || fEvents == 0) return;
+  G4cout << "KLMClusterReco: " << fClusters << " clusters in " << fEvents << " events, "
+         << 1.e6 * fSeconds / fEvents << " us/event" << G4endl;
+}
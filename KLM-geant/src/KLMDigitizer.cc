@@ -0,0 +1,188 @@
+#include "KLMDigitizer.hh"
+#include "EventSeeder.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace {
+  G4long ChannelKey(G4int sector, G4int stack, G4int plane, G4int strip)
+  {
+    return ((static_cast<G4long>(sector) * 64 + stack) * 2 + plane) * 1024 + strip;
+  }
+}
+
+KLMDigitizer::KLMDigitizer()
+ : fMessenger(nullptr),
+   fEnabled(false),
+   fThreshold(0.1 * keV),
+   fEfficiency(0.95),
+   fMeanClusterSize(1.5),
+   fTimeResolution(2. * ns),
+   fSeed(0),
+   fNumZStrips(96),
+   fNumPhiStrips06(36),
+   fNumPhiStrips714(48)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/digi/", "RPC strip digitizer");
+  fMessenger->DeclareProperty("enable", fEnabled, "Write <output>.digits with strip hits of every event.");
+  fMessenger->DeclarePropertyWithUnit("threshold", "keV", fThreshold, "Cell energy threshold.");
+  fMessenger->DeclareProperty("efficiency", fEfficiency, "Strip efficiency per plane.");
+  fMessenger->DeclareProperty("clusterSize", fMeanClusterSize, "Mean number of strips per fired strip (>= 1).");
+  fMessenger->DeclarePropertyWithUnit("timeResolution", "ns", fTimeResolution, "Gaussian time smearing.");
+  fMessenger->DeclareProperty("seed", fSeed, "Digitizer seed (independent of the simulation seed).");
+  fMessenger->DeclareMethod("deadChannels", &KLMDigitizer::SetDeadChannelFile,
+      "File of dead channels, one 'sector stack plane strip' per line.");
+}
+
+KLMDigitizer::~KLMDigitizer()
+{
+  CloseOutput();
+  delete fMessenger;
+}
+
+void KLMDigitizer::SetStripCounts(G4int nZStrips, G4int nPhiStrips06, G4int nPhiStrips714)
+{
+  fNumZStrips = nZStrips;
+  fNumPhiStrips06 = nPhiStrips06;
+  fNumPhiStrips714 = nPhiStrips714;
+}
+
+// Same split as MylarSD::ComputeCells
+G4int KLMDigitizer::NumStrips(G4int stack, G4int plane) const
+{
+  if (plane == kZPlane) return fNumZStrips;
+  return stack > 6 ? fNumPhiStrips714 : fNumPhiStrips06;
+}
+
+void KLMDigitizer::SetDeadChannelFile(const G4String& fileName)
+{
+  LoadDeadChannels(fileName);
+}
+
+G4bool KLMDigitizer::LoadDeadChannels(const G4String& fileName)
+{
+  std::ifstream in(fileName);
+  if (!in) {
+    G4cerr << "KLMDigitizer: cannot read dead-channel file " << fileName << G4endl;
+    return false;
+  }
+  fDeadChannels.clear();
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream fields(line);
+    G4int sector, stack, plane, strip;
+    if (fields >> sector >> stack >> plane >> strip) {
+      fDeadChannels.insert(ChannelKey(sector, stack, plane, strip));
+    }
+  }
+  G4cout << "KLMDigitizer: " << fDeadChannels.size() << " dead channels from " << fileName << G4endl;
+  return true;
+}
+
+G4bool KLMDigitizer::IsDead(G4int sector, G4int stack, G4int plane, G4int strip) const
+{
+  return !fDeadChannels.empty() && fDeadChannels.count(ChannelKey(sector, stack, plane, strip));
+}
+
+void KLMDigitizer::AddStrip(const KLMCellDeposit& cell, G4int plane, G4int strip, G4double time)
+{
+  if (IsDead(cell.sector, cell.stack, plane, strip)) return;
+  fStrips.push_back(KLMDigit{cell.sector, cell.stack, plane, strip, time, cell.edep});
+}
+
+void KLMDigitizer::Digitize(G4int eventID, const std::vector<KLMCellDeposit>& cells, std::vector<KLMDigit>& digits)
+{
+  digits.clear();
+  fStrips.clear();
+  const std::size_t n = cells.size();
+  if (n == 0) return;
+
+  fEngine.seed(static_cast<std::uint64_t>(EventSeeder::EventSeed(fSeed, eventID)));
+  std::uniform_real_distribution<G4double> uniform(0., 1.);
+  std::normal_distribution<G4double> gauss(0., 1.);
+
+  // --- Threshold and efficiency over all touched cells, branch-free ---
+  fEdep.resize(n);
+  fUniform.resize(2 * n);
+  fFired.resize(n);
+  for (std::size_t i = 0; i < n; ++i) fEdep[i] = cells[i].edep;
+  for (std::size_t i = 0; i < 2 * n; ++i) fUniform[i] = uniform(fEngine);
+  const G4double threshold = fThreshold;
+  const G4double efficiency = fEfficiency;
+  for (std::size_t i = 0; i < n; ++i) {
+    const unsigned char above = fEdep[i] > threshold;
+    fFired[i] = static_cast<unsigned char>((above & (fUniform[2 * i] < efficiency)) |
+                                           ((above & (fUniform[2 * i + 1] < efficiency)) << 1));
+  }
+
+  // --- Strips with clusters and smeared times ---
+  // Extra strips per fired strip are geometric with mean (clusterSize - 1)
+  const G4double extraProbability = fMeanClusterSize > 1. ? (fMeanClusterSize - 1.) / fMeanClusterSize : 0.;
+  for (std::size_t i = 0; i < n; ++i) {
+    if (!fFired[i]) continue;
+    const KLMCellDeposit& cell = cells[i];
+    for (G4int plane = kZPlane; plane <= kPhiPlane; ++plane) {
+      if (!(fFired[i] & (1 << plane))) continue;
+      const G4int center = plane == kZPlane ? cell.zCell : cell.phiCell;
+      const G4int nStrips = NumStrips(cell.stack, plane);
+      const G4double time = cell.time + fTimeResolution * gauss(fEngine);
+      AddStrip(cell, plane, center, time);
+      G4int low = center, high = center;
+      while (uniform(fEngine) < extraProbability) {
+        // Grow the cluster on a random side, staying on the plane
+        G4bool up = uniform(fEngine) < 0.5;
+        if ((up && high + 1 >= nStrips) || (!up && low == 0)) up = !up;
+        if (up && high + 1 < nStrips) AddStrip(cell, plane, ++high, time);
+        else if (!up && low > 0) AddStrip(cell, plane, --low, time);
+        else break;
+      }
+    }
+  }
+
+  // --- Merge strips fired by several cells: earliest time, summed energy ---
+  std::sort(fStrips.begin(), fStrips.end(), [](const KLMDigit& a, const KLMDigit& b) {
+    return ChannelKey(a.sector, a.stack, a.plane, a.strip) < ChannelKey(b.sector, b.stack, b.plane, b.strip);
+  });
+  for (const KLMDigit& strip : fStrips) {
+    if (!digits.empty() && digits.back().sector == strip.sector && digits.back().stack == strip.stack &&
+        digits.back().plane == strip.plane && digits.back().strip == strip.strip) {
+      digits.back().time = std::min(digits.back().time, strip.time);
+      digits.back().edep += strip.edep;
+    } else {
+      digits.push_back(strip);
+    }
+  }
+}
+
+G4bool KLMDigitizer::OpenOutput(const G4String& fileName, G4bool append)
+{
+  CloseOutput();
+  fOutput.open(fileName, std::ios::out | (append ? std::ios::app : std::ios::trunc));
+  if (!fOutput) {
+    G4cerr << "KLMDigitizer: cannot write " << fileName << G4endl;
+    return false;
+  }
+  if (!append) fOutput << "# EventID Sector Stack Plane(0=z,1=phi) Strip Time_ns Edep_keV\n";
+  return true;
+}
+
+void KLMDigitizer::Write(G4int eventID, const std::vector<KLMDigit>& digits)
+{
+  if (!fOutput.is_open()) return;
+  for (const KLMDigit& digit : digits) {
+    fOutput << eventID << " " << digit.sector << " " << digit.stack << " " << digit.plane << " "
+            << digit.strip << " " << digit.time / ns << " " << digit.edep / keV << "\n";
+  }
+}
+
+void KLMDigitizer::CloseOutput()
+{
+  if (fOutput.is_open()) fOutput.close();
+}
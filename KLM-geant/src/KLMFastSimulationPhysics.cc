@@ -0,0 +1,49 @@
+#include "KLMFastSimulationPhysics.hh"
+#include "FastMuonModel.hh"
+#include "KLShowerModel.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4GlobalFastSimulationManager.hh"
+#include "G4ios.hh"
+
+G4bool KLMFastSimulationPhysics::fConstructed = false;
+
+KLMFastSimulationPhysics::KLMFastSimulationPhysics()
+ : G4FastSimulationPhysics(),
+   fMessenger(nullptr),
+   fRequested(false)
+{
+  ActivateFastSimulation("mu-");
+  ActivateFastSimulation("mu+");
+  ActivateFastSimulation("kaon0L");
+
+  fMessenger = new G4GenericMessenger(this, "/klm/fastsim/", "KLM fast simulation");
+  fMessenger->DeclareProperty("physics", fRequested,
+      "Construct the fast-simulation process for mu+-, K_L (before /run/initialize; needed by /klm/fastsim/muon/ and /klm/fastsim/kl/).")
+      .SetStates(G4State_PreInit);
+}
+
+KLMFastSimulationPhysics::~KLMFastSimulationPhysics()
+{
+  delete fMessenger;
+}
+
+void KLMFastSimulationPhysics::ConstructProcess()
+{
+  if (!fRequested) return;
+  G4FastSimulationPhysics::ConstructProcess();
+  fConstructed = true;
+}
+
+void KLMFastSimulationPhysics::CheckModels()
+{
+  if (fConstructed) return;
+  G4GlobalFastSimulationManager* manager = G4GlobalFastSimulationManager::GetGlobalFastSimulationManager();
+  const FastMuonModel* muonModel = dynamic_cast<const FastMuonModel*>(manager->GetFastSimulationModel("KLMFastMuonModel"));
+  const KLShowerModel* klShowerModel = KLShowerModel::Find();
+  if ((muonModel && muonModel->IsEnabled()) || (klShowerModel && klShowerModel->IsActive())) {
+    G4Exception("KLMFastSimulationPhysics::CheckModels", "KLMFastSim001", JustWarning,
+                "A fast simulation model is enabled, but the fast-simulation process was not constructed; "
+                "it has no effect. Give /klm/fastsim/physics true before /run/initialize.");
+  }
+}
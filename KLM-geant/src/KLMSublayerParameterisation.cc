@@ -0,0 +1,56 @@
+#include "KLMSublayerParameterisation.hh"
+
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Trd.hh"
+#include "G4ThreeVector.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cmath>
+
+KLMSublayerParameterisation::KLMSublayerParameterisation(G4int stack,
+                                                         const std::vector<Sublayer>& sublayers,
+                                                         G4double halfLength,
+                                                         G4double sectorAngle)
+ : G4VPVParameterisation(),
+   fStack(stack),
+   fSublayers(sublayers),
+   fHalfLength(halfLength),
+   fTanHalfAngle(std::tan(sectorAngle / 2.0)),
+   fRotation(new G4RotationMatrix())
+{
+  // Frame rotation of -90 deg about y == object rotation of +90 deg:
+  // trd +z -> sector +x (outward), trd x -> beam axis
+  fRotation->rotateY(-90. * deg);
+}
+
+KLMSublayerParameterisation::~KLMSublayerParameterisation()
+{
+  delete fRotation;
+}
+
+void KLMSublayerParameterisation::ComputeTransformation(const G4int copyNo,
+                                                        G4VPhysicalVolume* physVol) const
+{
+  const Sublayer& sub = fSublayers[copyNo];
+  physVol->SetTranslation(G4ThreeVector(0.5 * (sub.rMin + sub.rMax), 0., 0.));
+  physVol->SetRotation(fRotation);
+}
+
+void KLMSublayerParameterisation::ComputeDimensions(G4Trd& trd, const G4int copyNo,
+                                                    const G4VPhysicalVolume*) const
+{
+  const Sublayer& sub = fSublayers[copyNo];
+  trd.SetAllParameters(fHalfLength, fHalfLength,
+                       sub.rMin * fTanHalfAngle, sub.rMax * fTanHalfAngle,
+                       0.5 * (sub.rMax - sub.rMin));
+}
+
+G4Material* KLMSublayerParameterisation::ComputeMaterial(const G4int copyNo,
+                                                         G4VPhysicalVolume* physVol,
+                                                         const G4VTouchable*)
+{
+  const Sublayer& sub = fSublayers[copyNo];
+  if (physVol && sub.visAtt) physVol->GetLogicalVolume()->SetVisAttributes(sub.visAtt);
+  return sub.material;
+}
@@ -0,0 +1,239 @@
+#include "KLShowerLibrary.hh"
+
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace {
+  const char kMagic[8] = {'K', 'L', 'S', 'H', 'L', 'I', 'B', '1'};
+
+  template <typename T> void put(std::ostream& out, const T& value)
+  {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  template <typename T> G4bool get(std::istream& in, T& value)
+  {
+    return static_cast<G4bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+  }
+}
+
+KLShowerLibrary::KLShowerLibrary()
+{}
+
+KLShowerLibrary::~KLShowerLibrary()
+{}
+
+void KLShowerLibrary::SetBinning(const std::vector<G4double>& energyEdges,
+                                 const std::vector<G4double>& cosEdges)
+{
+  fEnergyEdges = energyEdges;
+  fCosEdges = cosEdges;
+  std::sort(fEnergyEdges.begin(), fEnergyEdges.end());
+  std::sort(fCosEdges.begin(), fCosEdges.end());
+  std::size_t nBins = (fEnergyEdges.size() > 1 && fCosEdges.size() > 1)
+      ? (fEnergyEdges.size() - 1) * (fCosEdges.size() - 1) : 0;
+  fBins.assign(nBins, std::vector<Template>());
+}
+
+G4int KLShowerLibrary::FindBin(G4double kinE, G4double cosNormal) const
+{
+  if (fBins.empty()) return -1;
+  auto eIt = std::upper_bound(fEnergyEdges.begin(), fEnergyEdges.end(), kinE);
+  auto cIt = std::upper_bound(fCosEdges.begin(), fCosEdges.end(), cosNormal);
+  if (eIt == fEnergyEdges.begin() || eIt == fEnergyEdges.end()) return -1;
+  if (cIt == fCosEdges.begin()) return -1;
+  if (cIt == fCosEdges.end()) {
+    if (cosNormal > fCosEdges.back()) return -1;
+    --cIt; // cos = upper edge (normal incidence) belongs to the last bin
+  }
+  G4int iE = static_cast<G4int>(eIt - fEnergyEdges.begin()) - 1;
+  G4int iC = static_cast<G4int>(cIt - fCosEdges.begin()) - 1;
+  return iE * static_cast<G4int>(fCosEdges.size() - 1) + iC;
+}
+
+void KLShowerLibrary::AddTemplate(G4int bin, const Template& shower)
+{
+  if (bin >= 0 && bin < static_cast<G4int>(fBins.size())) fBins[bin].push_back(shower);
+}
+
+const KLShowerLibrary::Template* KLShowerLibrary::Sample(G4int bin) const
+{
+  if (bin < 0 || bin >= static_cast<G4int>(fBins.size()) || fBins[bin].empty()) return nullptr;
+  std::size_t i = static_cast<std::size_t>(G4UniformRand() * fBins[bin].size());
+  return &fBins[bin][std::min(i, fBins[bin].size() - 1)];
+}
+
+std::size_t KLShowerLibrary::GetNumberOfTemplates(G4int bin) const
+{
+  return (bin >= 0 && bin < static_cast<G4int>(fBins.size())) ? fBins[bin].size() : 0;
+}
+
+std::size_t KLShowerLibrary::GetTotalNumberOfTemplates() const
+{
+  std::size_t n = 0;
+  for (const auto& bin : fBins) n += bin.size();
+  return n;
+}
+
+G4bool KLShowerLibrary::Append(const KLShowerLibrary& other)
+{
+  if (other.fEnergyEdges != fEnergyEdges || other.fCosEdges != fCosEdges) return false;
+  for (std::size_t iBin = 0; iBin < fBins.size(); ++iBin) {
+    fBins[iBin].insert(fBins[iBin].end(), other.fBins[iBin].begin(), other.fBins[iBin].end());
+  }
+  return true;
+}
+
+G4bool KLShowerLibrary::AppendToFile(const std::string& fileName,
+                                     const std::vector<const KLShowerLibrary*>& additions,
+                                     KLShowerLibrary* merged)
+{
+  const std::string lockName = fileName + ".lock";
+  int lock = open(lockName.c_str(), O_RDWR | O_CREAT, 0644);
+  if (lock < 0 || flock(lock, LOCK_EX) != 0) {
+    G4cerr << "KLShowerLibrary: cannot lock " << lockName << G4endl;
+    if (lock >= 0) close(lock);
+    return false;
+  }
+  // Re-read under the lock: another process may have added templates since this one loaded the file
+  KLShowerLibrary library;
+  G4bool ok = true;
+  if (std::ifstream(fileName)) {
+    ok = library.Read(fileName);
+  } else if (!additions.empty()) {
+    library.SetBinning(additions.front()->fEnergyEdges, additions.front()->fCosEdges);
+  }
+  for (const KLShowerLibrary* addition : additions) {
+    if (ok && !library.Append(*addition)) {
+      G4cerr << "KLShowerLibrary: the new templates have another binning than " << fileName << G4endl;
+      ok = false;
+    }
+  }
+  ok = ok && library.Write(fileName);
+  flock(lock, LOCK_UN);
+  close(lock);
+  if (ok && merged) *merged = library;
+  return ok;
+}
+
+G4bool KLShowerLibrary::Write(const std::string& fileName) const
+{
+  // Written to a temporary name and renamed, so readers never see half a library
+  const std::string tmpName = fileName + ".tmp" + std::to_string(getpid());
+  std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    G4cerr << "KLShowerLibrary: cannot write " << tmpName << G4endl;
+    return false;
+  }
+  out.write(kMagic, sizeof(kMagic));
+  put(out, static_cast<std::uint32_t>(fEnergyEdges.size() - 1));
+  put(out, static_cast<std::uint32_t>(fCosEdges.size() - 1));
+  for (G4double edge : fEnergyEdges) put(out, edge);
+  for (G4double edge : fCosEdges) put(out, edge);
+
+  // Index: offsets of each bin's first template
+  std::uint64_t offset = static_cast<std::uint64_t>(out.tellp())
+                       + fBins.size() * (sizeof(std::uint64_t) + sizeof(std::uint32_t));
+  for (const auto& bin : fBins) {
+    put(out, offset);
+    put(out, static_cast<std::uint32_t>(bin.size()));
+    for (const auto& shower : bin) {
+      offset += sizeof(float) + sizeof(std::uint32_t) + shower.hits.size() * sizeof(Hit);
+    }
+  }
+  for (const auto& bin : fBins) {
+    for (const auto& shower : bin) {
+      put(out, shower.energy);
+      put(out, static_cast<std::uint32_t>(shower.hits.size()));
+      if (!shower.hits.empty()) {
+        out.write(reinterpret_cast<const char*>(shower.hits.data()), shower.hits.size() * sizeof(Hit));
+      }
+    }
+  }
+  out.close();
+  if (!out || std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+    G4cerr << "KLShowerLibrary: writing " << fileName << " failed" << G4endl;
+    return false;
+  }
+  return true;
+}
+
+// Every count and offset is checked against the file size before it sizes a vector or moves
+// the read position, so a truncated or corrupt file fails cleanly and leaves an empty library
+G4bool KLShowerLibrary::Read(const std::string& fileName)
+{
+  fEnergyEdges.clear();
+  fCosEdges.clear();
+  fBins.clear();
+  auto fail = [this, &fileName](const std::string& reason) {
+    G4cerr << "KLShowerLibrary: " << fileName << ": " << reason << G4endl;
+    fEnergyEdges.clear();
+    fCosEdges.clear();
+    fBins.clear();
+    return false;
+  };
+  std::ifstream in(fileName, std::ios::binary | std::ios::ate);
+  if (!in) return fail("cannot open");
+  const std::uint64_t fileSize = static_cast<std::uint64_t>(in.tellg());
+  in.seekg(0);
+  char magic[sizeof(kMagic)];
+  if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+    return fail("not a K_L shower library");
+  }
+  std::uint32_t nE = 0, nA = 0;
+  if (!get(in, nE) || !get(in, nA)) return fail("truncated header");
+  if (nE == 0 || nA == 0) return fail("no energy or angle bins");
+  // Edges and index must fit in the file: nE + nA + 2 doubles, then 12 bytes per bin
+  const std::uint64_t indexEntrySize = sizeof(std::uint64_t) + sizeof(std::uint32_t);
+  std::uint64_t remaining = fileSize - static_cast<std::uint64_t>(in.tellg());
+  const std::uint64_t nEdges = std::uint64_t(nE) + nA + 2;
+  if (nEdges > remaining / sizeof(G4double)) return fail("bin edges exceed the file size");
+  remaining -= nEdges * sizeof(G4double);
+  if (std::uint64_t(nA) > remaining / indexEntrySize / nE) return fail("bin index exceeds the file size");
+
+  std::vector<G4double> energyEdges(nE + 1), cosEdges(nA + 1);
+  for (auto& edge : energyEdges) if (!get(in, edge)) return fail("truncated energy edges");
+  for (auto& edge : cosEdges) if (!get(in, edge)) return fail("truncated angle edges");
+  SetBinning(energyEdges, cosEdges);
+
+  std::vector<std::pair<std::uint64_t, std::uint32_t> > index(fBins.size());
+  for (auto& entry : index) {
+    if (!get(in, entry.first) || !get(in, entry.second)) return fail("truncated bin index");
+  }
+  const std::uint64_t payloadStart = static_cast<std::uint64_t>(in.tellg());
+  const std::uint64_t templateHeaderSize = sizeof(float) + sizeof(std::uint32_t);
+  for (std::size_t iBin = 0; iBin < fBins.size(); ++iBin) {
+    const std::uint64_t offset = index[iBin].first;
+    const std::uint32_t nTemplates = index[iBin].second;
+    if (offset < payloadStart || offset > fileSize) {
+      return fail("bin " + std::to_string(iBin) + " offset " + std::to_string(offset) + " outside the payload");
+    }
+    if (nTemplates > (fileSize - offset) / templateHeaderSize) {
+      return fail("bin " + std::to_string(iBin) + " has more templates than fit in the file");
+    }
+    in.seekg(static_cast<std::streamoff>(offset));
+    fBins[iBin].resize(nTemplates);
+    for (auto& shower : fBins[iBin]) {
+      std::uint32_t nHits = 0;
+      if (!get(in, shower.energy) || !get(in, nHits)) {
+        return fail("truncated template in bin " + std::to_string(iBin));
+      }
+      const std::uint64_t position = static_cast<std::uint64_t>(in.tellg());
+      if (nHits > (fileSize - position) / sizeof(Hit)) {
+        return fail("template in bin " + std::to_string(iBin) + " has more hits than fit in the file");
+      }
+      shower.hits.resize(nHits);
+      if (nHits > 0 && !in.read(reinterpret_cast<char*>(shower.hits.data()), nHits * sizeof(Hit))) {
+        return fail("truncated hits in bin " + std::to_string(iBin));
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,251 @@
+#include "KLShowerModel.hh"
+#include "DetectorConstruction.hh"
+#include "MylarSD.hh"
+
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4GlobalFastSimulationManager.hh"
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4KaonZeroLong.hh"
+#include "G4EventManager.hh"
+#include "G4Event.hh"
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace {
+  std::vector<G4double> ParseEdges(const G4String& text, G4double unit)
+  {
+    std::vector<G4double> edges;
+    std::istringstream in(text);
+    G4double value;
+    while (in >> value) edges.push_back(value * unit);
+    return edges;
+  }
+}
+
+KLShowerModel::KLShowerModel(G4Region* envelope, const DetectorConstruction* detector, MylarSD* mylarSD)
+ : G4VFastSimulationModel("KLShowerModel", envelope),
+   fDetector(detector),
+   fMylarSD(mylarSD),
+   fMessenger(nullptr),
+   fMode("off"),
+   fLibraryFile("kl_shower_library.bin"),
+   fEnergyBins("0.2 0.5 1 1.5 2 3 4 6"),
+   fAngleBins("0.2 0.5 0.7 0.85 0.95 1"),
+   fFullSimLayers(0),
+   fMinEnergy(0.1 * GeV),
+   fLibraryModified(false),
+   fGeometryCached(false),
+   fCachedFullSimLayers(-1),
+   fFullSimBoundary(0.),
+   fRecordEventID(-1),
+   fRecordSector(-1),
+   fRecordStack(-1),
+   fRecordBin(-1),
+   fRecordEnergy(0.),
+   fRecordTime(0.),
+   fSampledShowers(0),
+   fRecordedShowers(0)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/fastsim/kl/", "K_L shower library fast simulation");
+  fMessenger->DeclareProperty("mode", fMode,
+      "off: full simulation; record: build the library from full simulation; sample: use the library.")
+      .SetCandidates("off record sample");
+  fMessenger->DeclareProperty("library", fLibraryFile, "Shower library file.");
+  fMessenger->DeclareProperty("energyBins", fEnergyBins,
+      "K_L kinetic energy bin edges in GeV (new libraries only).");
+  fMessenger->DeclareProperty("angleBins", fAngleBins,
+      "Bin edges of the direction cosine to the sector normal (new libraries only).");
+  fMessenger->DeclareProperty("fullSimLayers", fFullSimLayers,
+      "Number of innermost iron plates in which K_L are always fully simulated.");
+  fMessenger->DeclarePropertyWithUnit("minEnergy", "GeV", fMinEnergy,
+      "K_L below this kinetic energy are always fully simulated.");
+}
+
+KLShowerModel::~KLShowerModel()
+{
+  delete fMessenger;
+}
+
+KLShowerModel* KLShowerModel::Find()
+{
+  G4GlobalFastSimulationManager* manager = G4GlobalFastSimulationManager::GetGlobalFastSimulationManager();
+  return manager ? dynamic_cast<KLShowerModel*>(manager->GetFastSimulationModel("KLShowerModel")) : nullptr;
+}
+
+G4bool KLShowerModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return &particle == G4KaonZeroLong::Definition();
+}
+
+void KLShowerModel::CacheGeometry()
+{
+  fFullSimBoundary = 0.;
+  fGasLayerStarts.clear();
+  fGasRadius.clear();
+  fGasSublayerIDs.clear();
+  G4int ironSeen = 0;
+  for (const KLMRadialLayer& layer : fDetector->GetRadialLayers()) {
+    if (layer.subLayerID < 0 && ++ironSeen == fFullSimLayers) fFullSimBoundary = layer.rMax;
+    if (layer.isGasGap) {
+      fGasLayerStarts.push_back(std::make_pair(layer.rMin, layer.stack));
+      fGasRadius[std::make_pair(layer.stack, layer.subLayerID)] = 0.5 * (layer.rMin + layer.rMax);
+      fGasSublayerIDs[fDetector->GetSublayerName(layer.subLayerID)] = layer.subLayerID;
+    }
+  }
+  std::sort(fGasLayerStarts.begin(), fGasLayerStarts.end());
+  fCachedFullSimLayers = fFullSimLayers;
+  fGeometryCached = true;
+}
+
+G4int KLShowerModel::EntryStack(G4double x) const
+{
+  auto next = std::lower_bound(fGasLayerStarts.begin(), fGasLayerStarts.end(), std::make_pair(x, -1));
+  return next == fGasLayerStarts.end() ? -1 : next->second;
+}
+
+G4bool KLShowerModel::PrepareLibrary()
+{
+  if (fLoadedFile == fLibraryFile) return true;
+  fLoadedFile = fLibraryFile;
+  fLibraryModified = false;
+  // A missing file is not an error when recording; Read reports anything wrong with an existing one
+  if (std::ifstream(fLibraryFile) && fLibrary.Read(fLibraryFile)) {
+    G4cout << "KLShowerModel: loaded " << fLibrary.GetTotalNumberOfTemplates()
+           << " K_L shower templates from " << fLibraryFile << G4endl;
+    fRecorded.SetBinning(fLibrary.GetEnergyEdges(), fLibrary.GetCosEdges());
+    return true;
+  }
+  fLibrary.SetBinning(std::vector<G4double>(), std::vector<G4double>());
+  if (IsRecording()) {
+    fLibrary.SetBinning(ParseEdges(fEnergyBins, GeV), ParseEdges(fAngleBins, 1.));
+    fRecorded.SetBinning(fLibrary.GetEnergyEdges(), fLibrary.GetCosEdges());
+    G4cout << "KLShowerModel: starting a new K_L shower library " << fLibraryFile << G4endl;
+    return true;
+  }
+  G4ExceptionDescription msg;
+  msg << "Cannot read K_L shower library " << fLibraryFile << "; K_L are fully simulated.";
+  G4Exception("KLShowerModel::PrepareLibrary", "KLShower001", JustWarning, msg);
+  return false;
+}
+
+G4bool KLShowerModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+  if (!IsRecording() && !IsSampling()) return false;
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  if (track->GetKineticEnergy() < fMinEnergy) return false;
+  if (!fGeometryCached || fCachedFullSimLayers != fFullSimLayers) CacheGeometry();
+
+  const G4ThreeVector pos = fastTrack.GetPrimaryTrackLocalPosition();
+  if (pos.x() < fFullSimBoundary) return false;
+  const G4int stack = EntryStack(pos.x());
+  if (stack < 0 || !PrepareLibrary()) return false;
+  const G4int bin = fLibrary.FindBin(track->GetKineticEnergy(), fastTrack.GetPrimaryTrackLocalDirection().x());
+
+  if (IsRecording()) {
+    // Remember where the first primary K_L of the event enters; full simulation carries on
+    const G4Event* event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
+    if (track->GetParentID() != 0 || !event || event->GetEventID() == fRecordEventID) return false;
+    fRecordEventID = event->GetEventID();
+    fRecordSector = fastTrack.GetEnvelopePhysicalVolume()->GetCopyNo();
+    fRecordStack = stack;
+    fRecordBin = bin;
+    fRecordEnergy = track->GetKineticEnergy();
+    fRecordTime = track->GetGlobalTime();
+    fRecordEntry = pos;
+    fRecordToLocal = *fastTrack.GetAffineTransformation();
+    return false;
+  }
+  return fLibrary.GetNumberOfTemplates(bin) > 0;
+}
+
+void KLShowerModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  const G4double kinE = track->GetKineticEnergy();
+  const G4ThreeVector entry = fastTrack.GetPrimaryTrackLocalPosition();
+  const G4int sector = fastTrack.GetEnvelopePhysicalVolume()->GetCopyNo();
+  const G4int entryStack = EntryStack(entry.x());
+  const G4AffineTransform* toGlobal = fastTrack.GetInverseAffineTransformation();
+  const KLShowerLibrary::Template* shower =
+      fLibrary.Sample(fLibrary.FindBin(kinE, fastTrack.GetPrimaryTrackLocalDirection().x()));
+
+  if (shower && fMylarSD) {
+    // Deposits scale with energy within the bin
+    const G4double scale = shower->energy > 0. ? kinE / (shower->energy * MeV) : 1.;
+    for (const KLShowerLibrary::Hit& hit : shower->hits) {
+      auto radius = fGasRadius.find(std::make_pair(entryStack + hit.dStack, G4int(hit.subLayerID)));
+      if (radius == fGasRadius.end()) continue; // beyond the last stack
+      G4ThreeVector local(radius->second, entry.y() + hit.dy * mm, entry.z() + hit.dz * mm);
+      fMylarSD->AddHit(sector, radius->first.first, hit.subLayerID, local, toGlobal->TransformPoint(local),
+                       hit.edep * MeV * scale, track->GetGlobalTime() + hit.dt * ns, track);
+    }
+  }
+  fSampledShowers++;
+
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.);
+  fastStep.ProposeTotalEnergyDeposited(kinE);
+}
+
+void KLShowerModel::EndOfEvent(G4int eventID, const MylarHitsCollection* hits)
+{
+  if (!IsRecording() || !hits || eventID != fRecordEventID || fRecordBin < 0) return;
+
+  KLShowerLibrary::Template shower;
+  shower.energy = static_cast<float>(fRecordEnergy / MeV);
+  for (std::size_t i = 0; i < hits->entries(); ++i) {
+    const MylarHit* hit = (*hits)[i];
+    if (hit->GetSectorNumber() != fRecordSector || hit->GetStackNumber() < fRecordStack) continue;
+    auto id = fGasSublayerIDs.find(hit->GetMylarLayerType());
+    if (id == fGasSublayerIDs.end()) continue;
+    G4ThreeVector local = fRecordToLocal.TransformPoint(hit->GetPosition());
+    KLShowerLibrary::Hit entry;
+    entry.dStack = hit->GetStackNumber() - fRecordStack;
+    entry.subLayerID = id->second;
+    entry.dy = static_cast<float>((local.y() - fRecordEntry.y()) / mm);
+    entry.dz = static_cast<float>((local.z() - fRecordEntry.z()) / mm);
+    entry.edep = static_cast<float>(hit->GetEnergyDeposited() / MeV);
+    entry.dt = static_cast<float>((hit->GetGlobalTime() - fRecordTime) / ns);
+    shower.hits.push_back(entry);
+  }
+  fLibrary.AddTemplate(fRecordBin, shower);
+  fRecorded.AddTemplate(fRecordBin, shower);
+  fLibraryModified = true;
+  fRecordedShowers++;
+}
+
+void KLShowerModel::EndOfRun()
+{
+  if (fSampledShowers > 0) {
+    G4cout << "KLShowerModel: " << fSampledShowers << " K_L showers sampled from the library." << G4endl;
+  }
+  if (IsRecording() && fLibraryModified) {
+    // Only this run's templates are added to the file, which other processes may be recording into
+    G4bool written = false;
+    if (!fRecordOutput.empty()) {
+      written = fRecorded.Write(fRecordOutput);
+      if (written) {
+        G4cout << "KLShowerModel: recorded " << fRecordedShowers << " K_L showers into " << fRecordOutput << G4endl;
+      }
+    } else {
+      written = KLShowerLibrary::AppendToFile(fLibraryFile, {&fRecorded}, &fLibrary);
+      if (written) {
+        G4cout << "KLShowerModel: recorded " << fRecordedShowers << " K_L showers, library "
+               << fLibraryFile << " now holds " << fLibrary.GetTotalNumberOfTemplates() << " templates." << G4endl;
+      }
+    }
+    if (written) {
+      fRecorded.SetBinning(fLibrary.GetEnergyEdges(), fLibrary.GetCosEdges());
+      fLibraryModified = false;
+    }
+  }
+  fSampledShowers = 0;
+  fRecordedShowers = 0;
+}
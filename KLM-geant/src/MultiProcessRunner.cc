@@ -0,0 +1,207 @@
+#include "MultiProcessRunner.hh"
+#include "ActionInitialization.hh"
+#include "InputGeneratorAction.hh"
+#include "RunAction.hh"
+#include "SimulationServer.hh"
+#include "EventSeeder.hh"
+#include "KLShowerModel.hh"
+#include "KLShowerLibrary.hh"
+#include "ForkWorker.hh"
+
+#include "G4RunManager.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+MultiProcessRunner::MultiProcessRunner(G4RunManager* runManager,
+                                       const G4String& inputFileName)
+ : fRunManager(runManager),
+   fInputFileName(inputFileName)
+{
+  // Merged output goes where a single-process run would write
+  const RunAction* runAction = dynamic_cast<const RunAction*>(fRunManager->GetUserRunAction());
+  fOutputFileName = runAction ? runAction->GetOutputFileName() : G4String("summarized_cell_energy.txt");
+}
+
+MultiProcessRunner::~MultiProcessRunner()
+{}
+
+std::string MultiProcessRunner::PartName(G4int iWorker) const
+{
+  return fOutputFileName + ".part" + std::to_string(iWorker);
+}
+
+// One pass over the input (up to maxEvents, < 0: all) with a throw-away generator.
+// For files, offsets[i] is the byte offset of input event i, so that workers
+// seek to their first event instead of reading the input up to it.
+G4int MultiProcessRunner::CountInputEvents(G4int maxEvents, std::vector<G4long>& offsets) const
+{
+  InputGeneratorAction* generator = ActionInitialization::CreateGenerator(fInputFileName);
+  const G4int limit = maxEvents < 0 ? std::numeric_limits<G4int>::max() : maxEvents;
+  G4int nEvents = 0;
+  offsets.clear();
+  if (generator->GetInputOffset() < 0) {
+    nEvents = generator->SkipEvents(limit);
+  } else {
+    while (nEvents < limit) {
+      const G4long offset = generator->GetInputOffset();
+      if (generator->SkipEvents(1) < 1) break;
+      offsets.push_back(offset);
+      ++nEvents;
+    }
+  }
+  delete generator;
+  return nEvents;
+}
+
+G4int MultiProcessRunner::Run(G4int nWorkers, G4int maxEvents)
+{
+  auto wallStart = std::chrono::steady_clock::now();
+
+  std::vector<G4long> offsets;
+  G4int nEvents = CountInputEvents(maxEvents, offsets);
+  if (nEvents == std::numeric_limits<G4int>::max() && maxEvents < 0) {
+    G4cerr << "MultiProcessRunner: " << fInputFileName << " has no end; give --events or /klm/gun/events." << G4endl;
+    return 1;
+  }
+  if (nEvents <= 0) {
+    G4cerr << "MultiProcessRunner: no events to simulate in " << fInputFileName << G4endl;
+    return 1;
+  }
+  nWorkers = std::max(1, std::min(nWorkers, nEvents));
+  G4cout << "MultiProcessRunner: " << nEvents << " events from " << fInputFileName
+         << " on " << nWorkers << " worker processes." << G4endl;
+
+  // Build the physics tables before forking so all workers share them
+  fRunManager->BeamOn(0);
+  // Per-event seeding makes the output independent of the number of workers;
+  // without it each worker gets its own engine stream
+  EventSeeder* seeder = EventSeeder::Instance();
+  const long engineSeed = G4Random::getTheSeed();
+
+  // --- Fork workers over contiguous event ranges ---
+  std::vector<pid_t> pids;
+  G4int first = 0;
+  for (G4int iWorker = 0; iWorker < nWorkers; ++iWorker) {
+    G4int count = nEvents / nWorkers + (iWorker < nEvents % nWorkers ? 1 : 0);
+    std::ostringstream job;
+    job << "input=" << fInputFileName << " output=" << PartName(iWorker)
+        << " first=" << first << " count=" << count << " id=worker" << iWorker
+        << " seed=" << (seeder->IsPerEvent() ? seeder->GetRunSeed() : engineSeed + iWorker);
+    if (first > 0 && first < (G4int)offsets.size()) job << " offset=" << offsets[first];
+    first += count;
+
+    // Worker: per-event printout goes to its own log, not the shared terminal
+    const std::string log = fOutputFileName + ".worker" + std::to_string(iWorker) + ".log";
+    pid_t pid = ForkWorker::Start([&]() {
+      // Recorded K_L showers go to a part file as well; the parent appends them in worker order
+      KLShowerModel* klShowerModel = KLShowerModel::Find();
+      if (klShowerModel && klShowerModel->IsRecording()) klShowerModel->SetRecordOutput(PartName(iWorker) + ".klshowers");
+      SimulationServer worker(fRunManager);
+      return worker.RunJob(job.str()).compare(0, 2, "OK") == 0;
+    }, log);
+    if (pid < 0) {
+      G4cerr << "MultiProcessRunner: fork failed for worker " << iWorker << G4endl;
+      break;
+    }
+    pids.push_back(pid);
+  }
+
+  // --- Collect workers ---
+  G4bool allOk = (G4int)pids.size() == nWorkers;
+  for (std::size_t i = 0; i < pids.size(); ++i) {
+    if (!ForkWorker::Wait(pids[i])) {
+      G4cerr << "MultiProcessRunner: worker " << i << " failed, see "
+             << fOutputFileName << ".worker" << i << ".log" << G4endl;
+      allOk = false;
+    }
+  }
+  if (!allOk || !MergeParts(nWorkers) || !MergeShowerLibraryParts(nWorkers)) return 1;
+
+  // --- Summary from the per-worker timing lines ---
+  G4double wall = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - wallStart).count();
+  G4cout << "MultiProcessRunner: merged " << nWorkers << " parts into " << fOutputFileName << G4endl;
+  for (G4int iWorker = 0; iWorker < nWorkers; ++iWorker) {
+    std::ifstream timing(PartName(iWorker) + ".timing");
+    std::string line;
+    if (std::getline(timing, line)) G4cout << "  " << line << G4endl;
+    std::remove((PartName(iWorker) + ".timing").c_str());
+  }
+  G4cout << "MultiProcessRunner: " << nEvents << " events in " << wall << " s wall ("
+         << (wall > 0. ? nEvents / wall : 0.) << " events/s)." << G4endl;
+  return 0;
+}
+
+// The cell output, then each side output the workers wrote next to their parts
+G4bool MultiProcessRunner::MergeParts(G4int nParts) const
+{
+  if (!MergePartFiles(nParts, "")) return false;
+  for (const char* suffix : {".digits", ".clusters"}) {
+    if (std::ifstream(PartName(0) + suffix) && !MergePartFiles(nParts, suffix)) return false;
+  }
+  return true;
+}
+
+// Parts hold consecutive input ranges, so concatenation keeps event order.
+// Only the header of the first part is kept; per-event comment lines are kept from every part.
+G4bool MultiProcessRunner::MergePartFiles(G4int nParts, const std::string& suffix) const
+{
+  const std::string outName = fOutputFileName + suffix;
+  std::ofstream out(outName, std::ios::out | std::ios::trunc);
+  if (!out) {
+    G4cerr << "MultiProcessRunner: cannot write " << outName << G4endl;
+    return false;
+  }
+  for (G4int iPart = 0; iPart < nParts; ++iPart) {
+    std::ifstream in(PartName(iPart) + suffix);
+    if (!in) {
+      G4cerr << "MultiProcessRunner: missing part " << PartName(iPart) + suffix << G4endl;
+      return false;
+    }
+    std::string line;
+    G4bool header = true;
+    while (std::getline(in, line)) {
+      // Per-event comments (seed records, "# watchdog event ...") are data, not header
+      if (header && !line.empty() && line[0] == '#' && line.compare(0, 8, "# event ") != 0 &&
+          line.compare(0, 11, "# watchdog ") != 0 && line.compare(0, 11, "# filtered ") != 0) {
+        if (iPart == 0) out << line << "\n";
+        continue;
+      }
+      header = false;
+      out << line << "\n";
+    }
+  }
+  out.close();
+  if (!out) return false;
+  for (G4int iPart = 0; iPart < nParts; ++iPart) std::remove((PartName(iPart) + suffix).c_str());
+  return true;
+}
+
+// Record mode: the templates of each worker, in worker order, are appended to the library
+G4bool MultiProcessRunner::MergeShowerLibraryParts(G4int nParts) const
+{
+  KLShowerModel* klShowerModel = KLShowerModel::Find();
+  if (!klShowerModel || !klShowerModel->IsRecording()) return true;
+  std::vector<KLShowerLibrary> parts(nParts);
+  std::vector<const KLShowerLibrary*> additions;
+  for (G4int iPart = 0; iPart < nParts; ++iPart) {
+    const std::string partName = PartName(iPart) + ".klshowers";
+    if (!std::ifstream(partName)) continue; // the worker recorded no shower
+    if (!parts[iPart].Read(partName)) return false;
+    additions.push_back(&parts[iPart]);
+  }
+  if (!additions.empty() && !KLShowerLibrary::AppendToFile(klShowerModel->GetLibraryFile(), additions)) {
+    G4cerr << "MultiProcessRunner: cannot add the recorded K_L showers to " << klShowerModel->GetLibraryFile() << G4endl;
+    return false;
+  }
+  for (G4int iPart = 0; iPart < nParts; ++iPart) std::remove((PartName(iPart) + ".klshowers").c_str());
+  return true;
+}
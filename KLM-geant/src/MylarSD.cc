@@ -13,19 +13,32 @@
 #include "G4AffineTransform.hh" // For coordinate transformations
 #include "G4VSolid.hh"          // To get solid extents (though less useful for Polyhedra cells)
 #include "G4Polyhedra.hh"       // If needed to inspect Polyhedra solid
+#include "G4GenericMessenger.hh"
 
 MylarSD::MylarSD(const G4String& name,
                  const G4String& hitsCollectionName,
                  DetectorConstruction* detConstruction)
  : G4VSensitiveDetector(name),
    fHitsCollection(nullptr),
-   fDetConstruction(detConstruction) // Store pointer to detector construction
+   fDetConstruction(detConstruction), // Store pointer to detector construction
+   fMessenger(nullptr),
+   fReadoutWindowMin(-DBL_MAX),
+   fReadoutWindowMax(DBL_MAX),
+   fHitsOutsideWindow(0)
 {
   collectionName.insert(hitsCollectionName); // Register the hits collection name
+
+  fMessenger = new G4GenericMessenger(this, "/klm/sd/", "KLM sensitive detector");
+  fMessenger->DeclarePropertyWithUnit("readoutWindowMin", "ns", fReadoutWindowMin,
+      "Drop hits with global time below this value.");
+  fMessenger->DeclarePropertyWithUnit("readoutWindowMax", "ns", fReadoutWindowMax,
+      "Drop hits with global time above this value.");
 }
 
 MylarSD::~MylarSD()
-{}
+{
+  delete fMessenger;
+}
 
 // Called at the beginning of each event
 void MylarSD::Initialize(G4HCofThisEvent* hce)
@@ -41,6 +54,72 @@ void MylarSD::Initialize(G4HCofThisEvent* hce)
   // G4cout << "MylarSD: Initialized hits collection '" << collectionName[0] << "' with ID " << hcID << G4endl;
 }
 
+// Infer Mylar type from volume name (crude example, make more robust)
+// This relies on the logical volume name set in DetectorConstruction
+G4String MylarSD::LayerTypeOf(const G4String& volumeName)
+{
+  if (volumeName.contains("OuterGPMylar")) return "OuterGP";
+  if (volumeName.contains("OuterCPMylar")) return "OuterCP";
+  if (volumeName.contains("InsulatorMylar")) return "Insulator";
+  if (volumeName.contains("InnerCPMylar")) return "InnerCP";
+  if (volumeName.contains("InnerGPMylar")) return "InnerGP";
+  if (volumeName.contains("InnerGassecond")) return "InnerGassecond";
+  if (volumeName.contains("InnerGas")) return "InnerGas";
+  if (volumeName.contains("OuterGassecond")) return "OuterGassecond";
+  if (volumeName.contains("OuterGas")) return "OuterGas";
+  return "UnknownMylar";
+}
+
+// Z/phi grid cell of a point in the sector-local frame; -1 if outside the grid
+void MylarSD::ComputeCells(const G4ThreeVector& localPos, G4int stackNumber,
+                           G4int& zCell, G4int& phiCell) const
+{
+  // Get dimensions from DetectorConstruction
+  G4double klmHalfZ = fDetConstruction->GetKLMHalfLength();
+  // G4double sectorAngleRad = fDetConstruction->GetKLMSectorAngle(); // Already in radians
+  G4int numPhiCells = fDetConstruction->GetNumPhiCells06();
+  if (stackNumber > 6) numPhiCells = fDetConstruction->GetNumPhiCells714(); // Should be 48
+  G4int numZCells = fDetConstruction->GetNumZCells();     // Should be 96
+
+  CellsOf(localPos, klmHalfZ, fDetConstruction->GetKLMSectorAngle(), numZCells, numPhiCells, zCell, phiCell);
+}
+
+// Z/phi cell arithmetic: local Z and phi of the sector frame mapped onto the grid
+void MylarSD::CellsOf(const G4ThreeVector& localPos, G4double klmHalfZ, G4double sectorAngle,
+                      G4int numZCells, G4int numPhiCells, G4int& zCell, G4int& phiCell)
+{
+  // Z-Cell Calculation: local Z ranges from -klmHalfZ to +klmHalfZ
+  G4double localZ = localPos.z();
+  zCell = -1; // Default to invalid
+  if (localZ >= -klmHalfZ && localZ < klmHalfZ) { // Use < for upper bound to align with 0-N-1 indexing
+      zCell = static_cast<G4int>(((localZ + klmHalfZ) / (2. * klmHalfZ)) * numZCells);
+      // Clamp to valid range [0, numZCells-1]
+      if (zCell >= numZCells) zCell = numZCells - 1;
+      if (zCell < 0) zCell = 0; // Should not happen if localZ is in range
+  }
+
+  // Phi-Cell Calculation:
+  G4double localPhi = localPos.phi(); // range: -pi to +pi relative to local X of the segment
+  G4double segmentDeltaPhi = sectorAngle; // e.g., 45 deg
+  G4double segmentStartPhi = -segmentDeltaPhi / 2.0; // Sector is centered around its local X-axis
+
+  // Normalize phi within the segment [segmentStartPhi, segmentStartPhi + segmentDeltaPhi]
+  // to [0, segmentDeltaPhi] then to [0, 1]
+  G4double phiRelativeToSegmentStart = localPhi - segmentStartPhi;
+  // Handle wraparound if localPhi is just outside segmentStartPhi (e.g. -22.6 deg for a -22.5 start)
+  // or just above segmentStartPhi + segmentDeltaPhi
+  while (phiRelativeToSegmentStart < 0) phiRelativeToSegmentStart += CLHEP::twopi; // Ensure positive
+  while (phiRelativeToSegmentStart >= segmentDeltaPhi + 1e-9) phiRelativeToSegmentStart -= segmentDeltaPhi; // Normalize within one segment width (approx)
+
+  phiCell = -1; // Default to invalid
+  if (phiRelativeToSegmentStart >= -1e-9 && phiRelativeToSegmentStart <= segmentDeltaPhi + 1e-9) { // Check within segment bounds (with tolerance)
+      phiCell = static_cast<G4int>((phiRelativeToSegmentStart / segmentDeltaPhi) * numPhiCells);
+       // Clamp to valid range [0, numPhiCells-1]
+      if (phiCell >= numPhiCells) phiCell = numPhiCells - 1;
+      if (phiCell < 0) phiCell = 0;
+  }
+}
+
 // This method is called by Geant4 for every step in a volume
 // associated with this sensitive detector
 G4bool MylarSD::ProcessHits(G4Step* aStep, G4TouchableHistory* /*ROhist*/)
@@ -49,8 +128,20 @@ G4bool MylarSD::ProcessHits(G4Step* aStep, G4TouchableHistory* /*ROhist*/)
   G4double edep = aStep->GetTotalEnergyDeposit();
   if (edep == 0.) return false; // No energy deposited, no hit (or only if particle passes through)
 
-  // Create a new hit
-  MylarHit* newHit = new MylarHit();
+  // --- Locate the step: sector, stack and sublayer (layering-mode independent) ---
+  const G4VTouchable* touchable = aStep->GetPreStepPoint()->GetTouchable();
+  G4int sectorNumber = -1, stackNumber = -1, subLayerID = -1, sectorDepth = 1;
+  fDetConstruction->DecodeTouchable(touchable, sectorNumber, stackNumber, subLayerID, sectorDepth);
+  // With a shared (parameterised) sublayer LV every sublayer is sensitive: keep the gas gaps only,
+  // before the window check so its statistics are the same in both layering modes
+  if (!fDetConstruction->IsGasSublayer(subLayerID)) return false;
+
+  // Outside the RPC readout window: the hit would never be read out
+  G4double hitTime = aStep->GetPostStepPoint()->GetGlobalTime();
+  if (hitTime < fReadoutWindowMin || hitTime > fReadoutWindowMax) {
+    fHitsOutsideWindow++;
+    return false;
+  }
 
   // --- Get common particle and step information ---
   G4Track* track = aStep->GetTrack();
@@ -59,19 +150,8 @@ G4bool MylarSD::ProcessHits(G4Step* aStep, G4TouchableHistory* /*ROhist*/)
     return false; // Not a charged particle, do not record a hit
   }
 
-  // G4double v = track->GetVelocity();
-  // G4double KE = track->GetKineticEnergy();
-  // G4ThreeVector mom_direction = track->GetMomentumDirection();
-  G4ThreeVector mom = track->GetMomentum();
-  G4double totalMomentum = mom.mag();
-
-  G4double mass = track->GetParticleDefinition()->GetPDGMass();
-
-
-  if(abs(track->GetParticleDefinition()->GetPDGEncoding()) == 11 and track->GetTrackID() ==1)
-  {G4cout << "track ID: " << track->GetTrackID() << " parent ID: " << track->GetParentID() << " PDG ID: " << track->GetParticleDefinition()->GetPDGEncoding() << " Mass: " << mass << " Momentum: " << totalMomentum << G4endl;
-  G4cout << "----------------------------------------------------------------------------------------------" << G4endl;
-  }
+  // Create a new hit
+  MylarHit* newHit = new MylarHit();
 
   newHit->SetTrackID(track->GetTrackID());
   newHit->SetParentID(track->GetParentID());
@@ -79,97 +159,44 @@ G4bool MylarSD::ProcessHits(G4Step* aStep, G4TouchableHistory* /*ROhist*/)
   newHit->SetParticleName(track->GetParticleDefinition()->GetParticleName());
   // newHit->SetParticleName(track->GetParticleDefinition()->GetPDGMass());
   newHit->SetEnergyDeposited(edep);
-  newHit->SetGlobalTime(aStep->GetPostStepPoint()->GetGlobalTime());
+  newHit->SetGlobalTime(hitTime);
   newHit->SetPosition(aStep->GetPostStepPoint()->GetPosition()); // Global position of step end
 
   // --- Get KLM specific information from the volume ---
-  const G4VTouchable* touchable = aStep->GetPreStepPoint()->GetTouchable();
   G4VPhysicalVolume* pv = touchable->GetVolume();
-  G4String volumeName = pv->GetLogicalVolume()->GetName();
+  // The shared LV name carries no layer information: rebuild the placement-mode name
+  G4String volumeName = fDetConstruction->IsParameterisedLayering()
+      ? G4String(fDetConstruction->GetSublayerName(subLayerID) + "_S" + std::to_string(stackNumber) + "_Log")
+      : pv->GetLogicalVolume()->GetName();
   newHit->SetVolumeName(volumeName);
 
   // Determine Sector, Stack, and Mylar Type from Physical Volume's copy numbers or name parsing
   // This depends on how PVs are named and copy numbers are assigned in DetectorConstruction
-  G4int sectorNumber = touchable->GetCopyNumber(1); // Assuming Sector is at depth 1 (KLMSectorPV_X)
+  // Sector is the copy number of KLMSectorPV_X (depth 1, or 2 with parameterised layering)
   newHit->SetSectorNumber(sectorNumber);
 
   // For Stack and Mylar Type, more complex parsing of pvName or deeper touchable info needed
   // Example: if PV name is "OuterGPMylar_S<stackID>_PV_Sector<sectorID>"
   // Or rely on the copy number set for the sublayer PV in DetectorConstruction
-  G4int sublayerCopyNo = touchable->GetCopyNumber(0); // Copy number of the Mylar sublayer PV itself
-  G4int stackNumber = sublayerCopyNo / 100; // As per iStack * 100 + subLayerID
+  // (DecodeTouchable: iStack * 100 + subLayerID copy numbers, or the stack envelope copy number)
 
   // G4int subLayerID_inStack = sublayerCopyNo % 100; // Could be used to identify specific mylar
   newHit->SetStackNumber(stackNumber);
 
-  // Infer Mylar type from volume name (crude example, make more robust)
-  // This relies on the logical volume name set in DetectorConstruction
-  if (volumeName.contains("OuterGPMylar")) newHit->SetMylarLayerType("OuterGP");
-  else if (volumeName.contains("OuterCPMylar")) newHit->SetMylarLayerType("OuterCP");
-  else if (volumeName.contains("InsulatorMylar")) newHit->SetMylarLayerType("Insulator");
-  else if (volumeName.contains("InnerCPMylar")) newHit->SetMylarLayerType("InnerCP");
-  else if (volumeName.contains("InnerGPMylar")) newHit->SetMylarLayerType("InnerGP");
-  else if (volumeName.contains("InnerGassecond")) newHit->SetMylarLayerType("InnerGassecond");
-  else if (volumeName.contains("InnerGas")) newHit->SetMylarLayerType("InnerGas");
-  else if (volumeName.contains("OuterGassecond")) newHit->SetMylarLayerType("OuterGassecond");
-  else if (volumeName.contains("OuterGas")) newHit->SetMylarLayerType("OuterGas");
-  else newHit->SetMylarLayerType("UnknownMylar");
-
+  newHit->SetMylarLayerType(LayerTypeOf(volumeName));
 
   // --- Calculate Grid Cell IDs (Phi and Z) ---
   // This requires transforming the global hit position to the local coordinate system
   // of the Mylar layer within its specific sector.
-  G4AffineTransform transform = touchable->GetHistory()->GetTopTransform();
+  // Use the sector frame: identical to the sublayer frame in placement mode, while the
+  // parameterised G4Trd sublayers are rotated/translated inside their stack envelope
+  G4AffineTransform transform = touchable->GetHistory()->GetTransform(touchable->GetHistoryDepth() - sectorDepth);
   G4ThreeVector localPos = transform.TransformPoint(newHit->GetPosition());
 
-  // In src/MylarSD.cc - within ProcessHits
-// ... (after getting localPos) ...
-
-  // Get dimensions from DetectorConstruction
-  G4double klmHalfZ = fDetConstruction->GetKLMHalfLength();
-  // G4double sectorAngleRad = fDetConstruction->GetKLMSectorAngle(); // Already in radians
-  G4int numPhiCells = fDetConstruction->GetNumPhiCells06();;
-  if (stackNumber > 6){
-    G4cout << stackNumber << " stack_number " << G4endl;
-    numPhiCells = fDetConstruction->GetNumPhiCells714(); // Should be 48
-  }
-  G4int numZCells = fDetConstruction->GetNumZCells();     // Should be 96
-
-  // Z-Cell Calculation: local Z ranges from -klmHalfZ to +klmHalfZ
-  G4double localZ = localPos.z();
-  G4int zCell = -1; // Default to invalid
-  if (localZ >= -klmHalfZ && localZ < klmHalfZ) { // Use < for upper bound to align with 0-N-1 indexing
-      zCell = static_cast<G4int>(((localZ + klmHalfZ) / (2. * klmHalfZ)) * numZCells);
-      // Clamp to valid range [0, numZCells-1]
-      if (zCell >= numZCells) zCell = numZCells - 1;
-      if (zCell < 0) zCell = 0; // Should not happen if localZ is in range
-  }
+  G4int zCell = -1, phiCell = -1;
+  ComputeCells(localPos, stackNumber, zCell, phiCell);
   newHit->SetZCellID(zCell); // Z goes from 0 to 95
-
-  // Phi-Cell Calculation:
-  G4double localPhi = localPos.phi(); // range: -pi to +pi relative to local X of the segment
-  G4double segmentDeltaPhi = fDetConstruction->GetKLMSectorAngle(); // e.g., 45 deg
-  G4double segmentStartPhi = -segmentDeltaPhi / 2.0; // Sector is centered around its local X-axis
-
-  // Normalize phi within the segment [segmentStartPhi, segmentStartPhi + segmentDeltaPhi]
-  // to [0, segmentDeltaPhi] then to [0, 1]
-  G4double phiRelativeToSegmentStart = localPhi - segmentStartPhi;
-  // Handle wraparound if localPhi is just outside segmentStartPhi (e.g. -22.6 deg for a -22.5 start)
-  // or just above segmentStartPhi + segmentDeltaPhi
-  while (phiRelativeToSegmentStart < 0) phiRelativeToSegmentStart += CLHEP::twopi; // Ensure positive
-  while (phiRelativeToSegmentStart >= segmentDeltaPhi + 1e-9) phiRelativeToSegmentStart -= segmentDeltaPhi; // Normalize within one segment width (approx)
-
-  G4int phiCell = -1; // Default to invalid
-  if (phiRelativeToSegmentStart >= -1e-9 && phiRelativeToSegmentStart <= segmentDeltaPhi + 1e-9) { // Check within segment bounds (with tolerance)
-      phiCell = static_cast<G4int>((phiRelativeToSegmentStart / segmentDeltaPhi) * numPhiCells);
-       // Clamp to valid range [0, numPhiCells-1]
-      if (phiCell >= numPhiCells) phiCell = numPhiCells - 1;
-      if (phiCell < 0) phiCell = 0;
-  }
   newHit->SetPhiCellID(phiCell); // Phi goes from 0 to 35
-  if (phiCell > 35){
-    G4cout << phiCell << "phiCell" << G4endl; 
-  }
 
 // ...
 
@@ -227,4 +254,38 @@ G4bool MylarSD::ProcessHits(G4Step* aStep, G4TouchableHistory* /*ROhist*/)
 }
 
 // void MylarSD::EndOfEvent(G4HCofThisEvent* /*hce*/)
-// {}
\ No newline at end of file
+// {}
+
+// Hit from a parameterised (fast simulation) model, with the same cell assignment as ProcessHits
+G4bool MylarSD::AddHit(G4int sectorNumber, G4int stackNumber, G4int subLayerID,
+                       const G4ThreeVector& localPos, const G4ThreeVector& globalPos,
+                       G4double edep, G4double hitTime, const G4Track* track)
+{
+  if (!fHitsCollection || edep <= 0.) return false;
+  if (hitTime < fReadoutWindowMin || hitTime > fReadoutWindowMax) {
+    fHitsOutsideWindow++;
+    return false;
+  }
+  if (!fDetConstruction->IsGasSublayer(subLayerID)) return false;
+
+  MylarHit* newHit = new MylarHit();
+  newHit->SetTrackID(track->GetTrackID());
+  newHit->SetParentID(track->GetParentID());
+  newHit->SetPDGCode(track->GetParticleDefinition()->GetPDGEncoding());
+  newHit->SetParticleName(track->GetParticleDefinition()->GetParticleName());
+  newHit->SetEnergyDeposited(edep);
+  newHit->SetGlobalTime(hitTime);
+  newHit->SetPosition(globalPos);
+  G4String volumeName = fDetConstruction->GetSublayerName(subLayerID) + "_S" + std::to_string(stackNumber) + "_Log";
+  newHit->SetVolumeName(volumeName);
+  newHit->SetMylarLayerType(LayerTypeOf(volumeName));
+  newHit->SetSectorNumber(sectorNumber);
+  newHit->SetStackNumber(stackNumber);
+
+  G4int zCell = -1, phiCell = -1;
+  ComputeCells(localPos, stackNumber, zCell, phiCell);
+  newHit->SetZCellID(zCell);
+  newHit->SetPhiCellID(phiCell);
+  fHitsCollection->insert(newHit);
+  return true;
+}
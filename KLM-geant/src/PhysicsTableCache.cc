@@ -0,0 +1,145 @@
+#include "PhysicsTableCache.hh"
+
+#include "G4VUserPhysicsList.hh"
+#include "G4StateManager.hh"
+#include "G4Material.hh"
+#include "G4Element.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4Version.hh"
+#include "G4ios.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+PhysicsTableCache::PhysicsTableCache(G4VUserPhysicsList* physicsList,
+                                     const G4String& physicsListName,
+                                     const G4String& cacheRoot)
+ : G4VStateDependent(),
+   fPhysicsList(physicsList),
+   fPhysicsListName(physicsListName),
+   fCacheRoot(cacheRoot),
+   fPrepared(false),
+   fRetrieved(false),
+   fDone(false)
+{
+  G4cout << "PhysicsTableCache: using cache directory " << fCacheRoot << G4endl;
+}
+
+PhysicsTableCache::~PhysicsTableCache()
+{}
+
+// Everything the tables depend on, in a stable textual form
+std::string PhysicsTableCache::BuildKeyText() const
+{
+  std::ostringstream key;
+  key << std::setprecision(17);
+  key << "geant4 " << G4Version << "\n";
+  key << "physicslist " << fPhysicsListName << "\n";
+  key << "defaultcut " << fPhysicsList->GetDefaultCutValue() << "\n";
+
+  for (const G4Region* region : *G4RegionStore::GetInstance()) {
+    key << "region " << region->GetName();
+    const G4ProductionCuts* cuts = region->GetProductionCuts();
+    if (cuts) {
+      for (G4int i = 0; i < 4; ++i) key << " " << cuts->GetProductionCut(i);
+    }
+    key << "\n";
+  }
+
+  for (const G4Material* material : *G4Material::GetMaterialTable()) {
+    key << "material " << material->GetName() << " " << material->GetDensity()
+        << " " << material->GetState() << " " << material->GetTemperature()
+        << " " << material->GetPressure();
+    const G4double* fractions = material->GetFractionVector();
+    for (std::size_t i = 0; i < material->GetNumberOfElements(); ++i) {
+      key << " " << material->GetElement(i)->GetName() << ":" << fractions[i];
+    }
+    key << "\n";
+  }
+  return key.str();
+}
+
+std::string PhysicsTableCache::HashText(const std::string& text)
+{
+  std::uint64_t hash = 14695981039346656037ULL; // FNV-1a
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  std::ostringstream os;
+  os << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return os.str();
+}
+
+void PhysicsTableCache::PrepareRetrieval()
+{
+  fPrepared = true;
+  fKeyText = BuildKeyText();
+  fCacheDir = fCacheRoot + "/" + HashText(fKeyText);
+
+  std::ifstream keyFile(fCacheDir + "/cache_key.txt");
+  if (!keyFile) {
+    G4cout << "PhysicsTableCache: no cache for this configuration yet (" << fCacheDir
+           << "), tables will be built and stored." << G4endl;
+    return;
+  }
+  std::stringstream stored;
+  stored << keyFile.rdbuf();
+  if (stored.str() != fKeyText) {
+    G4cout << "PhysicsTableCache: cache key mismatch in " << fCacheDir
+           << " (stale or hash collision), rebuilding tables." << G4endl;
+    return;
+  }
+  G4cout << "PhysicsTableCache: retrieving physics tables from " << fCacheDir << G4endl;
+  fPhysicsList->SetPhysicsTableRetrieved(fCacheDir);
+  fRetrieved = true;
+}
+
+void PhysicsTableCache::Store()
+{
+  std::error_code error;
+  std::filesystem::create_directories(fCacheDir, error);
+  if (error) {
+    G4cerr << "PhysicsTableCache: cannot create " << fCacheDir << ": " << error.message() << G4endl;
+    return;
+  }
+  if (!fPhysicsList->StorePhysicsTable(fCacheDir)) {
+    G4cerr << "PhysicsTableCache: storing physics tables in " << fCacheDir << " failed." << G4endl;
+    return;
+  }
+  // The key is written last and atomically: only a complete store is ever valid
+  const std::string tmpName = fCacheDir + "/cache_key.txt.tmp";
+  {
+    std::ofstream keyFile(tmpName);
+    keyFile << fKeyText;
+    if (!keyFile) {
+      G4cerr << "PhysicsTableCache: cannot write " << tmpName << G4endl;
+      return;
+    }
+  }
+  if (std::rename(tmpName.c_str(), (fCacheDir + "/cache_key.txt").c_str()) != 0) {
+    G4cerr << "PhysicsTableCache: cannot finalise cache key in " << fCacheDir << G4endl;
+    return;
+  }
+  G4cout << "PhysicsTableCache: physics tables stored in " << fCacheDir << G4endl;
+}
+
+G4bool PhysicsTableCache::Notify(G4ApplicationState requestedState)
+{
+  if (fDone) return true;
+  G4ApplicationState currentState = G4StateManager::GetStateManager()->GetCurrentState();
+
+  if (currentState == G4State_Idle && requestedState == G4State_Init && !fPrepared) {
+    PrepareRetrieval();
+  } else if (currentState == G4State_Init && requestedState == G4State_Idle && fPrepared) {
+    if (!fRetrieved) Store();
+    fDone = true;
+  }
+  return true;
+}
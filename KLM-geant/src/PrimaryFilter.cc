@@ -0,0 +1,169 @@
+#include "PrimaryFilter.hh"
+#include "DetectorConstruction.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+PrimaryFilter* PrimaryFilter::fInstance = nullptr;
+
+PrimaryFilter* PrimaryFilter::Instance()
+{
+  if (!fInstance) fInstance = new PrimaryFilter();
+  return fInstance;
+}
+
+PrimaryFilter::PrimaryFilter()
+ : fMessenger(nullptr),
+   fEnabled(false),
+   fMinMomentumCharged(0.),
+   fMinMomentumNeutral(0.),
+   fAcceptanceMargin(10. * cm),
+   fVetoedPDGCodes({12, 14, 16}),
+   fGeometryCached(false),
+   fInnerRadius(0.),
+   fHalfLength(0.),
+   fNumSectors(0),
+   fEventPrimaries(0),
+   fEventKept(0)
+{
+  ResetStatistics();
+  fMessenger = new G4GenericMessenger(this, "/klm/filter/", "Pre-filter of input primaries");
+  fMessenger->DeclareProperty("enable", fEnabled, "Drop primaries (and empty events) that cannot reach the barrel.");
+  fMessenger->DeclarePropertyWithUnit("minMomentumCharged", "GeV", fMinMomentumCharged,
+      "Momentum threshold of charged primaries.");
+  fMessenger->DeclarePropertyWithUnit("minMomentumNeutral", "GeV", fMinMomentumNeutral,
+      "Momentum threshold of neutral primaries.");
+  fMessenger->DeclarePropertyWithUnit("acceptanceMargin", "cm", fAcceptanceMargin,
+      "Allowed |z| beyond the barrel half length where the line leaves the inner polyhedron.");
+  fMessenger->DeclareMethod("vetoPDG", &PrimaryFilter::SetVetoedPDGCodes,
+      "Space-separated |PDG codes| always dropped (default: '12 14 16', the neutrinos).");
+}
+
+PrimaryFilter::~PrimaryFilter()
+{
+  delete fMessenger;
+}
+
+const char* PrimaryFilter::GetReasonName(RejectReason reason)
+{
+  switch (reason) {
+    case kVetoedType:        return "VetoedType";
+    case kBelowMomentum:     return "BelowMomentum";
+    case kOutsideAcceptance: return "OutsideAcceptance";
+    default:                 return "Unknown";
+  }
+}
+
+void PrimaryFilter::SetVetoedPDGCodes(const G4String& codes)
+{
+  fVetoedPDGCodes.clear();
+  std::istringstream tokens(codes);
+  G4int code;
+  while (tokens >> code) fVetoedPDGCodes.insert(std::abs(code));
+}
+
+void PrimaryFilter::CacheGeometry()
+{
+  const DetectorConstruction* detector = dynamic_cast<const DetectorConstruction*>(
+      G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (!detector) return;
+  fInnerRadius = detector->GetKLMInnerRadius();
+  fHalfLength = detector->GetKLMHalfLength();
+  fNumSectors = detector->GetNumSectors();
+  fGeometryCached = true;
+}
+
+// The inner polyhedron has faces n_k.x = R_in with n_k at phi = k * sectorAngle
+G4bool PrimaryFilter::InAcceptance(const G4ThreeVector& momentum, const G4ThreeVector& vertex)
+{
+  if (!fGeometryCached) CacheGeometry();
+  if (!fGeometryCached || fNumSectors <= 0) return true;
+  const G4double sectorAngle = CLHEP::twopi / fNumSectors;
+  const G4ThreeVector direction = momentum.unit();
+  G4double exitDistance = std::numeric_limits<G4double>::max();
+  for (G4int k = 0; k < fNumSectors; ++k) {
+    const G4double nx = std::cos(k * sectorAngle), ny = std::sin(k * sectorAngle);
+    const G4double height = nx * vertex.x() + ny * vertex.y();
+    if (height >= fInnerRadius) return true; // vertex already outside the inner surface
+    const G4double speed = nx * direction.x() + ny * direction.y();
+    if (speed > 0.) exitDistance = std::min(exitDistance, (fInnerRadius - height) / speed);
+  }
+  if (exitDistance == std::numeric_limits<G4double>::max()) return false; // along the beam axis
+  return std::abs(vertex.z() + exitDistance * direction.z()) <= fHalfLength + fAcceptanceMargin;
+}
+
+void PrimaryFilter::BeginEvent()
+{
+  fEventPrimaries = 0;
+  fEventKept = 0;
+}
+
+void PrimaryFilter::EndEvent()
+{
+  if (!fEnabled) return;
+  fEventsSeen++;
+  if (LastEventFiltered()) fEventsFiltered++;
+}
+
+G4bool PrimaryFilter::Accept(G4int pdgCode, const G4ThreeVector& momentum, const G4ThreeVector& vertex)
+{
+  fEventPrimaries++;
+  if (!fEnabled) {
+    fEventKept++;
+    return true;
+  }
+  fPrimariesSeen++;
+
+  RejectReason reason = kNumRejectReasons;
+  if (fVetoedPDGCodes.count(std::abs(pdgCode))) {
+    reason = kVetoedType;
+  } else {
+    const G4ParticleDefinition* particle = G4ParticleTable::GetParticleTable()->FindParticle(pdgCode);
+    const G4bool charged = particle && particle->GetPDGCharge() != 0.;
+    if (momentum.mag() < (charged ? fMinMomentumCharged : fMinMomentumNeutral)) {
+      reason = kBelowMomentum;
+    } else if (!InAcceptance(momentum, vertex)) {
+      reason = kOutsideAcceptance;
+    }
+  }
+  if (reason != kNumRejectReasons) {
+    fRejected[reason]++;
+    return false;
+  }
+  fEventKept++;
+  fPrimariesKept++;
+  return true;
+}
+
+void PrimaryFilter::ResetStatistics()
+{
+  fEventsSeen = 0;
+  fEventsFiltered = 0;
+  fPrimariesSeen = 0;
+  fPrimariesKept = 0;
+  fRejected.fill(0);
+  // Geometry may have been rebuilt between runs
+  fGeometryCached = false;
+}
+
+void PrimaryFilter::PrintStatistics() const
+{
+  if (!fEnabled || fEventsSeen == 0) return;
+  G4cout << "\n--- PrimaryFilter ---" << G4endl;
+  G4cout << "  events:    " << fEventsSeen << " generated, " << fEventsFiltered
+         << " without any kept primary (simulated empty)" << G4endl;
+  G4cout << "  primaries: " << fPrimariesSeen << " read, " << fPrimariesKept << " kept" << G4endl;
+  for (G4int i = 0; i < kNumRejectReasons; ++i) {
+    G4cout << "     " << GetReasonName(static_cast<RejectReason>(i)) << " : " << fRejected[i] << G4endl;
+  }
+  G4cout << "---------------------" << G4endl;
+}
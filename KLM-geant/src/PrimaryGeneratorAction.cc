@@ -18,9 +18,11 @@
 
 // Constructor (Only for custom file)
 PrimaryGeneratorAction::PrimaryGeneratorAction(const G4String& filename)
- : G4VUserPrimaryGeneratorAction(),
+ : InputGeneratorAction(),
    fCustomFileEOF(false),
-   fCustomFileFirstCall(true)
+   fCustomFileFirstCall(true),
+   fCustomReadOffset(0),
+   fNextCustomLineOffset(0)
    // All HepMC members removed
 {
     // This constructor is now ONLY called for custom format files
@@ -42,6 +44,24 @@ PrimaryGeneratorAction::~PrimaryGeneratorAction()
     }
 }
 
+// "eventID pdgID px py pz E x y z t motherPID [daughters...]"
+G4bool PrimaryGeneratorAction::ParseParticleLine(const std::string& line, ParticleData& data)
+{
+    std::stringstream ss(line);
+    if (!(ss >> data.eventID >> data.pdgID
+             >> data.px >> data.py >> data.pz >> data.E
+             >> data.x >> data.y >> data.z >> data.t
+             >> data.motherPID)) {
+        data.isValid = false;
+        return false;
+    }
+    data.daughtersStr.clear(); // getline leaves it untouched when the line has no daughters
+    std::getline(ss, data.daughtersStr);
+    data.daughtersStr.erase(0, data.daughtersStr.find_first_not_of(" \t"));
+    data.isValid = true;
+    return true;
+}
+
 // Custom File Format Reader (Renamed from ReadNextCustomParticle to keep it unique if it was in header)
 // But since it's private and only one generator uses it now, name ReadNextParticle is fine.
 G4bool PrimaryGeneratorAction::ReadNextCustomParticle() // Or just ReadNextParticle if header only has this one
@@ -51,17 +71,10 @@ G4bool PrimaryGeneratorAction::ReadNextCustomParticle() // Or just ReadNextParti
         return false;
     }
     std::string line;
+    fNextCustomLineOffset = fCustomReadOffset;
     if (std::getline(fCustomParticleFile, line)) {
-        std::stringstream ss(line);
-        if (ss >> fNextCustomParticleData.eventID
-               >> fNextCustomParticleData.pdgID
-               >> fNextCustomParticleData.px >> fNextCustomParticleData.py >> fNextCustomParticleData.pz >> fNextCustomParticleData.E
-               >> fNextCustomParticleData.x >> fNextCustomParticleData.y >> fNextCustomParticleData.z >> fNextCustomParticleData.t
-               >> fNextCustomParticleData.motherPID)
-        {
-             std::getline(ss, fNextCustomParticleData.daughtersStr);
-             fNextCustomParticleData.daughtersStr.erase(0, fNextCustomParticleData.daughtersStr.find_first_not_of(" \t"));
-             fNextCustomParticleData.isValid = true;
+        fCustomReadOffset += line.size() + 1; // counted rather than tellg(), which costs a seek per line
+        if (ParseParticleLine(line, fNextCustomParticleData)) {
              return true;
         } else {
             G4cerr << "Warning [PrimaryGeneratorAction::ReadNextCustomParticle]: Failed to parse line: " << line << G4endl;
@@ -76,16 +89,51 @@ G4bool PrimaryGeneratorAction::ReadNextCustomParticle() // Or just ReadNextParti
     }
 }
 
+// Skips whole file events: all consecutive lines sharing the look-ahead event ID
+G4int PrimaryGeneratorAction::SkipInputEvents(G4int nEvents)
+{
+    if (fCustomFileFirstCall || !fNextCustomParticleData.isValid) {
+        if (!ReadNextCustomParticle()) return 0;
+        fCustomFileFirstCall = false;
+    }
+    G4int skipped = 0;
+    while (skipped < nEvents && fNextCustomParticleData.isValid) {
+        G4int skippedFileEventID = fNextCustomParticleData.eventID;
+        while (ReadNextCustomParticle() && fNextCustomParticleData.eventID == skippedFileEventID) {}
+        skipped++;
+    }
+    return skipped;
+}
+
+// Start of the next file event: the look-ahead line once reading has started
+G4long PrimaryGeneratorAction::GetInputOffset()
+{
+    if (fCustomFileFirstCall || !fNextCustomParticleData.isValid) return fCustomReadOffset;
+    return fNextCustomLineOffset;
+}
+
+G4bool PrimaryGeneratorAction::SeekInput(G4long offset)
+{
+    if (!fCustomParticleFile.is_open()) return false;
+    fCustomParticleFile.clear();
+    fCustomParticleFile.seekg(offset);
+    if (!fCustomParticleFile) return false;
+    fCustomReadOffset = offset;
+    fCustomFileEOF = false;
+    fCustomFileFirstCall = true; // the next call reads the look-ahead line from here
+    fNextCustomParticleData.isValid = false;
+    return true;
+}
 
-// Main GeneratePrimaries method - ONLY for custom file format
-void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
+// Main generation method - ONLY for custom file format (seeded by InputGeneratorAction)
+void PrimaryGeneratorAction::GenerateInputEvent(G4Event* anEvent)
 {
     // This method is now ONLY called if this class was instantiated (i.e., for custom files)
     if (fCustomFileFirstCall || !fNextCustomParticleData.isValid) {
         if (!ReadNextCustomParticle()) {
             G4cout << "[PrimaryGeneratorAction::GeneratePrimaries] "
                    << "Custom file: No more particles. Aborting run." << G4endl;
-            G4RunManager::GetRunManager()->AbortRun(true);
+            EndOfInput();
             anEvent->SetEventAborted();
             return;
         }
@@ -133,6 +181,14 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
         G4double xPos = fNextCustomParticleData.x * mm;
         G4double yPos = fNextCustomParticleData.y * mm;
         G4double zPos = fNextCustomParticleData.z * mm;
+        // Pre-filter (/klm/filter/): drop primaries that cannot reach the barrel
+        if (!AcceptPrimary(fNextCustomParticleData.pdgID,
+                           G4ThreeVector(fNextCustomParticleData.px, fNextCustomParticleData.py,
+                                         fNextCustomParticleData.pz) * GeV,
+                           G4ThreeVector(xPos, yPos, zPos))) {
+            if (!ReadNextCustomParticle()) break;
+            continue;
+        }
         G4double time = fNextCustomParticleData.t * ns;
         G4PrimaryVertex* vertex = new G4PrimaryVertex(xPos, yPos, zPos, time);
 
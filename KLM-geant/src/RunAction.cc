@@ -1,13 +1,42 @@
 #include "RunAction.hh"
+#include "TrackKiller.hh"
+#include "StepProfiler.hh"
+#include "EventTelemetry.hh"
+#include "EventWatchdog.hh"
+#include "RunCheckpoint.hh"
+#include "KLMDigitizer.hh"
+#include "BackgroundOverlay.hh"
+#include "KLMClusterReco.hh"
+#include "PrimaryFilter.hh"
+#include "DetectorConstruction.hh"
+#include "MylarSD.hh"
+#include "KLShowerModel.hh"
+#include "KLMFastSimulationPhysics.hh"
+#include "G4SDManager.hh"
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4ios.hh"
 // #include "G4UnitsTable.hh" // Not strictly needed here anymore
 #include "G4SystemOfUnits.hh"
 
+#include <unistd.h> // truncate
+
 RunAction::RunAction(const G4String& outputFileName)
  : G4UserRunAction(),
-   fOutputFileName(outputFileName)
+   fOutputFileName(outputFileName),
+   fTrackKiller(nullptr),
+   fStepProfiler(nullptr),
+   fEventTelemetry(nullptr),
+   fEventWatchdog(nullptr),
+   fRunCheckpoint(nullptr),
+   fKLMDigitizer(nullptr),
+   fBackgroundOverlay(nullptr),
+   fKLMClusterReco(nullptr),
+   fResumeOutputBytes(-1),
+   fResumeDigitsBytes(-1),
+   fResumeClustersBytes(-1),
+   fLastRunNumberOfEvents(0),
+   fEventIDOffset(0)
 {
   G4cout << "RunAction created. Output file for cell energies: " << fOutputFileName << G4endl;
 }
@@ -17,17 +46,93 @@ RunAction::~RunAction()
   if (fOutputFile.is_open()) {
     fOutputFile.close();
   }
+  delete fTrackKiller;
+  delete fStepProfiler;
+  delete fEventTelemetry;
+  delete fEventWatchdog;
+  delete fRunCheckpoint;
+  delete fKLMDigitizer;
+  delete fBackgroundOverlay;
+  delete fKLMClusterReco;
 }
 
 void RunAction::BeginOfRunAction(const G4Run* aRun)
 {
   G4cout << "### Run " << aRun->GetRunID() << " start." << G4endl;
-  fOutputFile.open(fOutputFileName.c_str(), std::ios::out | std::ios::trunc);
+  // Parameters set between runs only take effect with /klm/geometry/update; the SD, digitizer and
+  // clustering read the live values, so a run on the old volumes would use a different grid
+  const DetectorConstruction* builtDetector = dynamic_cast<const DetectorConstruction*>(
+      G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (builtDetector && builtDetector->HasPendingChanges()) {
+    G4Exception("RunAction::BeginOfRunAction", "KLMGeometry002", FatalException,
+                "/klm/geometry/ parameters changed since the geometry was built; "
+                "apply /klm/geometry/update before /run/beamOn.");
+  }
+  if (fTrackKiller) fTrackKiller->ResetStatistics();
+  if (fStepProfiler) fStepProfiler->ResetStatistics();
+  if (fEventWatchdog) fEventWatchdog->ResetStatistics();
+  PrimaryFilter::Instance()->ResetStatistics();
+  if (fEventTelemetry) fEventTelemetry->BeginOfRun(aRun->GetRunID(), aRun->GetNumberOfEventToBeProcessed());
+  MylarSD* mylarSD = static_cast<MylarSD*>(
+      G4SDManager::GetSDMpointer()->FindSensitiveDetector("KLM/MylarSD", false));
+  if (mylarSD) mylarSD->ResetStatistics();
+  KLMFastSimulationPhysics::CheckModels();
+  if (fRunCheckpoint) {
+    fRunCheckpoint->BeginOfRun(fOutputFileName, aRun->GetNumberOfEventToBeProcessed(), fEventIDOffset);
+  }
+
+  // Strip digitization next to the cell output, with the strip counts of the geometry
+  if (fKLMDigitizer && fKLMDigitizer->IsEnabled()) {
+    const DetectorConstruction* detector = dynamic_cast<const DetectorConstruction*>(
+        G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+    if (detector) {
+      fKLMDigitizer->SetStripCounts(detector->GetNumZCells(), detector->GetNumPhiCells06(),
+                                    detector->GetNumPhiCells714());
+    }
+    // Resumed run: digits of the checkpointed events are kept, like their cells
+    const G4String digitsFileName = fOutputFileName + ".digits";
+    const G4bool resumeDigits = fResumeDigitsBytes >= 0;
+    if (resumeDigits && truncate(digitsFileName.c_str(), fResumeDigitsBytes) != 0) {
+      G4cerr << "ERROR: Could not truncate " << digitsFileName << " to the checkpointed size." << G4endl;
+    }
+    if (fKLMDigitizer->OpenOutput(digitsFileName, resumeDigits) && fRunCheckpoint) {
+      fRunCheckpoint->AddOutput("digits_bytes", &fKLMDigitizer->GetOutputStream());
+    }
+  }
+  fResumeDigitsBytes = -1;
+  if (fKLMClusterReco && fKLMClusterReco->IsEnabled()) {
+    const DetectorConstruction* detector = dynamic_cast<const DetectorConstruction*>(
+        G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+    if (detector) {
+      fKLMClusterReco->SetGeometry(detector->GetKLMHalfLength(), detector->GetKLMSectorAngle(),
+                                   detector->GetNumZCells(), detector->GetNumPhiCells06(),
+                                   detector->GetNumPhiCells714());
+    }
+    // With /klm/reco/writeCells false the clusters are the only event data: keep them like the cells
+    const G4String clustersFileName = fOutputFileName + ".clusters";
+    const G4bool resumeClusters = fResumeClustersBytes >= 0;
+    if (resumeClusters && truncate(clustersFileName.c_str(), fResumeClustersBytes) != 0) {
+      G4cerr << "ERROR: Could not truncate " << clustersFileName << " to the checkpointed size." << G4endl;
+    }
+    if (fKLMClusterReco->OpenOutput(clustersFileName, resumeClusters) && fRunCheckpoint) {
+      fRunCheckpoint->AddOutput("clusters_bytes", &fKLMClusterReco->GetOutputStream());
+    }
+  }
+  fResumeClustersBytes = -1;
+
+  // Resumed run: drop whatever was written after the checkpoint, then append
+  const G4bool resume = fResumeOutputBytes >= 0;
+  if (resume && truncate(fOutputFileName.c_str(), fResumeOutputBytes) != 0) {
+    G4cerr << "ERROR: Could not truncate " << fOutputFileName << " to the checkpointed size." << G4endl;
+  }
+  fResumeOutputBytes = -1;
+  fOutputFile.open(fOutputFileName.c_str(), std::ios::out | (resume ? std::ios::app : std::ios::trunc));
 
   if (fOutputFile.is_open()) {
-    G4cout << "Output file for cell energies opened: " << fOutputFileName << G4endl;
+    G4cout << "Output file for cell energies opened: " << fOutputFileName
+           << (resume ? " (appending after checkpoint)" : "") << G4endl;
     // <<< MODIFIED HEADER >>>
-    fOutputFile << "# EventID Sector Stack ZCell(0-95) PhiCell(0-35) TotalEnergyDep_keV\n";
+    if (!resume) fOutputFile << "# EventID Sector Stack ZCell(0-95) PhiCell(0-35) TotalEnergyDep_keV\n";
   } else {
     G4cerr << "ERROR: Could not open output file for cell energies: " << fOutputFileName << G4endl;
   }
@@ -36,11 +141,30 @@ void RunAction::BeginOfRunAction(const G4Run* aRun)
 void RunAction::EndOfRunAction(const G4Run* aRun)
 {
   G4int nofEvents = aRun->GetNumberOfEvent();
+  fLastRunNumberOfEvents = nofEvents;
   if (nofEvents == 0) {
     G4cout << "Run " << aRun->GetRunID() << " had no events." << G4endl;
   } else {
     G4cout << "### Run " << aRun->GetRunID() << " end. Number of events: " << nofEvents << G4endl;
   }
+  if (fTrackKiller) fTrackKiller->PrintStatistics();
+  if (fStepProfiler) fStepProfiler->PrintStatistics();
+  if (fEventTelemetry) fEventTelemetry->EndOfRun();
+  if (fEventWatchdog) fEventWatchdog->PrintStatistics();
+  PrimaryFilter::Instance()->PrintStatistics();
+  if (fRunCheckpoint) fRunCheckpoint->EndOfRun();
+  if (fKLMDigitizer) fKLMDigitizer->CloseOutput();
+  if (fKLMClusterReco) {
+    fKLMClusterReco->PrintStatistics();
+    fKLMClusterReco->CloseOutput();
+  }
+  MylarSD* mylarSD = static_cast<MylarSD*>(
+      G4SDManager::GetSDMpointer()->FindSensitiveDetector("KLM/MylarSD", false));
+  if (mylarSD && mylarSD->GetHitsOutsideWindow() > 0) {
+    G4cout << "MylarSD: " << mylarSD->GetHitsOutsideWindow()
+           << " hits dropped outside the readout window." << G4endl;
+  }
+  if (KLShowerModel* klShowerModel = KLShowerModel::Find()) klShowerModel->EndOfRun();
 
   if (fOutputFile.is_open()) {
     fOutputFile.close();
@@ -0,0 +1,183 @@
+#include "RunCheckpoint.hh"
+#include "ActionInitialization.hh"
+#include "InputGeneratorAction.hh"
+#include "RunAction.hh"
+#include "EventSeeder.hh"
+
+#include "G4RunManager.hh"
+#include "G4GenericMessenger.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+
+RunCheckpoint::RunCheckpoint()
+ : fMessenger(nullptr),
+   fEveryEvents(0),
+   fEverySeconds(0.),
+   fEventsRequested(0),
+   fEventsDone(0),
+   fEventIDOffset(0),
+   fEventsSinceCheckpoint(0),
+   fEventsDoneBefore(0)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/checkpoint/", "Checkpoints for resuming killed runs");
+  fMessenger->DeclareProperty("everyEvents", fEveryEvents, "Checkpoint every N events (0: off).");
+  fMessenger->DeclareProperty("everySeconds", fEverySeconds, "Checkpoint every T seconds of wall time (0: off).");
+}
+
+RunCheckpoint::~RunCheckpoint()
+{
+  delete fMessenger;
+}
+
+void RunCheckpoint::BeginOfRun(const G4String& outputFileName, G4int nToProcess, G4int eventIDOffset)
+{
+  fCheckpointFileName = outputFileName + ".ckpt";
+  fEventsDone = fEventsDoneBefore;
+  fEventsRequested = fEventsDoneBefore + nToProcess;
+  fEventIDOffset = eventIDOffset - fEventsDoneBefore;
+  fEventsDoneBefore = 0;
+  fEventsSinceCheckpoint = 0;
+  fSideOutputs.clear();
+  fLastCheckpoint = std::chrono::steady_clock::now();
+}
+
+void RunCheckpoint::EndOfEvent(std::ofstream& output, G4int nextInputEvent)
+{
+  fEventsDone++;
+  fEventsSinceCheckpoint++;
+  if (!IsActive() || !output.is_open()) return;
+  G4bool due = fEveryEvents > 0 && fEventsSinceCheckpoint >= fEveryEvents;
+  if (!due && fEverySeconds > 0.) {
+    due = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - fLastCheckpoint).count() >= fEverySeconds;
+  }
+  if (due) Write(output, nextInputEvent);
+}
+
+// The engine state is written before the checkpoint that refers to it; each
+// file is replaced by rename, so a kill at any point leaves a consistent pair.
+void RunCheckpoint::Write(std::ofstream& output, G4int nextInputEvent)
+{
+  output.flush();
+  const std::streamoff outputBytes = output.tellp();
+  std::vector<std::streamoff> sideBytes;
+  for (auto& side : fSideOutputs) {
+    side.second->flush();
+    sideBytes.push_back(side.second->is_open() ? static_cast<std::streamoff>(side.second->tellp()) : -1);
+  }
+
+  const std::string rngFileName = fCheckpointFileName + ".rndm";
+  {
+    std::ofstream rng(rngFileName + ".tmp");
+    G4Random::saveFullState(rng);
+  }
+  std::rename((rngFileName + ".tmp").c_str(), rngFileName.c_str());
+
+  {
+    std::ofstream ckpt(fCheckpointFileName + ".tmp");
+    ckpt << "# klm_barrel checkpoint\n"
+         << "events_requested " << fEventsRequested << "\n"
+         << "events_done " << fEventsDone << "\n"
+         << "event_id_offset " << fEventIDOffset << "\n"
+         << "next_input_event " << nextInputEvent << "\n"
+         << "output_bytes " << outputBytes << "\n"
+         << "run_seed " << EventSeeder::Instance()->GetRunSeed() << "\n"
+         << "rng_state " << rngFileName << "\n";
+    for (std::size_t i = 0; i < fSideOutputs.size(); ++i) {
+      if (sideBytes[i] >= 0) ckpt << fSideOutputs[i].first << " " << sideBytes[i] << "\n";
+    }
+  }
+  std::rename((fCheckpointFileName + ".tmp").c_str(), fCheckpointFileName.c_str());
+
+  fEventsSinceCheckpoint = 0;
+  fLastCheckpoint = std::chrono::steady_clock::now();
+}
+
+// A run that ended normally needs no resume
+void RunCheckpoint::EndOfRun()
+{
+  if (fCheckpointFileName.empty()) return;
+  std::remove(fCheckpointFileName.c_str());
+  std::remove((fCheckpointFileName + ".rndm").c_str());
+}
+
+G4int RunCheckpoint::Resume(G4RunManager* runManager, const G4String& inputFileName)
+{
+  RunAction* runAction = const_cast<RunAction*>(
+      dynamic_cast<const RunAction*>(runManager->GetUserRunAction()));
+  if (!runAction || !runAction->GetRunCheckpoint()) {
+    G4cerr << "RunCheckpoint: no RunAction with a checkpoint registered." << G4endl;
+    return 1;
+  }
+  const G4String checkpointFileName = runAction->GetOutputFileName() + ".ckpt";
+
+  // --- Read the "key value" lines ---
+  std::ifstream ckpt(checkpointFileName);
+  if (!ckpt) {
+    G4cerr << "RunCheckpoint: no checkpoint " << checkpointFileName
+           << " (the run finished, or never reached its first checkpoint)." << G4endl;
+    return 1;
+  }
+  std::map<std::string, std::string> values;
+  std::string line;
+  while (std::getline(ckpt, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream fields(line);
+    std::string key, value;
+    if (fields >> key >> value) values[key] = value;
+  }
+  for (const char* key : {"events_requested", "events_done", "event_id_offset",
+                          "next_input_event", "output_bytes", "run_seed", "rng_state"}) {
+    if (!values.count(key)) {
+      G4cerr << "RunCheckpoint: " << checkpointFileName << " has no " << key << G4endl;
+      return 1;
+    }
+  }
+  const G4int eventsRequested = std::atoi(values["events_requested"].c_str());
+  const G4int eventsDone = std::atoi(values["events_done"].c_str());
+  const G4int nextInputEvent = std::atoi(values["next_input_event"].c_str());
+  const G4int remaining = eventsRequested - eventsDone;
+  G4cout << "RunCheckpoint: resuming after " << eventsDone << " of " << eventsRequested
+         << " events at input event " << nextInputEvent << G4endl;
+
+  // --- Generator positioned after the completed events ---
+  InputGeneratorAction* generator = ActionInitialization::CreateGenerator(inputFileName);
+  const G4VUserPrimaryGeneratorAction* previous = runManager->GetUserPrimaryGeneratorAction();
+  runManager->SetUserAction(generator);
+  delete previous;
+  if (generator->SkipEvents(nextInputEvent) < nextInputEvent) {
+    G4cerr << "RunCheckpoint: " << inputFileName << " has fewer than " << nextInputEvent
+           << " events; is it the input of the checkpointed run?" << G4endl;
+    return 1;
+  }
+
+  // --- Engine, seeds and output as they were at the checkpoint ---
+  EventSeeder::Instance()->SetRunSeed(std::atol(values["run_seed"].c_str()));
+  std::ifstream rng(values["rng_state"]);
+  if (!rng) {
+    G4cerr << "RunCheckpoint: cannot read " << values["rng_state"] << G4endl;
+    return 1;
+  }
+  G4Random::restoreFullState(rng);
+
+  runAction->SetEventIDOffset(std::atoi(values["event_id_offset"].c_str()) + eventsDone);
+  runAction->SetResumeOutputBytes(std::atoll(values["output_bytes"].c_str()));
+  // Side outputs the checkpointed run did not write start afresh
+  runAction->SetResumeDigitsBytes(values.count("digits_bytes") ? std::atoll(values["digits_bytes"].c_str()) : -1);
+  runAction->SetResumeClustersBytes(values.count("clusters_bytes") ? std::atoll(values["clusters_bytes"].c_str()) : -1);
+  runAction->GetRunCheckpoint()->fEventsDoneBefore = eventsDone;
+
+  if (remaining > 0) {
+    runManager->BeamOn(remaining);
+  } else {
+    // Killed between the last event and the end of the run: only the output is left to keep
+    std::remove(checkpointFileName.c_str());
+    std::remove(values["rng_state"].c_str());
+  }
+  return 0;
+}
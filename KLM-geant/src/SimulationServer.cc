@@ -0,0 +1,252 @@
+#include "SimulationServer.hh"
+#include "ActionInitialization.hh"
+#include "InputGeneratorAction.hh"
+#include "RunAction.hh"
+#include "EventSeeder.hh"
+
+#include "G4RunManager.hh"
+#include "Randomize.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+  // The whole token as a decimal integer in [minValue, maxValue]; "abc", "1e3" and overflow fail
+  G4bool ParseInteger(const std::string& text, long long minValue, long long maxValue, long long& value)
+  {
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtoll(text.c_str(), &end, 10);
+    return !text.empty() && *end == '\0' && errno != ERANGE && value >= minValue && value <= maxValue;
+  }
+}
+
+SimulationServer::SimulationServer(G4RunManager* runManager)
+ : fRunAction(nullptr),
+   fRunManager(runManager),
+   fInitialRunSeed(0),
+   fJobsRun(0)
+{
+  // The run manager only hands out const user actions; the server owns the job
+  // configuration of the single RunAction built by ActionInitialization
+  fRunAction = const_cast<RunAction*>(
+      dynamic_cast<const RunAction*>(fRunManager->GetUserRunAction()));
+  if (!fRunAction) {
+    G4Exception("SimulationServer::SimulationServer", "KLMServer001", FatalException,
+                "No RunAction registered; construct the server after ActionInitialization.");
+  }
+  std::ostringstream state;
+  G4Random::saveFullState(state);
+  fInitialRandomState = state.str();
+  fInitialRunSeed = EventSeeder::Instance()->GetRunSeed();
+}
+
+SimulationServer::~SimulationServer()
+{}
+
+std::string SimulationServer::RunJob(const std::string& jobLine)
+{
+  // --- Parse "key=value" tokens ---
+  std::map<std::string, std::string> job;
+  std::istringstream tokens(jobLine);
+  std::string token;
+  while (tokens >> token) {
+    std::size_t eq = token.find('=');
+    if (eq == std::string::npos) return "ERROR malformed token '" + token + "'";
+    job[token.substr(0, eq)] = token.substr(eq + 1);
+  }
+  for (const auto& entry : job) {
+    if (entry.first != "input" && entry.first != "output" && entry.first != "first" &&
+        entry.first != "offset" && entry.first != "count" && entry.first != "id" && entry.first != "seed") {
+      return "ERROR unknown key '" + entry.first + "'";
+    }
+  }
+  const std::string input = job["input"];
+  const std::string output = job["output"];
+  const std::string id = job.count("id") ? job["id"] : std::to_string(fJobsRun);
+  // Values are range-checked here, so the narrowing to G4int below is safe
+  long long first = 0, count = -1, offset = -1, seed = fInitialRunSeed;
+  if (job.count("first") && !ParseInteger(job["first"], 0, std::numeric_limits<G4int>::max(), first)) {
+    return "ERROR job " + id + ": first must be an integer >= 0, got '" + job["first"] + "'";
+  }
+  if (job.count("count") && !ParseInteger(job["count"], 0, std::numeric_limits<G4int>::max(), count)) {
+    return "ERROR job " + id + ": count must be an integer >= 0, got '" + job["count"] + "'";
+  }
+  if (job.count("offset") && !ParseInteger(job["offset"], -1, std::numeric_limits<G4long>::max(), offset)) {
+    return "ERROR job " + id + ": offset must be a byte position >= 0 (or -1), got '" + job["offset"] + "'";
+  }
+  if (job.count("seed") && !ParseInteger(job["seed"], std::numeric_limits<G4long>::min(),
+                                         std::numeric_limits<G4long>::max(), seed)) {
+    return "ERROR job " + id + ": seed must be an integer, got '" + job["seed"] + "'";
+  }
+  if (input.empty() || output.empty()) return "ERROR job " + id + ": input= and output= are required";
+  if (input != "gun" && !std::ifstream(input)) return "ERROR job " + id + ": cannot open input " + input;
+
+  G4cout << "SimulationServer: job " << id << ": " << input << " first=" << first
+         << " count=" << count << " -> " << output << G4endl;
+
+  // --- Fresh generator and RNG state, as in a new process ---
+  InputGeneratorAction* generator = ActionInitialization::CreateGenerator(input);
+  const G4VUserPrimaryGeneratorAction* previous = fRunManager->GetUserPrimaryGeneratorAction();
+  fRunManager->SetUserAction(generator);
+  delete previous;
+
+  std::istringstream state(fInitialRandomState);
+  G4Random::restoreFullState(state);
+  EventSeeder::Instance()->SetRunSeed(seed);
+  if (job.count("seed")) G4Random::setTheSeed(seed); // used when /klm/random/perEvent false
+
+  if (first > 0 && !generator->SeekEvent(static_cast<G4int>(first), offset)) {
+    G4int skipped = generator->SkipEvents(static_cast<G4int>(first));
+    if (skipped < first) {
+      return "ERROR job " + id + ": input has only " + std::to_string(skipped) + " events";
+    }
+  }
+
+  // --- Run ---
+  fRunAction->SetOutputFileName(output);
+  fRunAction->SetEventIDOffset(static_cast<G4int>(first));
+  auto wallStart = std::chrono::steady_clock::now();
+  std::clock_t cpuStart = std::clock();
+  fRunManager->BeamOn(count < 0 ? std::numeric_limits<G4int>::max() : static_cast<G4int>(count));
+  G4double wall = std::chrono::duration<G4double>(std::chrono::steady_clock::now() - wallStart).count();
+  G4double cpu = G4double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+  fJobsRun++;
+
+  // --- Timing report ---
+  G4int events = fRunAction->GetLastRunNumberOfEvents();
+  std::ostringstream report;
+  report << std::fixed << std::setprecision(3)
+         << "OK id=" << id << " input=" << input << " first=" << first
+         << " events=" << events << " output=" << output
+         << " wall_s=" << wall << " cpu_s=" << cpu
+         << " events_per_s=" << (wall > 0. ? events / wall : 0.);
+  std::ofstream timing(output + ".timing");
+  timing << report.str() << "\n";
+  G4cout << "SimulationServer: " << report.str() << G4endl;
+  return report.str();
+}
+
+G4int SimulationServer::ServeSocket(const G4String& socketPath)
+{
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    G4cerr << "SimulationServer: socket path too long: " << socketPath << G4endl;
+    return 1;
+  }
+  std::snprintf(address.sun_path, sizeof(address.sun_path), "%s", socketPath.c_str());
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socketPath.c_str()); // stale socket of a previous server
+  if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(listener, 8) != 0) {
+    G4cerr << "SimulationServer: cannot listen on " << socketPath << G4endl;
+    if (listener >= 0) close(listener);
+    return 1;
+  }
+  G4cout << "SimulationServer: listening on " << socketPath << G4endl;
+
+  G4bool shutdown = false;
+  while (!shutdown) {
+    int client = accept(listener, nullptr, nullptr);
+    if (client < 0) continue;
+    std::string buffer;
+    char chunk[4096];
+    ssize_t n;
+    while (!shutdown && (n = recv(client, chunk, sizeof(chunk), 0)) > 0) {
+      buffer.append(chunk, n);
+      std::size_t eol;
+      while (!shutdown && (eol = buffer.find('\n')) != std::string::npos) {
+        std::string line = buffer.substr(0, eol);
+        buffer.erase(0, eol + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        std::string reply;
+        if (line == "shutdown") {
+          shutdown = true;
+          reply = "OK shutdown";
+        } else {
+          reply = RunJob(line);
+        }
+        reply += "\n";
+        send(client, reply.data(), reply.size(), MSG_NOSIGNAL); // client may be gone
+      }
+    }
+    close(client);
+  }
+  close(listener);
+  unlink(socketPath.c_str());
+  G4cout << "SimulationServer: shut down after " << fJobsRun << " jobs." << G4endl;
+  return 0;
+}
+
+G4int SimulationServer::ServeSpool(const G4String& spoolDir)
+{
+  G4cout << "SimulationServer: watching spool directory " << spoolDir << G4endl;
+  const std::string dir = spoolDir;
+  while (true) {
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+      G4cerr << "SimulationServer: cannot open spool directory " << dir << G4endl;
+      return 1;
+    }
+    std::vector<std::string> jobFiles;
+    G4bool shutdown = false;
+    while (dirent* entry = readdir(handle)) {
+      std::string name = entry->d_name;
+      if (name == "shutdown") shutdown = true;
+      if (name.size() > 4 && name.compare(name.size() - 4, 4, ".job") == 0) jobFiles.push_back(name);
+    }
+    closedir(handle);
+    std::sort(jobFiles.begin(), jobFiles.end()); // submission order by name
+
+    for (const auto& name : jobFiles) {
+      const std::string base = dir + "/" + name.substr(0, name.size() - 4);
+      // The rename claims the job; it fails if another server took it first
+      if (std::rename((dir + "/" + name).c_str(), (base + ".running").c_str()) != 0) continue;
+      std::vector<std::string> lines;
+      {
+        std::ifstream in(base + ".running");
+        std::string line;
+        while (std::getline(in, line)) {
+          if (!line.empty() && line[0] != '#') lines.push_back(line);
+        }
+      }
+      G4bool failed = false;
+      std::ofstream result(base + ".running", std::ios::out | std::ios::app);
+      for (const auto& line : lines) {
+        std::string reply = RunJob(line);
+        if (reply.compare(0, 2, "OK") != 0) failed = true;
+        result << "# " << reply << "\n";
+      }
+      result.close();
+      std::rename((base + ".running").c_str(), (base + (failed ? ".failed" : ".done")).c_str());
+    }
+
+    if (shutdown && jobFiles.empty()) {
+      std::remove((dir + "/shutdown").c_str());
+      break;
+    }
+    if (jobFiles.empty()) std::this_thread::sleep_for(std::chrono::seconds(1));
+  }
+  G4cout << "SimulationServer: shut down after " << fJobsRun << " jobs." << G4endl;
+  return 0;
+}
@@ -0,0 +1,36 @@
+#include "StackingAction.hh"
+#include "TrackKiller.hh"
+#include "EventWatchdog.hh"
+
+#include "G4Track.hh"
+#include "G4ios.hh"
+
+StackingAction::StackingAction(TrackKiller* trackKiller)
+ : G4UserStackingAction(),
+   fTrackKiller(trackKiller),
+   fEventWatchdog(nullptr),
+   fTracksThisEvent(0)
+{
+  G4cout << "StackingAction created." << G4endl;
+}
+
+StackingAction::~StackingAction()
+{}
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track)
+{
+  fTracksThisEvent++;
+  // Past the track budget nothing new is stacked
+  if (fEventWatchdog && fEventWatchdog->CheckNewTrack()) {
+    return fKill;
+  }
+  if (fTrackKiller && fTrackKiller->CheckNewTrack(track)) {
+    return fKill;
+  }
+  return fUrgent;
+}
+
+void StackingAction::PrepareNewEvent()
+{
+  fTracksThisEvent = 0;
+}
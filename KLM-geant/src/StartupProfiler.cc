@@ -0,0 +1,155 @@
+#include "StartupProfiler.hh"
+
+#include "G4StateManager.hh"
+#include "G4Version.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+StartupProfiler* StartupProfiler::fInstance = nullptr;
+
+StartupProfiler* StartupProfiler::Instance()
+{
+  if (!fInstance) fInstance = new StartupProfiler();
+  return fInstance;
+}
+
+StartupProfiler::StartupProfiler()
+ : G4VStateDependent(),
+   fReportFileName("startup_profile.json"),
+   fReported(false),
+   fProcessStart(std::chrono::steady_clock::now()),
+   fInInitialize(false),
+   fInPhysicsTables(false),
+   fPhysicsTablesDone(false),
+   fTransitionCpu(0)
+{}
+
+StartupProfiler::~StartupProfiler()
+{}
+
+StartupProfiler::Scope::Scope(const G4String& phase)
+ : fPhase(phase),
+   fWallStart(std::chrono::steady_clock::now()),
+   fCpuStart(std::clock())
+{}
+
+StartupProfiler::Scope::~Scope()
+{
+  std::chrono::duration<G4double> wall = std::chrono::steady_clock::now() - fWallStart;
+  G4double cpu = static_cast<G4double>(std::clock() - fCpuStart) / CLOCKS_PER_SEC;
+  StartupProfiler::Instance()->AddPhase(fPhase, wall.count(), cpu);
+}
+
+StartupProfiler::Phase* StartupProfiler::FindPhase(const G4String& name)
+{
+  for (auto& phase : fPhases) {
+    if (phase.name == name) return &phase;
+  }
+  return nullptr;
+}
+
+G4double StartupProfiler::PhaseWall(const G4String& name)
+{
+  Phase* phase = FindPhase(name);
+  return phase ? phase->wallSeconds : 0.;
+}
+
+G4double StartupProfiler::PhaseCpu(const G4String& name)
+{
+  Phase* phase = FindPhase(name);
+  return phase ? phase->cpuSeconds : 0.;
+}
+
+void StartupProfiler::AddPhase(const G4String& name, G4double wallSeconds, G4double cpuSeconds)
+{
+  Phase* phase = FindPhase(name);
+  if (!phase) {
+    fPhases.push_back({name, 0., 0., 0});
+    phase = &fPhases.back();
+  }
+  phase->wallSeconds += wallSeconds;
+  phase->cpuSeconds += cpuSeconds;
+  phase->calls++;
+}
+
+// PreInit -> Init ... -> Idle   : G4RunManager::Initialize (/run/initialize)
+// Idle -> Init ... -> Idle      : RunInitialization of the first BeamOn (physics tables)
+G4bool StartupProfiler::Notify(G4ApplicationState requestedState)
+{
+  G4ApplicationState currentState = G4StateManager::GetStateManager()->GetCurrentState();
+  if (currentState == requestedState) return true;
+
+  auto now = std::chrono::steady_clock::now();
+  if (requestedState == G4State_Init && currentState == G4State_PreInit) {
+    fInInitialize = true;
+    fTransitionWall = now;
+    fTransitionCpu = std::clock();
+  } else if (requestedState == G4State_Init && currentState == G4State_Idle && !fPhysicsTablesDone) {
+    fInPhysicsTables = true;
+    fTransitionWall = now;
+    fTransitionCpu = std::clock();
+  } else if (requestedState == G4State_Idle && (fInInitialize || fInPhysicsTables)) {
+    std::chrono::duration<G4double> wall = now - fTransitionWall;
+    G4double cpu = static_cast<G4double>(std::clock() - fTransitionCpu) / CLOCKS_PER_SEC;
+    if (fInInitialize) {
+      AddPhase("Initialize (total)", wall.count(), cpu);
+      fInInitialize = false;
+    } else {
+      AddPhase("PhysicsTables (first run)", wall.count(), cpu);
+      fInPhysicsTables = false;
+      fPhysicsTablesDone = true;
+      Report();
+    }
+  }
+  return true;
+}
+
+void StartupProfiler::Report()
+{
+  if (fReported) return;
+  fReported = true;
+
+  // Physics-list construction is the part of /run/initialize not covered by an explicit phase
+  if (FindPhase("Initialize (total)")) {
+    G4double wall = PhaseWall("Initialize (total)") - PhaseWall("DefineMaterials")
+                  - PhaseWall("GeometryBuild") - PhaseWall("ConstructSDandField");
+    G4double cpu = PhaseCpu("Initialize (total)") - PhaseCpu("DefineMaterials")
+                 - PhaseCpu("GeometryBuild") - PhaseCpu("ConstructSDandField");
+    AddPhase("PhysicsListConstruction (derived)", std::max(0., wall), std::max(0., cpu));
+  }
+  std::chrono::duration<G4double> total = std::chrono::steady_clock::now() - fProcessStart;
+
+  G4cout << "\n--- Startup profile ---" << G4endl;
+  G4cout << std::left << std::setw(36) << "Phase" << std::right
+         << std::setw(12) << "Wall [s]" << std::setw(12) << "CPU [s]" << std::setw(8) << "Calls" << G4endl;
+  for (const auto& phase : fPhases) {
+    G4cout << std::left << std::setw(36) << phase.name << std::right << std::fixed << std::setprecision(3)
+           << std::setw(12) << phase.wallSeconds << std::setw(12) << phase.cpuSeconds
+           << std::setw(8) << phase.calls << std::defaultfloat << std::setprecision(6) << G4endl;
+  }
+  G4cout << std::left << std::setw(36) << "Since process start" << std::right << std::fixed
+         << std::setprecision(3) << std::setw(12) << total.count() << std::defaultfloat
+         << std::setprecision(6) << G4endl;
+  G4cout << "-----------------------" << G4endl;
+
+  if (fReportFileName.empty()) return;
+  std::ofstream json(fReportFileName);
+  if (!json) {
+    G4cerr << "StartupProfiler: cannot write " << fReportFileName << G4endl;
+    return;
+  }
+  json << "{\n  \"geant4_version\": \"" << G4Version << "\",\n"
+       << "  \"since_process_start_s\": " << total.count() << ",\n"
+       << "  \"phases\": [\n";
+  for (std::size_t i = 0; i < fPhases.size(); ++i) {
+    const Phase& phase = fPhases[i];
+    json << "    {\"name\": \"" << phase.name << "\", \"wall_s\": " << phase.wallSeconds
+         << ", \"cpu_s\": " << phase.cpuSeconds << ", \"calls\": " << phase.calls << "}"
+         << (i + 1 < fPhases.size() ? ",\n" : "\n");
+  }
+  json << "  ]\n}\n";
+  G4cout << "StartupProfiler: report written to " << fReportFileName << G4endl;
+}
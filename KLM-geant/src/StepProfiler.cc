@@ -0,0 +1,197 @@
+#include "StepProfiler.hh"
+#include "DetectorConstruction.hh"
+
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4StepPoint.hh"
+#include "G4VTouchable.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4VProcess.hh"
+#include "G4GenericMessenger.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <vector>
+
+StepProfiler::StepProfiler()
+ : fMessenger(nullptr),
+   fEnabled(false),
+   fSampleEvery(100),
+   fTableRows(30),
+   fCsvFileName("step_profile.csv"),
+   fStepCounter(0),
+   fTimingPending(false),
+   fTimedTrack(nullptr),
+   fTimedStepNumber(0),
+   fSharedSublayerLV(nullptr)
+{
+  fMessenger = new G4GenericMessenger(this, "/klm/profile/steps/", "Per-volume/particle/process step profiler");
+  fMessenger->DeclareProperty("enable", fEnabled,
+      "Count steps, track length and sampled time per volume, particle and process.");
+  fMessenger->DeclareProperty("sampleEvery", fSampleEvery,
+      "Time one step in N (the estimate is scaled by N).");
+  fMessenger->DeclareProperty("tableRows", fTableRows,
+      "Rows of the end-of-run table (the CSV file has all rows).");
+  fMessenger->DeclareProperty("csv", fCsvFileName,
+      "CSV output file, written at end of run (empty: none).");
+}
+
+StepProfiler::~StepProfiler()
+{
+  delete fMessenger;
+}
+
+std::size_t StepProfiler::KeyHash::operator()(const Key& key) const
+{
+  std::size_t hash = std::hash<const void*>()(key.volume);
+  hash = hash * 31 + std::hash<const void*>()(key.particle);
+  hash = hash * 31 + std::hash<const void*>()(key.process);
+  return hash * 31 + static_cast<std::size_t>(key.replica);
+}
+
+void StepProfiler::ResetStatistics()
+{
+  fCounters.clear();
+  fStepCounter = 0;
+  fTimingPending = false;
+  // Looked up per run: the layering mode is fixed once the geometry is built
+  fSharedSublayerLV = G4LogicalVolumeStore::GetInstance()->GetVolume("RPCSublayer_Log", false);
+}
+
+void StepProfiler::RecordStep(const G4Step* step)
+{
+  const G4StepPoint* preStep = step->GetPreStepPoint();
+  const G4VTouchable* touchable = preStep->GetTouchable();
+  const G4VPhysicalVolume* pv = touchable->GetVolume();
+  Key key;
+  key.volume = pv ? pv->GetLogicalVolume() : nullptr;
+  key.replica = -1;
+  if (key.volume && key.volume == fSharedSublayerLV) {
+    // Parameterised layering: split the shared LV back into the _S<stack> sublayers
+    key.replica = touchable->GetReplicaNumber(1) * 100 + touchable->GetReplicaNumber(0);
+  }
+  const G4Track* track = step->GetTrack();
+  key.particle = track->GetParticleDefinition();
+  key.process = step->GetPostStepPoint()->GetProcessDefinedStep();
+
+  Counters& counters = fCounters[key];
+  counters.steps++;
+  counters.trackLength += step->GetStepLength();
+
+  // Sampled timing: the interval since the end of the previous step of this
+  // track. Anything else in between (other tracks, event I/O, primaries) means
+  // the track ended or was suspended, and the sample is dropped.
+  if (fTimingPending && track == fTimedTrack && track->GetCurrentStepNumber() == fTimedStepNumber + 1) {
+    counters.sampledSeconds += std::chrono::duration<G4double>(
+        std::chrono::steady_clock::now() - fSampleStart).count() * fSampleEvery;
+  }
+  fTimingPending = false;
+  // Only a step the track survives has a next step to time
+  if (track->GetTrackStatus() != fAlive) return;
+  if (fSampleEvery > 0 && ++fStepCounter % fSampleEvery == 0) {
+    fTimingPending = true;
+    fTimedTrack = track;
+    fTimedStepNumber = track->GetCurrentStepNumber();
+    fSampleStart = std::chrono::steady_clock::now();
+  }
+}
+
+G4String StepProfiler::VolumeName(const Key& key) const
+{
+  if (!key.volume) return "OutOfWorld";
+  if (key.replica < 0) return key.volume->GetName();
+  const DetectorConstruction* detector = static_cast<const DetectorConstruction*>(
+      G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  return detector->GetSublayerName(key.replica % 100) + "_S" + std::to_string(key.replica / 100) + "_Log";
+}
+
+void StepProfiler::PrintStatistics() const
+{
+  if (!fEnabled || fCounters.empty()) return;
+
+  struct Row {
+    G4String volume, particle, process;
+    Counters counters;
+  };
+  std::vector<Row> rows;
+  std::map<G4String, Counters> byVolume, byParticle, byProcess;
+  G4long totalSteps = 0;
+  G4double totalSeconds = 0.;
+  for (const auto& entry : fCounters) {
+    Row row;
+    row.volume = VolumeName(entry.first);
+    row.particle = entry.first.particle ? entry.first.particle->GetParticleName() : G4String("unknown");
+    row.process = entry.first.process ? entry.first.process->GetProcessName() : G4String("none");
+    row.counters = entry.second;
+    for (auto* group : {&byVolume[row.volume], &byParticle[row.particle], &byProcess[row.process]}) {
+      group->steps += row.counters.steps;
+      group->trackLength += row.counters.trackLength;
+      group->sampledSeconds += row.counters.sampledSeconds;
+    }
+    totalSteps += row.counters.steps;
+    totalSeconds += row.counters.sampledSeconds;
+    rows.push_back(row);
+  }
+  std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+    return a.counters.steps > b.counters.steps;
+  });
+
+  auto percent = [](G4double part, G4double total) { return total > 0. ? 100. * part / total : 0.; };
+  auto printGroup = [&](const char* title, const std::map<G4String, Counters>& group) {
+    std::vector<std::pair<G4String, Counters> > sorted(group.begin(), group.end());
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<G4String, Counters>& a,
+                                               const std::pair<G4String, Counters>& b) {
+      return a.second.steps > b.second.steps;
+    });
+    G4cout << "  By " << title << ":" << G4endl;
+    G4int shown = 0;
+    for (const auto& entry : sorted) {
+      if (shown++ >= fTableRows) break;
+      G4cout << "    " << std::setw(28) << std::left << entry.first << std::right
+             << std::setw(12) << entry.second.steps
+             << std::setw(8) << std::fixed << std::setprecision(1) << percent(entry.second.steps, totalSteps) << " %"
+             << std::setw(8) << percent(entry.second.sampledSeconds, totalSeconds) << " % time"
+             << std::defaultfloat << std::setprecision(6) << G4endl;
+    }
+  };
+
+  G4cout << "\n--- Step profile: " << totalSteps << " steps, ~" << totalSeconds
+         << " s sampled stepping time ---" << G4endl;
+  G4cout << "    " << std::setw(28) << std::left << "Volume" << std::setw(14) << "Particle"
+         << std::setw(22) << "Process" << std::right << std::setw(12) << "Steps"
+         << std::setw(14) << "Length [m]" << std::setw(12) << "Time [s]" << G4endl;
+  G4int shown = 0;
+  for (const Row& row : rows) {
+    if (shown++ >= fTableRows) break;
+    G4cout << "    " << std::setw(28) << std::left << row.volume << std::setw(14) << row.particle
+           << std::setw(22) << row.process << std::right << std::setw(12) << row.counters.steps
+           << std::setw(14) << row.counters.trackLength / m
+           << std::setw(12) << row.counters.sampledSeconds << G4endl;
+  }
+  printGroup("volume", byVolume);
+  printGroup("particle", byParticle);
+  printGroup("process", byProcess);
+  G4cout << "------------------------------" << G4endl;
+
+  if (fCsvFileName.empty()) return;
+  std::ofstream csv(fCsvFileName);
+  if (!csv) {
+    G4cerr << "StepProfiler: cannot write " << fCsvFileName << G4endl;
+    return;
+  }
+  csv << "volume,particle,process,steps,track_length_mm,sampled_time_s\n";
+  for (const Row& row : rows) {
+    csv << row.volume << "," << row.particle << "," << row.process << "," << row.counters.steps << ","
+        << row.counters.trackLength / mm << "," << row.counters.sampledSeconds << "\n";
+  }
+  G4cout << "StepProfiler: " << rows.size() << " rows written to " << fCsvFileName << G4endl;
+}
@@ -1,5 +1,8 @@
 #include "SteppingAction.hh"
 #include "DetectorConstruction.hh" // Might need if accessing geometry info directly
+#include "TrackKiller.hh"
+#include "StepProfiler.hh"
+#include "EventWatchdog.hh"
 
 #include "G4Step.hh"
 #include "G4Track.hh"
@@ -15,10 +18,17 @@ std::set<G4int> SteppingAction::fTracksInRPC;
 // Constructor stores the target material name
 SteppingAction::SteppingAction(const G4String& rpcMaterialName)
  : G4UserSteppingAction(),
-   fRpcMaterialName(rpcMaterialName)
+   fRpcMaterialName(rpcMaterialName),
+   fTrackKiller(nullptr),
+   fStepProfiler(nullptr),
+   fEventWatchdog(nullptr)
 {
-    G4cout << "SteppingAction initialized to kill particles after entering material: "
-           << fRpcMaterialName << G4endl;
+    if (!fRpcMaterialName.empty()) {
+        G4cout << "SteppingAction initialized to kill particles after entering material: "
+               << fRpcMaterialName << G4endl;
+    } else {
+        G4cout << "SteppingAction created." << G4endl;
+    }
 }
 
 SteppingAction::~SteppingAction()
@@ -32,6 +42,17 @@ void SteppingAction::Reset() {
 // This method is called by Geant4 at the end of each step
 void SteppingAction::UserSteppingAction(const G4Step* step)
 {
+    // Profile every step, including the ones the killer ends
+    if (fStepProfiler && fStepProfiler->IsEnabled()) fStepProfiler->RecordStep(step);
+
+    // Runaway-event guard: an over-budget event is aborted or truncated here
+    if (fEventWatchdog && fEventWatchdog->CheckStep(step)) return;
+
+    // Geometry-aware killer first: a killed track needs no further checks
+    if (fTrackKiller && fTrackKiller->CheckStep(step)) return;
+
+    if (fRpcMaterialName.empty()) return;
+
     // Get the track associated with this step
     G4Track* track = step->GetTrack();
 
@@ -0,0 +1,296 @@
+#include "TrackKiller.hh"
+#include "DetectorConstruction.hh"
+
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4StepPoint.hh"
+#include "G4Material.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4EmCalculator.hh"
+#include "G4GenericMessenger.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4RunManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4UnitsTable.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+TrackKiller::TrackKiller()
+ : fMessenger(nullptr),
+   fEmCalculator(nullptr),
+   fEnabled(true),
+   fKillOutsideEnvelope(true),
+   fKillRangedOut(false),
+   fEnvelopeMargin(1.0 * mm),
+   fRangeSafetyFactor(1.0),
+   fDefaultTimeCut(DBL_MAX),
+   fGeometryCached(false),
+   fOuterRadius(0.), fHalfLength(0.), fSectorAngle(0.), fNumSectors(0),
+   fIronMaterial(nullptr),
+   fTimeCutActive(false),
+   fTracksSeen(0), fKilledAtStacking(0), fRunStartClock(0)
+{
+  ResetStatistics();
+
+  fMessenger = new G4GenericMessenger(this, "/klm/killer/", "Geometry-aware track killer");
+  fMessenger->DeclareProperty("enable", fEnabled,
+      "Enable/disable the track killer as a whole.");
+  fMessenger->DeclareProperty("envelope", fKillOutsideEnvelope,
+      "Kill tracks leaving the barrel outward or past |z| > halfLength.");
+  fMessenger->DeclareProperty("rangeOut", fKillRangedOut,
+      "Kill charged tracks in iron whose range is shorter than the distance to the nearest gas gap.");
+  fMessenger->DeclarePropertyWithUnit("envelopeMargin", "mm", fEnvelopeMargin,
+      "Distance beyond the barrel envelope before a track is considered gone.");
+  fMessenger->DeclareProperty("rangeSafety", fRangeSafetyFactor,
+      "Kill only if range < rangeSafety * distance to nearest gas gap (<= 1 is conservative).");
+  fMessenger->DeclarePropertyWithUnit("timeCut", "ns", fDefaultTimeCut,
+      "Kill tracks whose global time exceeds this value (regions without their own cut).");
+  fMessenger->DeclareMethod("regionTimeCut", &TrackKiller::SetRegionTimeCut,
+      "Per-region global time cut: <region> <value> <unit>, e.g. KLMSectorRegion 200 ns.");
+}
+
+TrackKiller::~TrackKiller()
+{
+  delete fMessenger;
+  delete fEmCalculator;
+}
+
+const char* TrackKiller::GetReasonName(KillReason reason)
+{
+  switch (reason) {
+    case kLeftBarrelRadially: return "LeftBarrelRadially";
+    case kLeftBarrelAlongZ:   return "LeftBarrelAlongZ";
+    case kRangedOutInIron:    return "RangedOutInIron";
+    case kOutsideTimeWindow:  return "OutsideTimeWindow";
+    default:                  return "Unknown";
+  }
+}
+
+void TrackKiller::ResetStatistics()
+{
+  fKilledTracks.fill(0);
+  fKilledEnergy.fill(0.);
+  fTracksSeen = 0;
+  fKilledAtStacking = 0;
+  fRunStartClock = std::clock();
+  // Geometry may have been rebuilt between runs
+  fGeometryCached = false;
+}
+
+void TrackKiller::SetRegionTimeCut(const G4String& args)
+{
+  std::istringstream is(args);
+  G4String regionName, unit;
+  G4double value = 0.;
+  if (!(is >> regionName >> value >> unit)) {
+    G4cerr << "TrackKiller: expected '<region> <value> <unit>', got '" << args << "'" << G4endl;
+    return;
+  }
+  // An unknown unit would give a zero cut and kill every track in the region
+  if (G4UnitDefinition::GetCategory(unit) != "Time" || value <= 0.) {
+    G4cerr << "TrackKiller: '" << value << " " << unit << "' is not a positive time; time cut for region "
+           << regionName << " unchanged" << G4endl;
+    return;
+  }
+  fRegionTimeCutsByName[regionName] = value * G4UnitDefinition::GetValueOf(unit);
+  fGeometryCached = false; // re-resolve region pointers
+  G4cout << "TrackKiller: time cut for region " << regionName << " set to "
+         << G4BestUnit(fRegionTimeCutsByName[regionName], "Time") << G4endl;
+}
+
+G4double TrackKiller::TimeCutFor(const G4Region* region) const
+{
+  if (region && !fRegionTimeCuts.empty()) {
+    auto it = fRegionTimeCuts.find(region);
+    if (it != fRegionTimeCuts.end()) return it->second;
+  }
+  return fDefaultTimeCut;
+}
+
+void TrackKiller::CacheGeometry()
+{
+  const DetectorConstruction* detector = static_cast<const DetectorConstruction*>(
+      G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (!detector) return;
+
+  fOuterRadius = detector->GetKLMOuterRadius();
+  fHalfLength = detector->GetKLMHalfLength();
+  fSectorAngle = detector->GetKLMSectorAngle();
+  fNumSectors = detector->GetNumSectors();
+  fIronMaterial = detector->GetIronMaterial();
+
+  fGasGaps.clear();
+  for (const auto& layer : detector->GetRadialLayers()) {
+    if (layer.isGasGap) fGasGaps.emplace_back(layer.rMin, layer.rMax);
+  }
+  std::sort(fGasGaps.begin(), fGasGaps.end());
+
+  fRegionTimeCuts.clear();
+  fTimeCutActive = fDefaultTimeCut < DBL_MAX;
+  for (const auto& cut : fRegionTimeCutsByName) {
+    G4Region* region = G4RegionStore::GetInstance()->GetRegion(cut.first, false);
+    if (!region) {
+      G4cerr << "TrackKiller: unknown region '" << cut.first << "', time cut ignored." << G4endl;
+      continue;
+    }
+    fRegionTimeCuts[region] = cut.second;
+    fTimeCutActive = true;
+  }
+  fGeometryCached = true;
+}
+
+// Sector face index whose outward normal is closest to the position's azimuth
+G4int TrackKiller::SectorOf(const G4ThreeVector& pos) const
+{
+  G4double phi = std::atan2(pos.y(), pos.x());
+  G4int iSector = static_cast<G4int>(std::floor(phi / fSectorAngle + 0.5));
+  return (iSector % fNumSectors + fNumSectors) % fNumSectors;
+}
+
+// Distance from the beam axis measured along the normal of sector face iSector,
+// i.e. the "radius" used by the single-sided G4Polyhedra layers
+G4double TrackKiller::LocalRadius(const G4ThreeVector& pos, G4int iSector) const
+{
+  G4double phiC = iSector * fSectorAngle;
+  return pos.x() * std::cos(phiC) + pos.y() * std::sin(phiC);
+}
+
+// Straight-line lower bound on the distance to any gas gap. The neighbouring
+// sectors are included so that tracks near a sector edge are never killed early.
+G4double TrackKiller::DistanceToNearestGasGap(const G4ThreeVector& pos) const
+{
+  G4double best = std::numeric_limits<G4double>::max();
+  G4int iSector = SectorOf(pos);
+  for (G4int dSector = -1; dSector <= 1; ++dSector) {
+    G4double r = LocalRadius(pos, (iSector + dSector + fNumSectors) % fNumSectors);
+    auto next = std::lower_bound(fGasGaps.begin(), fGasGaps.end(), std::make_pair(r, r));
+    if (next != fGasGaps.end()) best = std::min(best, next->first - r);
+    if (next != fGasGaps.begin()) {
+      auto previous = next - 1;
+      best = std::min(best, std::max(0., r - previous->second));
+    }
+  }
+  return best;
+}
+
+G4bool TrackKiller::ShouldKill(const G4ThreeVector& pos, const G4ThreeVector& dir, G4double kinE,
+                               G4double globalTime, const G4Region* region,
+                               const G4ParticleDefinition* particle, const G4Material* material,
+                               KillReason& reason)
+{
+  if (!fGeometryCached) CacheGeometry();
+  if (!fGeometryCached || fNumSectors <= 0) return false;
+
+  if (fTimeCutActive && globalTime > TimeCutFor(region)) {
+    reason = kOutsideTimeWindow;
+    return true;
+  }
+
+  if (fKillOutsideEnvelope) {
+    // No field and nothing but vacuum outside the barrel: a track beyond a face
+    // of the convex envelope and moving away from it can never come back.
+    if (std::abs(pos.z()) > fHalfLength + fEnvelopeMargin && pos.z() * dir.z() > 0.) {
+      reason = kLeftBarrelAlongZ;
+      return true;
+    }
+    G4int iSector = SectorOf(pos);
+    if (LocalRadius(pos, iSector) > fOuterRadius + fEnvelopeMargin &&
+        LocalRadius(dir, iSector) > 0.) {
+      reason = kLeftBarrelRadially;
+      return true;
+    }
+  }
+
+  if (fKillRangedOut && material && material == fIronMaterial &&
+      particle->GetPDGCharge() != 0. && !fGasGaps.empty()) {
+    G4double distance = DistanceToNearestGasGap(pos);
+    if (!fEmCalculator) fEmCalculator = new G4EmCalculator;
+    G4double range = fEmCalculator->GetRangeFromRestricteDEDX(kinE, particle, material);
+    // A zero range means no EM tables for this particle: never kill on that basis
+    if (range > 0. && range < fRangeSafetyFactor * distance) {
+      reason = kRangedOutInIron;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TrackKiller::Count(KillReason reason, G4double kinE)
+{
+  fKilledTracks[reason]++;
+  fKilledEnergy[reason] += kinE;
+}
+
+G4bool TrackKiller::CheckNewTrack(const G4Track* track)
+{
+  fTracksSeen++;
+  if (!fEnabled) return false;
+  // Primaries have no touchable yet at stacking time; they are checked while stepping
+  const G4VPhysicalVolume* volume = track->GetVolume();
+  const G4Material* material = volume ? track->GetMaterial() : nullptr;
+  const G4Region* region = volume ? volume->GetLogicalVolume()->GetRegion() : nullptr;
+
+  KillReason reason;
+  if (ShouldKill(track->GetPosition(), track->GetMomentumDirection(), track->GetKineticEnergy(),
+                 track->GetGlobalTime(), region, track->GetParticleDefinition(), material, reason)) {
+    Count(reason, track->GetKineticEnergy());
+    fKilledAtStacking++;
+    return true;
+  }
+  return false;
+}
+
+G4bool TrackKiller::CheckStep(const G4Step* step)
+{
+  if (!fEnabled) return false;
+  G4Track* track = step->GetTrack();
+  if (track->GetTrackStatus() != fAlive) return false;
+
+  const G4StepPoint* postStep = step->GetPostStepPoint();
+  const G4VPhysicalVolume* volume = step->GetPreStepPoint()->GetPhysicalVolume();
+  const G4Region* region = volume ? volume->GetLogicalVolume()->GetRegion() : nullptr;
+  KillReason reason;
+  if (ShouldKill(postStep->GetPosition(), postStep->GetMomentumDirection(),
+                 postStep->GetKineticEnergy(), postStep->GetGlobalTime(), region,
+                 track->GetParticleDefinition(), postStep->GetMaterial(), reason)) {
+    Count(reason, postStep->GetKineticEnergy());
+    track->SetTrackStatus(fStopAndKill);
+    return true;
+  }
+  return false;
+}
+
+void TrackKiller::PrintStatistics() const
+{
+  G4cout << "\n--- TrackKiller statistics ---" << G4endl;
+  if (!fEnabled) {
+    G4cout << "     (disabled)" << G4endl;
+    return;
+  }
+  for (G4int i = 0; i < kNumKillReasons; ++i) {
+    G4cout << "     " << std::setw(20) << std::left << GetReasonName(static_cast<KillReason>(i)) << std::right
+           << " : " << std::setw(10) << fKilledTracks[i] << " tracks, "
+           << G4BestUnit(fKilledEnergy[i], "Energy") << " kinetic energy" << G4endl;
+  }
+
+  // CPU saved by the time cut, estimated from the mean CPU cost of a tracked track
+  G4double cpuSeconds = static_cast<G4double>(std::clock() - fRunStartClock) / CLOCKS_PER_SEC;
+  G4long tracked = fTracksSeen - fKilledAtStacking;
+  if (fTimeCutActive && tracked > 0) {
+    G4double cpuPerTrack = cpuSeconds / tracked;
+    G4cout << "     Time cut: " << fKilledTracks[kOutsideTimeWindow] << " of " << fTracksSeen
+           << " tracks killed, estimated CPU saved ~"
+           << fKilledTracks[kOutsideTimeWindow] * cpuPerTrack << " s (run CPU "
+           << cpuSeconds << " s, " << cpuPerTrack * 1e6 << " us/track)" << G4endl;
+  }
+  G4cout << "------------------------------" << G4endl;
+}